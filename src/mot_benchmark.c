@@ -0,0 +1,393 @@
+// 端到端多目标跟踪吞吐基准：匀速运动的目标加检测噪声、漏检与杂波，
+// 每帧构建目标/观测代价、用各求解模式完成匹配并更新航迹，
+// 报告帧率、单帧匹配延迟p50/p99与相对真值的关联准确率。可作为求解引擎改动的验收基准
+//   gcc -O2 -o mot_benchmark mot_benchmark.c munkres.c -lm -lpthread
+//   ./mot_benchmark [最大目标数]
+#include "munkres.h"
+
+#define MISS_PROB 0.1        // 漏检概率
+#define CLUTTER_RATE 0.05    // 每帧杂波数 = 目标数 * CLUTTER_RATE
+#define POS_NOISE 1.5        // 检测位置噪声（像素，标准差）
+#define MAX_COAST 3          // 航迹连续未匹配超过该帧数即删除
+#define TOPK_CANDIDATES 8
+#define MUNKRES_GATE_COST 1e6f
+
+typedef enum {
+    MODE_MUNKRES = 0,   // hungarian_match，仅在行列都不超过MAX_SIZE时运行
+    MODE_LAP,           // 稠密代价 + lap_solve
+    MODE_SPARSE,        // 门控后的稀疏候选 + lap_solve
+    MODE_TOPK,          // 稠密代价 + 每行top-k候选的lap_solve_topk
+    MODE_GRID,          // 空间网格生成的稀疏候选 + lap_solve
+    MODE_COUNT
+} BenchMode;
+
+static const char* mode_names[MODE_COUNT] = {"munkres", "lap", "sparse", "topk", "grid"};
+
+// 仿真场景：目标在边长与sqrt(N)成正比的方形区域内匀速运动、碰壁反弹，密度与N无关
+typedef struct {
+    int n;
+    float size;
+    float *x, *y, *w, *h, *vx, *vy;
+    unsigned int seed;
+} Scene;
+
+// 航迹与检测共用的SoA数组
+typedef struct {
+    int count;
+    int capacity;
+    float *x, *y, *w, *h, *vx, *vy;
+    float *cov_xx, *cov_xy, *cov_yy;
+    int* gt;        // 检测：来源目标（-1为杂波）；航迹：最近一次匹配的来源目标
+    int* missed;    // 航迹连续未匹配的帧数
+} Boxes;
+
+// 线性同余随机数，仿真场景可复现
+static unsigned int bench_rand(unsigned int* state) {
+    *state = *state * 1103515245u + 12345u;
+    return (*state >> 8) & 0xFFFFFF;
+}
+
+static float bench_uniform(unsigned int* seed) {
+    return (float)(bench_rand(seed) % 1000000) / 1000000.0f;
+}
+
+static float bench_gauss(unsigned int* seed) {
+    float u1 = bench_uniform(seed) + 1e-6f, u2 = bench_uniform(seed);
+    return sqrtf(-2.0f * logf(u1)) * cosf(6.2831853f * u2);
+}
+
+static void boxes_reserve(Boxes* b, int n) {
+    if (n <= b->capacity) {
+        return;
+    }
+    float** floats[] = {&b->x, &b->y, &b->w, &b->h, &b->vx, &b->vy, &b->cov_xx, &b->cov_xy, &b->cov_yy};
+    for (size_t k = 0; k < sizeof(floats) / sizeof(floats[0]); k++) {
+        *floats[k] = realloc(*floats[k], sizeof(float) * n);
+    }
+    b->gt = realloc(b->gt, sizeof(int) * n);
+    b->missed = realloc(b->missed, sizeof(int) * n);
+    b->capacity = n;
+}
+
+static void boxes_free(Boxes* b) {
+    float* floats[] = {b->x, b->y, b->w, b->h, b->vx, b->vy, b->cov_xx, b->cov_xy, b->cov_yy};
+    for (size_t k = 0; k < sizeof(floats) / sizeof(floats[0]); k++) {
+        free(floats[k]);
+    }
+    free(b->gt);
+    free(b->missed);
+    memset(b, 0, sizeof(*b));
+}
+
+static BoxSet boxes_view(const Boxes* b, bool with_cov) {
+    BoxSet s = {b->count, b->x, b->y, b->w, b->h, NULL, NULL, NULL, NULL, 0};
+    if (with_cov) {
+        s.cov_xx = b->cov_xx;
+        s.cov_xy = b->cov_xy;
+        s.cov_yy = b->cov_yy;
+    }
+    return s;
+}
+
+static void scene_init(Scene* s, int n, unsigned int seed) {
+    s->n = n;
+    s->size = 60.0f * sqrtf((float)n) + 100.0f;
+    s->seed = seed;
+    float** arrays[] = {&s->x, &s->y, &s->w, &s->h, &s->vx, &s->vy};
+    for (size_t k = 0; k < sizeof(arrays) / sizeof(arrays[0]); k++) {
+        *arrays[k] = malloc(sizeof(float) * n);
+    }
+    for (int i = 0; i < n; i++) {
+        s->w[i] = 20.0f + 20.0f * bench_uniform(&s->seed);
+        s->h[i] = 20.0f + 20.0f * bench_uniform(&s->seed);
+        s->x[i] = (s->size - s->w[i]) * bench_uniform(&s->seed);
+        s->y[i] = (s->size - s->h[i]) * bench_uniform(&s->seed);
+        s->vx[i] = 2.0f * bench_gauss(&s->seed);
+        s->vy[i] = 2.0f * bench_gauss(&s->seed);
+    }
+}
+
+static void scene_free(Scene* s) {
+    float* arrays[] = {s->x, s->y, s->w, s->h, s->vx, s->vy};
+    for (size_t k = 0; k < sizeof(arrays) / sizeof(arrays[0]); k++) {
+        free(arrays[k]);
+    }
+}
+
+// 推进一帧并生成检测（含漏检与杂波），检测顺序打乱
+static void scene_step(Scene* s, Boxes* dets) {
+    int clutter = (int)(s->n * CLUTTER_RATE + bench_uniform(&s->seed));
+    boxes_reserve(dets, s->n + clutter);
+    dets->count = 0;
+    for (int i = 0; i < s->n; i++) {
+        s->x[i] += s->vx[i];
+        s->y[i] += s->vy[i];
+        if (s->x[i] < 0.0f || s->x[i] + s->w[i] > s->size) {
+            s->vx[i] = -s->vx[i];
+            s->x[i] += 2.0f * s->vx[i];
+        }
+        if (s->y[i] < 0.0f || s->y[i] + s->h[i] > s->size) {
+            s->vy[i] = -s->vy[i];
+            s->y[i] += 2.0f * s->vy[i];
+        }
+        if (bench_uniform(&s->seed) < MISS_PROB) {
+            continue;
+        }
+        int d = dets->count++;
+        dets->x[d] = s->x[i] + POS_NOISE * bench_gauss(&s->seed);
+        dets->y[d] = s->y[i] + POS_NOISE * bench_gauss(&s->seed);
+        dets->w[d] = s->w[i];
+        dets->h[d] = s->h[i];
+        dets->gt[d] = i;
+    }
+    for (int c = 0; c < clutter; c++) {
+        int d = dets->count++;
+        dets->w[d] = 20.0f + 20.0f * bench_uniform(&s->seed);
+        dets->h[d] = 20.0f + 20.0f * bench_uniform(&s->seed);
+        dets->x[d] = (s->size - dets->w[d]) * bench_uniform(&s->seed);
+        dets->y[d] = (s->size - dets->h[d]) * bench_uniform(&s->seed);
+        dets->gt[d] = -1;
+    }
+    for (int d = dets->count - 1; d > 0; d--) {
+        int e = bench_rand(&s->seed) % (d + 1);
+        float* floats[] = {dets->x, dets->y, dets->w, dets->h};
+        for (int k = 0; k < 4; k++) {
+            float t = floats[k][d];
+            floats[k][d] = floats[k][e];
+            floats[k][e] = t;
+        }
+        int g = dets->gt[d];
+        dets->gt[d] = dets->gt[e];
+        dets->gt[e] = g;
+    }
+}
+
+// 航迹预测：匀速外推，位置协方差随未匹配帧数增长
+static void tracks_predict(Boxes* t) {
+    for (int i = 0; i < t->count; i++) {
+        t->x[i] += t->vx[i];
+        t->y[i] += t->vy[i];
+        float var = 2.0f * POS_NOISE * POS_NOISE + 4.0f * (1 + t->missed[i]);
+        t->cov_xx[i] = var;
+        t->cov_xy[i] = 0.0f;
+        t->cov_yy[i] = var;
+    }
+}
+
+// 用匹配结果更新航迹：det_of[i]为航迹i匹配的检测（-1为未匹配）。返回关联正确的配对数
+static int tracks_update(Boxes* t, const Boxes* dets, const int* det_of, unsigned char* det_used) {
+    int correct = 0;
+    memset(det_used, 0, dets->count);
+    int kept = 0;
+    for (int i = 0; i < t->count; i++) {
+        int d = det_of[i];
+        if (d >= 0) {
+            det_used[d] = 1;
+            correct += dets->gt[d] >= 0 && dets->gt[d] == t->gt[i];
+            float px = t->x[i] - t->vx[i], py = t->y[i] - t->vy[i];
+            t->vx[i] = 0.6f * t->vx[i] + 0.4f * (dets->x[d] - px);
+            t->vy[i] = 0.6f * t->vy[i] + 0.4f * (dets->y[d] - py);
+            t->x[i] = dets->x[d];
+            t->y[i] = dets->y[d];
+            t->w[i] = dets->w[d];
+            t->h[i] = dets->h[d];
+            t->gt[i] = dets->gt[d];
+            t->missed[i] = 0;
+        } else if (++t->missed[i] > MAX_COAST) {
+            continue;
+        }
+        float* floats[] = {t->x, t->y, t->w, t->h, t->vx, t->vy};
+        for (int k = 0; k < 6; k++) {
+            floats[k][kept] = floats[k][i];
+        }
+        t->gt[kept] = t->gt[i];
+        t->missed[kept] = t->missed[i];
+        kept++;
+    }
+    t->count = kept;
+    boxes_reserve(t, kept + dets->count);
+    for (int d = 0; d < dets->count; d++) {
+        if (!det_used[d]) {
+            int i = t->count++;
+            t->x[i] = dets->x[d];
+            t->y[i] = dets->y[d];
+            t->w[i] = dets->w[d];
+            t->h[i] = dets->h[d];
+            t->vx[i] = 0.0f;
+            t->vy[i] = 0.0f;
+            t->gt[i] = dets->gt[d];
+            t->missed[i] = 0;
+        }
+    }
+    return correct;
+}
+
+static int compare_ll(const void* a, const void* b) {
+    long long x = *(const long long*)a, y = *(const long long*)b;
+    return (x > y) - (x < y);
+}
+
+typedef struct {
+    int frames;
+    double fps;
+    double p50_ms;
+    double p99_ms;
+    double build_ms;    // 平均每帧代价构建耗时
+    double accuracy;    // 关联正确的配对 / 全部配对（航迹出生帧不计）
+    long long pairs;
+    bool skipped;
+} BenchResult;
+
+static float munkres_matrix[MAX_SIZE][MAX_SIZE];
+
+static BenchResult bench_run(BenchMode mode, int n, int frames) {
+    BenchResult r;
+    memset(&r, 0, sizeof(r));
+    Scene scene;
+    scene_init(&scene, n, 20240601u + n);
+    Boxes tracks, dets;
+    memset(&tracks, 0, sizeof(tracks));
+    memset(&dets, 0, sizeof(dets));
+    LapWorkspace ws;
+    lap_workspace_init(&ws);
+    SparseCost sparse, cand;
+    sparse_cost_init(&sparse);
+    sparse_cost_init(&cand);
+    CandidateBuilder builder;
+    candidate_builder_init(&builder);
+    CostParams params = {1.0f, 0.02f, 0.0f, 0.0f, 13.8f, 0.0f}; // 马氏距离门控取chi2(2)的99.9%分位
+    float* dense = NULL;
+    size_t dense_len = 0;
+    int* det_of = NULL;
+    unsigned char* det_used = NULL;
+    long long* latency = malloc(sizeof(long long) * frames);
+    long long correct = 0;
+    long long build_ns = 0;
+
+    // 第一帧只建立航迹
+    scene_step(&scene, &dets);
+    det_of = calloc(dets.count + 1, sizeof(int));
+    det_used = malloc(dets.count + 1);
+    tracks_update(&tracks, &dets, det_of, det_used);
+
+    long long t_begin = monotonic_ns();
+    for (int f = 0; f < frames; f++) {
+        scene_step(&scene, &dets);
+        tracks_predict(&tracks);
+        int rows = tracks.count, cols = dets.count;
+        if (mode == MODE_MUNKRES && (rows > MAX_SIZE || cols > MAX_SIZE)) {
+            r.skipped = true;
+            break;
+        }
+        det_of = realloc(det_of, sizeof(int) * (rows + 1));
+        det_used = realloc(det_used, cols + 1);
+        BoxSet tv = boxes_view(&tracks, true), dv = boxes_view(&dets, false);
+        if (mode != MODE_SPARSE && mode != MODE_GRID && (size_t)rows * cols > dense_len) {
+            dense_len = (size_t)rows * cols;
+            free(dense);
+            dense = malloc(sizeof(float) * dense_len);
+        }
+        for (int i = 0; i < rows; i++) {
+            det_of[i] = -1;
+        }
+
+        long long t0 = monotonic_ns();
+        if (mode == MODE_MUNKRES) {
+            build_cost_dense(&munkres_matrix[0][0], MAX_SIZE, &tv, &dv, &params);
+            build_ns += monotonic_ns() - t0;
+            // hungarian_match遇到DISALLOWED会改用lap_solve：门控位置换成有限的大代价使该模式仍测Munkres，匹配后再剔除
+            for (int i = 0; i < rows; i++) {
+                for (int j = 0; j < cols; j++) {
+                    if (IS_DISALLOWED(munkres_matrix[i][j])) {
+                        munkres_matrix[i][j] = MUNKRES_GATE_COST;
+                    }
+                }
+            }
+            Assignment results[MAX_SIZE];
+            int count = 0;
+            float total;
+            t0 = monotonic_ns();
+            if (hungarian_match(munkres_matrix, rows, cols, results, &count, &total) != 0) {
+                count = 0;
+            }
+            latency[f] = monotonic_ns() - t0;
+            for (int k = 0; k < count; k++) {
+                if (munkres_matrix[results[k].row][results[k].col] < MUNKRES_GATE_COST) {
+                    det_of[results[k].row] = results[k].col;
+                }
+            }
+        } else {
+            CostView view;
+            if (mode == MODE_SPARSE) {
+                build_cost_sparse(&sparse, &tv, &dv, &params);
+                view = cost_view_sparse(&sparse);
+            } else if (mode == MODE_GRID) {
+                build_cost_sparse_indexed(&builder, &sparse, &tv, &dv, &params, NULL);
+                view = cost_view_sparse(&sparse);
+            } else {
+                build_cost_dense(dense, cols, &tv, &dv, &params);
+                view = cost_view_dense(dense, rows, cols, cols);
+            }
+            build_ns += monotonic_ns() - t0;
+            t0 = monotonic_ns();
+            if (mode == MODE_TOPK) {
+                TopkReport report;
+                lap_solve_topk(&view, TOPK_CANDIDATES, &ws, &cand, &report);
+            } else {
+                lap_solve(&view, &ws);
+            }
+            latency[f] = monotonic_ns() - t0;
+            for (int i = 0; i < rows; i++) {
+                det_of[i] = ws.row_to_col[i];
+            }
+        }
+        for (int i = 0; i < rows; i++) {
+            r.pairs += det_of[i] >= 0;
+        }
+        correct += tracks_update(&tracks, &dets, det_of, det_used);
+        r.frames++;
+    }
+    long long t_end = monotonic_ns();
+
+    if (!r.skipped && r.frames > 0) {
+        r.fps = r.frames / ((t_end - t_begin) / 1e9);
+        qsort(latency, r.frames, sizeof(long long), compare_ll);
+        r.p50_ms = latency[r.frames / 2] / 1e6;
+        r.p99_ms = latency[(int)(r.frames * 0.99)] / 1e6;
+        r.build_ms = build_ns / 1e6 / r.frames;
+        r.accuracy = r.pairs > 0 ? (double)correct / r.pairs : 0.0;
+    }
+    free(latency);
+    free(dense);
+    free(det_of);
+    free(det_used);
+    sparse_cost_free(&sparse);
+    sparse_cost_free(&cand);
+    candidate_builder_free(&builder);
+    lap_workspace_free(&ws);
+    boxes_free(&tracks);
+    boxes_free(&dets);
+    scene_free(&scene);
+    return r;
+}
+
+int main(int argc, char** argv) {
+    int max_n = argc > 1 ? atoi(argv[1]) : 5000;
+    const int sizes[] = {10, 50, 100, 500, 1000, 2000, 5000};
+    printf("%6s %-8s %6s %10s %10s %10s %10s %8s\n", "N", "mode", "frames", "fps", "build(ms)", "p50(ms)", "p99(ms)",
+           "accuracy");
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]) && sizes[s] <= max_n; s++) {
+        int n = sizes[s];
+        int frames = n <= 100 ? 500 : n <= 1000 ? 100 : 30;
+        for (int mode = 0; mode < MODE_COUNT; mode++) {
+            BenchResult r = bench_run((BenchMode)mode, n, frames);
+            if (r.skipped) {
+                printf("%6d %-8s %6s (行列超过MAX_SIZE=%d，跳过)\n", n, mode_names[mode], "-", MAX_SIZE);
+                continue;
+            }
+            printf("%6d %-8s %6d %10.1f %10.3f %10.3f %10.3f %8.4f\n", n, mode_names[mode], r.frames, r.fps,
+                   r.build_ms, r.p50_ms, r.p99_ms, r.accuracy);
+        }
+    }
+    return 0;
+}
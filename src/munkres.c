@@ -0,0 +1,7044 @@
+#include "munkres.h"
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#if defined(__F16C__) && defined(__AVX__)
+#include <immintrin.h>
+#endif
+
+// Hopcroft-Karp的状态：第i行的边为 adj[row_start[i], row_start[i] + deg[i])（列号），
+// 存储由调用方提供（step2_max_matching的零元素图、瓶颈指派的阈值子图）
+typedef struct {
+    int rows;
+    const int* adj;
+    const int* row_start;
+    const int* deg;
+    int* row_match;         // -1为未匹配
+    int* col_match;
+    int* dist;              // 行所在的层（-1为本阶段不可达或已无法增广）
+    int* next;              // 每行下一条待尝试的边（相对row_start）
+    int* queue;             // BFS队列，长度rows
+    int* stack;             // DFS显式栈，长度rows
+    const float* edge_cost; // 与adj对应的成本，可为NULL
+    float* match_cost;      // edge_cost非NULL时，增广同时记录每行匹配边的成本
+    int limit;              // 本阶段最短增广路径终点所在的行层
+    int phases;             // 累计阶段数
+} HopcroftKarp;
+
+typedef struct MetricsShard {
+    _Atomic unsigned long long calls[ENGINE_COUNT];
+    _Atomic unsigned long long failures[ENGINE_COUNT];
+    _Atomic unsigned long long cells[ENGINE_COUNT];         // rows * cols 累计
+    _Atomic unsigned long long max_cells[ENGINE_COUNT];
+    _Atomic unsigned long long augmentations[ENGINE_COUNT];
+    _Atomic unsigned long long infeasible_rows[ENGINE_COUNT];
+    _Atomic unsigned long long latency_sum_ns[ENGINE_COUNT];
+    _Atomic unsigned long long latency[ENGINE_COUNT][METRICS_BUCKETS];
+    atomic_bool in_use;                 // 是否有线程持有（持有者是唯一写者）
+    struct MetricsShard* next;
+} MetricsShard;
+
+typedef float (*TinySolver)(const float* c, int* assign);
+
+// 浮点向量（GCC/Clang向量扩展）：启用AVX时为8路，否则为SSE的4路
+#if defined(__AVX__)
+#define VEC_WIDTH 8
+#else
+#define VEC_WIDTH 4
+#endif
+typedef float vfloat __attribute__((vector_size(VEC_WIDTH * sizeof(float))));
+typedef int vmask __attribute__((vector_size(VEC_WIDTH * sizeof(int))));
+
+// 目标侧的预计算量：框、中心、协方差逆与门控阈值，行核与单配对核共用
+typedef struct {
+    float x1, y1, x2, y2, area, cx, cy;
+    float ia, ib, ic;      // 协方差逆（对称，ib为非对角元）
+    float min_iou, max_maha, max_cos;
+    bool use_maha;
+    bool use_cos;
+    bool gated;            // 启用马氏项但协方差不正定：距离无定义，整行门控
+} CostTrack;
+
+typedef unsigned short vhalf __attribute__((vector_size(VEC_WIDTH * sizeof(unsigned short))));
+typedef unsigned int vuint __attribute__((vector_size(VEC_WIDTH * sizeof(unsigned int))));
+
+typedef struct {
+    WorkerPool* pool;
+    int index;
+} WorkerStart;
+
+typedef struct {
+    CandidateBuilder* b;
+    const BoxSet* tracks;
+    const BoxSet* dets;
+    const CostParams* p;
+} CandidateTask;
+
+// 屏障：先自旋（翻转sense），等待较久时在条件变量上休眠，线程数超过核数时也不会空转
+typedef struct {
+    atomic_int count;
+    atomic_int sense;
+    atomic_int sleepers;
+    int threads;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+} SpinBarrier;
+
+// 块内候选列，比较键为(距离, 是否已匹配, 首次触达的步数, 列号)，与串行版按touched顺序的选择一致
+typedef struct {
+    _Alignas(64) double d;
+    int busy;
+    int step;
+    int j;
+} LapCandidate;
+
+typedef struct {
+    LapCtx ctx;
+    int threads;
+    int block;
+    SpinBarrier barrier;
+    LapCandidate* slots;    // 两组（按步的奇偶交替），每组每线程一个
+} LapParallel;
+
+// 排序用的(键, 假设)对，键相同时按假设下标
+typedef struct {
+    double key;
+    int hyp;
+} MdaSortItem;
+
+// Sinkhorn内部状态：行列各带一个松弛节点，吸收 |rows-cols| 的差额（等价于pad_matrix的0填充）
+typedef struct {
+    const float* cost;
+    int stride;
+    int rows;
+    int cols;
+    float inv_eps;
+    float eps;
+    float* f;               // 行势，f[rows]为松弛行
+    float* g;               // 列势，g[cols]为松弛列
+    float* col_max;
+    float* col_sum;
+    float* row_err;
+    float slack_row_mass;   // cols > rows 时松弛行的质量
+    float slack_col_mass;   // rows > cols 时松弛列的质量
+} SinkhornState;
+
+typedef struct {
+    float log_p;
+    int row;
+} RowProb;
+
+typedef struct {
+    vfloat cost[BATCH_MAX_SIZE][BATCH_MAX_SIZE]; // 填充为n x n，DISALLOWED为+inf
+    vfloat u[BATCH_MAX_SIZE];
+    vfloat v[BATCH_MAX_SIZE];
+    vfloat dist[BATCH_MAX_SIZE];
+    vmask scanned[BATCH_MAX_SIZE];
+    vmask pred[BATCH_MAX_SIZE];
+    vmask c2r[BATCH_MAX_SIZE];
+    vmask r2c[BATCH_MAX_SIZE];
+} BatchState;
+
+// 打印矩阵的函数
+void print_matrix(float matrix[MAX_SIZE][MAX_SIZE], int rows, int cols, const char* msg) {
+    if (msg != NULL) {
+        printf("%s\n", msg);
+    }
+    for (int i = 0; i < rows; i++) {
+        printf("[");
+        for (int j = 0; j < cols; j++) {
+           
+            printf("%.4lf", matrix[i][j]);
+            
+            if (j < cols - 1) {
+                printf(", ");
+            }
+        }
+        printf("]\n");
+    }
+    printf("\n");
+}
+
+// 创建一个新的矩阵并填充它，同时保留原始矩阵
+void pad_matrix(Munkres* munkres, float input_matrix[][MAX_SIZE], int input_rows, int input_cols) {
+    // 找到最大行和列
+    int max_dim = input_rows > input_cols ? input_rows : input_cols;
+    munkres->n = max_dim;
+
+    // 填充矩阵，使用0.0作为填充值，并保留原始矩阵
+    for (int i = 0; i < munkres->n; i++) {
+        for (int j = 0; j < munkres->n; j++) {
+            if (i < input_rows && j < input_cols) {
+                munkres->C[i][j] = input_matrix[i][j];
+                munkres->original_C[i][j] = input_matrix[i][j];
+            } else {
+                munkres->C[i][j] = 0.0; // 填充值为0.0
+                munkres->original_C[i][j] = DISALLOWED_VAL; // 保留原始矩阵为DISALLOWED_VAL
+            }
+        }
+    }
+}
+
+// 初始化行和列标签
+void initialize_labels(Munkres* munkres, int original_rows, int original_cols) {
+    for (int i = 0; i < munkres->n; i++) {
+        munkres->lx[i] = 0.0;
+        munkres->ly[i] = 0.0;
+        for (int j = 0; j < munkres->n; j++) {
+            if (munkres->original_C[i][j] != DISALLOWED_VAL && munkres->original_C[i][j] > munkres->lx[i]) {
+                munkres->lx[i] = munkres->original_C[i][j];
+            }
+        }
+    }
+}
+
+// 初始化Munkres结构体
+void initialize(Munkres* munkres) {
+    for (int i = 0; i < munkres->n; i++) {
+        munkres->row_covered[i] = false;
+        munkres->col_covered[i] = false;
+        munkres->lx[i] = 0.0;
+        munkres->ly[i] = 0.0;
+        for (int j = 0; j < munkres->n; j++) {
+            munkres->marked[i][j] = UNMARKED;
+        }
+    }
+    memset(munkres->path, 0, sizeof(munkres->path));
+    munkres->Z0_r = 0;
+    munkres->Z0_c = 0;
+    munkres->lower_bound = 0.0;
+    munkres->verbose = true;
+    munkres->max_matching_init = false;
+    munkres->step = 1;
+    munkres->iterations = 0;
+    munkres->augmentations = 0;
+    munkres->active_ns = 0;
+}
+
+// 查找未覆盖的零
+bool find_a_zero(Munkres* munkres, int* row, int* col) {
+    for (int i = 0; i < munkres->n; i++) {
+        for (int j = 0; j < munkres->n; j++) {
+            if (munkres->C[i][j] == 0 && !munkres->row_covered[i] && !munkres->col_covered[j]) {
+                *row = i;
+                *col = j;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// 查找行中第一个星号零
+int find_star_in_row(Munkres* munkres, int row) {
+    for (int j = 0; j < munkres->n; j++) {
+        if (munkres->marked[row][j] == STARRED) {
+            return j;
+        }
+    }
+    return -1;
+}
+
+// 查找列中第一个星号零
+int find_star_in_col(Munkres* munkres, int col) {
+    for (int i = 0; i < munkres->n; i++) {
+        if (munkres->marked[i][col] == STARRED) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// 查找行中第一个标记零
+int find_prime_in_row(Munkres* munkres, int row) {
+    for (int j = 0; j < munkres->n; j++) {
+        if (munkres->marked[row][j] == PRIMED) {
+            return j;
+        }
+    }
+    return -1;
+}
+
+// 清除所有的覆盖标记
+void clear_covers(Munkres* munkres) {
+    for (int i = 0; i < munkres->n; i++) {
+        munkres->row_covered[i] = false;
+        munkres->col_covered[i] = false;
+    }
+}
+
+// 清除所有的标记零
+void erase_primes(Munkres* munkres) {
+    for (int i = 0; i < munkres->n; i++) {
+        for (int j = 0; j < munkres->n; j++) {
+            if (munkres->marked[i][j] == PRIMED) {
+                munkres->marked[i][j] = UNMARKED;
+            }
+        }
+    }
+}
+
+// 查找矩阵中最小的未覆盖值
+float find_smallest(Munkres* munkres) {
+    float minval = DBL_MAX;
+    for (int i = 0; i < munkres->n; i++) {
+        for (int j = 0; j < munkres->n; j++) {
+            if (!munkres->row_covered[i] && !munkres->col_covered[j] && munkres->C[i][j] < minval) {
+                minval = munkres->C[i][j];
+            }
+        }
+    }
+    return minval;
+}
+
+// 构建增广路径并调整标记
+void convert_path(Munkres* munkres, int count) {
+    for (int i = 0; i <= count; i++) {
+        int r = munkres->path[i][0];
+        int c = munkres->path[i][1];
+        if (munkres->marked[r][c] == STARRED) {
+            munkres->marked[r][c] = UNMARKED;
+        } else {
+            munkres->marked[r][c] = STARRED;
+        }
+    }
+}
+
+// 扩展增广路径
+void step5_build_path(Munkres* munkres, int* step) {
+    int count = 0;
+    munkres->path[count][0] = munkres->Z0_r;
+    munkres->path[count][1] = munkres->Z0_c;
+    count++;
+
+    while (1) {
+        int row = find_star_in_col(munkres, munkres->path[count - 1][1]);
+        if (row == -1) {
+            break;
+        }
+        munkres->path[count][0] = row;
+        munkres->path[count][1] = munkres->path[count - 1][1];
+        count++;
+
+        int col = find_prime_in_row(munkres, munkres->path[count - 1][0]);
+        munkres->path[count][0] = munkres->path[count - 1][0];
+        munkres->path[count][1] = col;
+        count++;
+    }
+
+    // 执行路径转换
+    convert_path(munkres, count - 1);
+
+    // 清除覆盖标记和标记零
+    clear_covers(munkres);
+    erase_primes(munkres);
+
+    *step = 3;
+}
+
+// 深度优先搜索，查找增广路径
+bool dfs(Munkres* munkres, int m, bool *visited_x, bool *visited_y, int *match, float *lx, float *ly, float *slack, float *minz) {
+    for (int n = 0; n < munkres->n; n++) {
+        if (!visited_y[n]) {
+            visited_y[n] = true;
+            float delta = munkres->lx[m] + munkres->ly[n] - munkres->original_C[m][n];
+
+            // 打印每次递归的状态
+            printf("DFS trying m = %d, n = %d, weight = %.4lf, delta = %.4lf\n", m, n, munkres->original_C[m][n], delta);
+
+            if (delta == 0.0) {  
+                if (match[n] == -1 || dfs(munkres, match[n], visited_x, visited_y, match, munkres->lx, munkres->ly, slack, minz)) {
+                    match[n] = m;  
+                    return true;
+                }
+            } else {  
+                if (delta < slack[n]) {
+                    slack[n] = delta;
+                    if (delta < *minz) {
+                        *minz = delta;
+                    }
+                }
+            }
+        }
+    }
+    return false;
+}
+
+// Step 1: 对每一行进行最小值减法；某行全为DISALLOWED时返回-1
+int step1(Munkres* munkres) {
+    for (int i = 0; i < munkres->n; i++) {
+        float minval = DBL_MAX;
+        for (int j = 0; j < munkres->n; j++) {
+            if (munkres->C[i][j] < minval && !IS_DISALLOWED(munkres->C[i][j])) {
+                minval = munkres->C[i][j];
+            }
+        }
+        if (IS_DISALLOWED(minval)) {
+            // 一整行都是DISALLOWED：无解
+            return -1;
+        }
+        for (int j = 0; j < munkres->n; j++) {
+            if (!IS_DISALLOWED(munkres->C[i][j])) {
+                munkres->C[i][j] -= minval;
+            }
+        }
+        munkres->lower_bound += minval;
+    }
+    return 2;
+}
+
+// Step 2: 标记零
+int step2(Munkres* munkres) {
+    for (int i = 0; i < munkres->n; i++) {
+        for (int j = 0; j < munkres->n; j++) {
+            if (munkres->C[i][j] == 0 && !munkres->row_covered[i] && !munkres->col_covered[j]) {
+                munkres->marked[i][j] = STARRED;
+                munkres->row_covered[i] = true;
+                munkres->col_covered[j] = true;
+                break;
+            }
+        }
+    }
+    clear_covers(munkres);
+    return 3;
+}
+
+// BFS分层：从所有未匹配行出发，dist为交替路径上的行层数。第一次在第L层到达空闲列后不再扩展更深的层，
+// 本阶段只沿长度最短的增广路径增广。返回是否能到达空闲列
+static bool hk_bfs(HopcroftKarp* hk) {
+    int head = 0, tail = 0;
+    hk->limit = -1;
+    for (int i = 0; i < hk->rows; i++) {
+        hk->dist[i] = hk->row_match[i] == -1 ? 0 : -1;
+        if (hk->row_match[i] == -1) {
+            hk->queue[tail++] = i;
+        }
+    }
+    while (head < tail) {
+        int i = hk->queue[head++];
+        if (hk->limit != -1 && hk->dist[i] > hk->limit) {
+            break;
+        }
+        const int* adj = hk->adj + hk->row_start[i];
+        for (int k = 0; k < hk->deg[i]; k++) {
+            int r = hk->col_match[adj[k]];
+            if (r == -1) {
+                hk->limit = hk->dist[i];
+            } else if (hk->dist[r] == -1 && hk->limit == -1) {
+                hk->dist[r] = hk->dist[i] + 1;
+                hk->queue[tail++] = r;
+            }
+        }
+    }
+    return hk->limit != -1;
+}
+
+// 从root沿分层图找最短增广路径：只在第limit层接受空闲列。显式栈，不受递归深度限制，找到后沿栈翻转匹配
+static bool hk_dfs(HopcroftKarp* hk, int root) {
+    int top = 0;
+    hk->stack[top++] = root;
+    while (top > 0) {
+        int i = hk->stack[top - 1];
+        if (hk->next[i] == hk->deg[i]) {
+            hk->dist[i] = -1; // 此行已无法增广，本阶段不再访问
+            top--;
+            continue;
+        }
+        int r = hk->col_match[hk->adj[hk->row_start[i] + hk->next[i]]];
+        if (r == -1 && hk->dist[i] == hk->limit) {
+            for (int k = 0; k < top; k++) {
+                int row = hk->stack[k];
+                int j = hk->adj[hk->row_start[row] + hk->next[row]];
+                hk->row_match[row] = j;
+                hk->col_match[j] = row;
+                if (hk->edge_cost != NULL) {
+                    hk->match_cost[row] = hk->edge_cost[hk->row_start[row] + hk->next[row]];
+                }
+                hk->next[row]++;
+            }
+            return true;
+        }
+        if (r != -1 && hk->dist[r] == hk->dist[i] + 1) {
+            hk->stack[top++] = r;
+        } else {
+            hk->next[i]++;
+        }
+    }
+    return false;
+}
+
+// 把现有匹配补成最大匹配，每个阶段沿一组不相交的最短增广路径增广，O(E√V)。返回新增的匹配数
+static int hk_augment(HopcroftKarp* hk) {
+    int added = 0;
+    while (hk_bfs(hk)) {
+        hk->phases++;
+        memset(hk->next, 0, sizeof(int) * hk->rows);
+        for (int i = 0; i < hk->rows; i++) {
+            if (hk->row_match[i] == -1 && hk->dist[i] == 0) {
+                added += hk_dfs(hk, i);
+            }
+        }
+    }
+    return added;
+}
+
+// Step 2（可选）：先做一次列归约，再用Hopcroft-Karp在零元素构成的二分图上求最大匹配并全部标星，
+// O(E√V)。平局很多时贪心标星离最大匹配很远，之后要靠多轮step4/step5逐个修补。
+// 邻接表分配失败时退回贪心标星
+int step2_max_matching(Munkres* munkres) {
+    int n = munkres->n;
+    for (int j = 0; j < n; j++) {
+        float minval = INFINITY;
+        for (int i = 0; i < n; i++) {
+            if (!IS_DISALLOWED(munkres->C[i][j]) && munkres->C[i][j] < minval) {
+                minval = munkres->C[i][j];
+            }
+        }
+        if (minval > 0.0f && minval != INFINITY) {
+            for (int i = 0; i < n; i++) {
+                if (!IS_DISALLOWED(munkres->C[i][j])) {
+                    munkres->C[i][j] -= minval;
+                }
+            }
+            munkres->lower_bound += minval;
+        }
+    }
+
+    int zeros = 0;
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            zeros += munkres->C[i][j] == 0;
+        }
+    }
+    int* adj = malloc(sizeof(int) * (zeros > 0 ? zeros : 1));
+    if (adj == NULL) {
+        return step2(munkres);
+    }
+    int row_start[MAX_SIZE], deg[MAX_SIZE], row_match[MAX_SIZE], col_match[MAX_SIZE];
+    int dist[MAX_SIZE], next[MAX_SIZE], queue[MAX_SIZE], stack[MAX_SIZE];
+    int m = 0;
+    for (int i = 0; i < n; i++) {
+        row_match[i] = -1;
+        col_match[i] = -1;
+        row_start[i] = m;
+        for (int j = 0; j < n; j++) {
+            if (munkres->C[i][j] == 0) {
+                adj[m++] = j;
+            }
+        }
+        deg[i] = m - row_start[i];
+    }
+    HopcroftKarp hk = {n, adj, row_start, deg, row_match, col_match, dist, next, queue, stack, NULL, NULL, -1, 0};
+    hk_augment(&hk);
+    for (int i = 0; i < n; i++) {
+        if (row_match[i] != -1) {
+            munkres->marked[i][row_match[i]] = STARRED;
+        }
+    }
+    free(adj);
+    clear_covers(munkres);
+    return 3;
+}
+
+// Step 3: 覆盖包含星号零的所有列
+int step3(Munkres* munkres) {
+    int count = 0;
+    for (int i = 0; i < munkres->n; i++) {
+        for (int j = 0; j < munkres->n; j++) {
+            if (munkres->marked[i][j] == STARRED && !munkres->col_covered[j]) {
+                munkres->col_covered[j] = true;
+                count++;
+            }
+        }
+    }
+    if (munkres->verbose) {
+        printf("After Step 3:\n");
+        printf("Row covers: ");
+        for (int i = 0; i < munkres->n; i++) {
+            printf("%d ", munkres->row_covered[i]);
+        }
+        printf("\nColumn covers: ");
+        for (int j = 0; j < munkres->n; j++) {
+            printf("%d ", munkres->col_covered[j]);
+        }
+        printf("\n");
+    }
+
+    if (count >= munkres->n) {
+        return 7; // DONE
+    } else {
+        return 4;
+    }
+}
+
+// Step 4: 找到未覆盖的零并标记
+int step4(Munkres* munkres) {
+    while (find_a_zero(munkres, &munkres->Z0_r, &munkres->Z0_c)) {
+        munkres->marked[munkres->Z0_r][munkres->Z0_c] = PRIMED;
+        int star_col = find_star_in_row(munkres, munkres->Z0_r);
+        if (star_col != -1) {
+            munkres->row_covered[munkres->Z0_r] = true;
+            munkres->col_covered[star_col] = false;
+        } else {
+            // 找到一个没有星号零的行，进入Step 5
+            return 5;
+        }
+    }
+    // 没有未覆盖的零，进入Step 6
+    return 6;
+}
+
+// Step 5: 构建增广路径并调整标记
+int step5(Munkres* munkres, int* step) {
+    step5_build_path(munkres, step);
+    return 3;
+}
+
+// Step 6: 调整矩阵元素；无法继续时返回-1
+int step6(Munkres* munkres) {
+    float minval = find_smallest(munkres);
+    if (IS_DISALLOWED(minval)) {
+        // 未覆盖的元素全是DISALLOWED：不存在避开DISALLOWED的完美匹配
+        return -1;
+    }
+
+    for (int i = 0; i < munkres->n; i++) {
+        for (int j = 0; j < munkres->n; j++) {
+            if (IS_DISALLOWED(munkres->C[i][j])) {
+                continue;
+            }
+            if (munkres->row_covered[i]) {
+                munkres->C[i][j] += minval;
+            }
+            if (!munkres->col_covered[j]) {
+                munkres->C[i][j] -= minval;
+            }
+        }
+    }
+
+    // 覆盖行整体加minval、未覆盖列整体减minval，下界随之变化
+    int covered_rows = 0, uncovered_cols = 0;
+    for (int i = 0; i < munkres->n; i++) {
+        covered_rows += munkres->row_covered[i];
+        uncovered_cols += !munkres->col_covered[i];
+    }
+    munkres->lower_bound += (double)minval * (uncovered_cols - covered_rows);
+
+    // 更新标签
+    for (int i = 0; i < munkres->n; i++) {
+        if (munkres->row_covered[i]) {
+            munkres->lx[i] -= minval;
+        }
+        for (int j = 0; j < munkres->n; j++) {
+            if (munkres->col_covered[j]) {
+                munkres->ly[j] += minval;
+            }
+        }
+    }
+
+    if (munkres->verbose) {
+        printf("After Step 6:\n");
+        printf("Row labels (lx): ");
+        for (int i = 0; i < munkres->n; i++) {
+            printf("%.4lf ", munkres->lx[i]);
+        }
+        printf("\nColumn labels (ly): ");
+        for (int j = 0; j < munkres->n; j++) {
+            printf("%.4lf ", munkres->ly[j]);
+        }
+        printf("\n");
+    }
+
+    return 4;
+}
+
+// 单调时钟（纳秒）
+long long monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static const char* const engine_names[ENGINE_COUNT] = {
+    "munkres", "tiny", "batch", "lap", "cascade", "topk", "flow", "sinkhorn", "greedy"
+};
+
+static atomic_bool metrics_on = false;
+static MetricsShard* _Atomic metrics_shards = NULL; // 只增不删；线程退出后归还，计数保留
+static _Thread_local MetricsShard* metrics_local = NULL;
+static pthread_key_t metrics_key;
+static pthread_once_t metrics_key_once = PTHREAD_ONCE_INIT;
+
+// 线程退出时归还分片（release：接管的线程能看到此前写入的计数）
+static void metrics_shard_release(void* arg) {
+    MetricsShard* s = arg;
+    atomic_store_explicit(&s->in_use, false, memory_order_release);
+}
+
+static void metrics_key_create(void) {
+    pthread_key_create(&metrics_key, metrics_shard_release);
+}
+
+void metrics_enable(bool on) {
+    atomic_store(&metrics_on, on);
+}
+
+// 延迟值所在的桶：0..7直接对应，之后每个2的幂区间分为8段
+int metrics_bucket(unsigned long long ns) {
+    if (ns < METRICS_SUB) {
+        return (int)ns;
+    }
+    int shift = 63 - __builtin_clzll(ns) - METRICS_SUB_BITS;
+    if (shift > METRICS_MAX_SHIFT) {
+        return METRICS_BUCKETS - 1;
+    }
+    return (shift + 1) * METRICS_SUB + (int)((ns >> shift) & (METRICS_SUB - 1));
+}
+
+// 桶的上界（不含）
+unsigned long long metrics_bucket_upper(int b) {
+    if (b < METRICS_SUB) {
+        return (unsigned long long)b + 1;
+    }
+    int shift = b / METRICS_SUB - 1;
+    return (unsigned long long)(METRICS_SUB + b % METRICS_SUB + 1) << shift;
+}
+
+// 当前线程的分片：优先接管已退出线程归还的分片，没有时才新建
+static MetricsShard* metrics_shard(void) {
+    if (metrics_local == NULL) {
+        pthread_once(&metrics_key_once, metrics_key_create);
+        MetricsShard* s = atomic_load(&metrics_shards);
+        for (; s != NULL; s = s->next) {
+            bool idle = false;
+            if (!atomic_load_explicit(&s->in_use, memory_order_relaxed) &&
+                atomic_compare_exchange_strong_explicit(&s->in_use, &idle, true, memory_order_acquire,
+                                                        memory_order_relaxed)) {
+                break;
+            }
+        }
+        if (s == NULL) {
+            s = calloc(1, sizeof(MetricsShard));
+            if (s == NULL) {
+                return NULL;
+            }
+            atomic_init(&s->in_use, true);
+            s->next = atomic_load(&metrics_shards);
+            while (!atomic_compare_exchange_weak(&metrics_shards, &s->next, s)) {
+            }
+        }
+        pthread_setspecific(metrics_key, s);
+        metrics_local = s;
+    }
+    return metrics_local;
+}
+
+// 单写者的计数器：无需原子读改写指令
+static inline void metrics_add(_Atomic unsigned long long* p, unsigned long long d) {
+    atomic_store_explicit(p, atomic_load_explicit(p, memory_order_relaxed) + d, memory_order_relaxed);
+}
+
+// 开始计时；未启用时返回-1，对应的metrics_record不做任何事
+static inline long long metrics_start(void) {
+    return atomic_load_explicit(&metrics_on, memory_order_relaxed) ? monotonic_ns() : -1;
+}
+
+void metrics_record(SolverEngine engine, int rows, int cols, long long start_ns,
+                    long long augmentations, long long infeasible_rows, bool failed) {
+    if (start_ns < 0) {
+        return;
+    }
+    long long elapsed = monotonic_ns() - start_ns;
+    MetricsShard* s = metrics_shard();
+    if (s == NULL) {
+        return;
+    }
+    unsigned long long cells = (unsigned long long)rows * (unsigned long long)cols;
+    metrics_add(&s->calls[engine], 1);
+    metrics_add(&s->failures[engine], failed);
+    metrics_add(&s->cells[engine], cells);
+    if (cells > atomic_load_explicit(&s->max_cells[engine], memory_order_relaxed)) {
+        atomic_store_explicit(&s->max_cells[engine], cells, memory_order_relaxed);
+    }
+    metrics_add(&s->augmentations[engine], (unsigned long long)augmentations);
+    metrics_add(&s->infeasible_rows[engine], (unsigned long long)infeasible_rows);
+    metrics_add(&s->latency_sum_ns[engine], (unsigned long long)elapsed);
+    metrics_add(&s->latency[engine][metrics_bucket((unsigned long long)elapsed)], 1);
+}
+
+// 无锁汇总所有分片（各计数器可能来自略有先后的时刻，但单调不减）
+void metrics_snapshot(MetricsSnapshot* out) {
+    memset(out, 0, sizeof(*out));
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    out->unix_ms = (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+    for (MetricsShard* s = atomic_load(&metrics_shards); s != NULL; s = s->next) {
+        for (int e = 0; e < ENGINE_COUNT; e++) {
+            EngineMetrics* m = &out->engine[e];
+            m->calls += atomic_load_explicit(&s->calls[e], memory_order_relaxed);
+            m->failures += atomic_load_explicit(&s->failures[e], memory_order_relaxed);
+            m->cells += atomic_load_explicit(&s->cells[e], memory_order_relaxed);
+            unsigned long long mc = atomic_load_explicit(&s->max_cells[e], memory_order_relaxed);
+            m->max_cells = mc > m->max_cells ? mc : m->max_cells;
+            m->augmentations += atomic_load_explicit(&s->augmentations[e], memory_order_relaxed);
+            m->infeasible_rows += atomic_load_explicit(&s->infeasible_rows[e], memory_order_relaxed);
+            m->latency_sum_ns += atomic_load_explicit(&s->latency_sum_ns[e], memory_order_relaxed);
+            for (int b = 0; b < METRICS_BUCKETS; b++) {
+                m->latency[b] += atomic_load_explicit(&s->latency[e][b], memory_order_relaxed);
+            }
+        }
+    }
+}
+
+// 当前已分配的分片数（线程退出后分片归还复用，不随线程数增长）
+int metrics_shard_count(void) {
+    int n = 0;
+    for (MetricsShard* s = atomic_load(&metrics_shards); s != NULL; s = s->next) {
+        n++;
+    }
+    return n;
+}
+
+// 延迟分位数（返回所在桶的上界，相对误差不超过1/8）
+double metrics_quantile_ns(const EngineMetrics* m, double q) {
+    unsigned long long total = 0;
+    for (int b = 0; b < METRICS_BUCKETS; b++) {
+        total += m->latency[b];
+    }
+    if (total == 0) {
+        return 0.0;
+    }
+    unsigned long long rank = (unsigned long long)ceil(q * (double)total), seen = 0;
+    rank = rank < 1 ? 1 : rank;
+    for (int b = 0; b < METRICS_BUCKETS; b++) {
+        seen += m->latency[b];
+        if (seen >= rank) {
+            return (double)metrics_bucket_upper(b);
+        }
+    }
+    return (double)metrics_bucket_upper(METRICS_BUCKETS - 1);
+}
+
+// Prometheus文本格式；直方图按2的幂纳秒（约1us到34s）输出累积桶
+int metrics_write_prometheus(FILE* f, const MetricsSnapshot* snap) {
+    static const struct {
+        const char* name;
+        const char* help;
+        size_t offset;
+    } counters[] = {
+        {"munkres_solves_total", "Number of solves", offsetof(EngineMetrics, calls)},
+        {"munkres_solve_failures_total", "Solves that returned an error or found no feasible assignment", offsetof(EngineMetrics, failures)},
+        {"munkres_matrix_cells_total", "Sum of rows * cols over solves", offsetof(EngineMetrics, cells)},
+        {"munkres_augmentations_total", "Augmenting paths applied", offsetof(EngineMetrics, augmentations)},
+        {"munkres_infeasible_rows_total", "Rows left unassigned because no allowed column was reachable", offsetof(EngineMetrics, infeasible_rows)},
+    };
+    for (size_t k = 0; k < sizeof(counters) / sizeof(counters[0]); k++) {
+        fprintf(f, "# HELP %s %s\n# TYPE %s counter\n", counters[k].name, counters[k].help, counters[k].name);
+        for (int e = 0; e < ENGINE_COUNT; e++) {
+            const unsigned long long* v = (const unsigned long long*)((const char*)&snap->engine[e] + counters[k].offset);
+            fprintf(f, "%s{engine=\"%s\"} %llu\n", counters[k].name, engine_names[e], *v);
+        }
+    }
+    fprintf(f, "# HELP munkres_matrix_cells_max Largest rows * cols seen\n# TYPE munkres_matrix_cells_max gauge\n");
+    for (int e = 0; e < ENGINE_COUNT; e++) {
+        fprintf(f, "munkres_matrix_cells_max{engine=\"%s\"} %llu\n", engine_names[e], snap->engine[e].max_cells);
+    }
+    fprintf(f, "# HELP munkres_solve_latency_seconds Solve latency\n# TYPE munkres_solve_latency_seconds histogram\n");
+    for (int e = 0; e < ENGINE_COUNT; e++) {
+        const EngineMetrics* m = &snap->engine[e];
+        unsigned long long cumulative = 0;
+        int b = 0;
+        for (int p = 10; p <= 35; p++) {
+            while (b < METRICS_BUCKETS && metrics_bucket_upper(b) <= (1ULL << p)) {
+                cumulative += m->latency[b++];
+            }
+            fprintf(f, "munkres_solve_latency_seconds_bucket{engine=\"%s\",le=\"%.9g\"} %llu\n",
+                    engine_names[e], (double)(1ULL << p) * 1e-9, cumulative);
+        }
+        // +Inf与_count取全部桶之和而不是calls：两者分开读取，汇总期间的新记录会让calls与桶不一致
+        while (b < METRICS_BUCKETS) {
+            cumulative += m->latency[b++];
+        }
+        fprintf(f, "munkres_solve_latency_seconds_bucket{engine=\"%s\",le=\"+Inf\"} %llu\n", engine_names[e], cumulative);
+        fprintf(f, "munkres_solve_latency_seconds_sum{engine=\"%s\"} %.9f\n", engine_names[e], m->latency_sum_ns * 1e-9);
+        fprintf(f, "munkres_solve_latency_seconds_count{engine=\"%s\"} %llu\n", engine_names[e], cumulative);
+    }
+    return ferror(f) ? -1 : 0;
+}
+
+// JSON Lines：每次汇总输出一行，只包含被调用过的引擎
+int metrics_write_json(FILE* f, const MetricsSnapshot* snap) {
+    fprintf(f, "{\"ts_ms\":%lld,\"engines\":{", snap->unix_ms);
+    bool first = true;
+    for (int e = 0; e < ENGINE_COUNT; e++) {
+        const EngineMetrics* m = &snap->engine[e];
+        if (m->calls == 0) {
+            continue;
+        }
+        fprintf(f, "%s\"%s\":{\"calls\":%llu,\"failures\":%llu,\"cells\":%llu,\"max_cells\":%llu,"
+                   "\"augmentations\":%llu,\"infeasible_rows\":%llu,\"mean_ns\":%.0f,"
+                   "\"p50_ns\":%.0f,\"p90_ns\":%.0f,\"p99_ns\":%.0f,\"max_ns\":%.0f}",
+                first ? "" : ",", engine_names[e], m->calls, m->failures, m->cells, m->max_cells,
+                m->augmentations, m->infeasible_rows, (double)m->latency_sum_ns / m->calls,
+                metrics_quantile_ns(m, 0.5), metrics_quantile_ns(m, 0.9), metrics_quantile_ns(m, 0.99),
+                metrics_quantile_ns(m, 1.0));
+        first = false;
+    }
+    fprintf(f, "}}\n");
+    return ferror(f) ? -1 : 0;
+}
+
+// 汇总并写出一次，返回0成功，-1失败
+int metrics_dump(const char* path, MetricsFormat format) {
+    MetricsSnapshot* snap = malloc(sizeof(MetricsSnapshot));
+    if (snap == NULL) {
+        return -1;
+    }
+    metrics_snapshot(snap);
+    int rc = -1;
+    if (format == METRICS_JSON_LINES) {
+        FILE* f = fopen(path, "a");
+        if (f != NULL) {
+            rc = metrics_write_json(f, snap);
+            rc = fclose(f) == 0 ? rc : -1;
+        }
+    } else {
+        char tmp[4096];
+        if (snprintf(tmp, sizeof(tmp), "%s.tmp", path) < (int)sizeof(tmp)) {
+            FILE* f = fopen(tmp, "w");
+            if (f != NULL) {
+                rc = metrics_write_prometheus(f, snap);
+                rc = fclose(f) == 0 ? rc : -1;
+                rc = rc == 0 && rename(tmp, path) == 0 ? 0 : -1;
+            }
+        }
+    }
+    free(snap);
+    return rc;
+}
+
+static void* metrics_exporter_main(void* p) {
+    MetricsExporter* e = p;
+    pthread_mutex_lock(&e->lock);
+    while (!e->stop) {
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        long long ns = ts.tv_nsec + (long long)e->interval_ms * 1000000LL;
+        ts.tv_sec += ns / 1000000000LL;
+        ts.tv_nsec = ns % 1000000000LL;
+        pthread_cond_timedwait(&e->cond, &e->lock, &ts);
+        pthread_mutex_unlock(&e->lock);
+        metrics_dump(e->path, e->format);
+        pthread_mutex_lock(&e->lock);
+    }
+    pthread_mutex_unlock(&e->lock);
+    return NULL;
+}
+
+// 启动周期导出（path需在导出期间保持有效），同时启用指标收集。返回0成功，-1失败
+int metrics_exporter_start(MetricsExporter* e, const char* path, MetricsFormat format, int interval_ms) {
+    e->stop = false;
+    e->path = path;
+    e->format = format;
+    e->interval_ms = interval_ms > 0 ? interval_ms : 1000;
+    pthread_mutex_init(&e->lock, NULL);
+    pthread_cond_init(&e->cond, NULL);
+    metrics_enable(true);
+    if (pthread_create(&e->thread, NULL, metrics_exporter_main, e) != 0) {
+        pthread_mutex_destroy(&e->lock);
+        pthread_cond_destroy(&e->cond);
+        return -1;
+    }
+    return 0;
+}
+
+// 停止导出线程（退出前会再写出一次）
+void metrics_exporter_stop(MetricsExporter* e) {
+    pthread_mutex_lock(&e->lock);
+    e->stop = true;
+    pthread_cond_signal(&e->cond);
+    pthread_mutex_unlock(&e->lock);
+    pthread_join(e->thread, NULL);
+    pthread_mutex_destroy(&e->lock);
+    pthread_cond_destroy(&e->cond);
+}
+
+// 预算耗尽时：保留星号零构成的部分匹配，按约化成本从小到大贪心补全其余行。
+// 不会选DISALLOWED元素：只剩DISALLOWED可选的行保持未分配
+static void complete_greedy(Munkres* munkres) {
+    erase_primes(munkres);
+    clear_covers(munkres);
+    for (int i = 0; i < munkres->n; i++) {
+        int j = find_star_in_row(munkres, i);
+        if (j != -1) {
+            munkres->row_covered[i] = true;
+            munkres->col_covered[j] = true;
+        }
+    }
+    while (1) {
+        int best_r = -1, best_c = -1;
+        float best = 0.0;
+        for (int i = 0; i < munkres->n; i++) {
+            if (munkres->row_covered[i]) {
+                continue;
+            }
+            for (int j = 0; j < munkres->n; j++) {
+                if (!munkres->col_covered[j] && !IS_DISALLOWED(munkres->C[i][j]) &&
+                    (best_r == -1 || munkres->C[i][j] < best)) {
+                    best = munkres->C[i][j];
+                    best_r = i;
+                    best_c = j;
+                }
+            }
+        }
+        if (best_r == -1) {
+            break;
+        }
+        munkres->marked[best_r][best_c] = STARRED;
+        munkres->row_covered[best_r] = true;
+        munkres->col_covered[best_c] = true;
+    }
+    clear_covers(munkres);
+}
+
+// 执行当前步骤并前进到下一步，返回新的步骤号；无解或步骤号无效时结束并返回-1
+static int munkres_step(Munkres* munkres) {
+    munkres->iterations++;
+    switch (munkres->step) {
+        case 1:
+            munkres->step = step1(munkres);
+            break;
+        case 2:
+            munkres->step = munkres->max_matching_init ? step2_max_matching(munkres) : step2(munkres);
+            break;
+        case 3:
+            munkres->step = step3(munkres);
+            break;
+        case 4:
+            munkres->step = step4(munkres);
+            break;
+        case 5:
+            munkres->step = step5(munkres, &munkres->step); // 正确传递步骤变量的地址
+            munkres->augmentations++;
+            break;
+        case 6:
+            munkres->step = step6(munkres);
+            break;
+        default:
+            munkres->step = -1;
+            break;
+    }
+    if (munkres->step < 0) {
+        munkres->step = 7; // 无解或步骤号无效：结束，由调用方报告失败
+        return -1;
+    }
+    return munkres->step;
+}
+
+// 带预算执行Munkres算法；budget为NULL时不限。report可为NULL
+// 约化矩阵满足 C = 原矩阵 - 已减去的行/列量 且 C >= 0，因此任意完美匹配的成本
+// = lower_bound + 匹配位置上C之和，后者即为最优性间隙。
+// 从munkres->step继续执行，因此也可以接在munkres_run_for之后完成剩余步骤
+SolveStatus compute_budget(Munkres* munkres, const SolveBudget* budget, SolveReport* report) {
+    long long start_iterations = munkres->iterations, start_augmentations = munkres->augmentations;
+    long long t0 = metrics_start();
+    SolveStatus status = SOLVE_OPTIMAL;
+    while (munkres->step != 7) { // 7 是 DONE
+        if (budget != NULL && munkres->step != 1 && munkres->step != 2) {
+            long long iterations = munkres->iterations - start_iterations;
+            if ((budget->max_iterations > 0 && iterations >= budget->max_iterations) ||
+                (budget->deadline_ns > 0 && monotonic_ns() >= budget->deadline_ns)) {
+                complete_greedy(munkres);
+                munkres->step = 7;
+                status = SOLVE_BUDGET_EXPIRED;
+                break;
+            }
+        }
+        if (munkres_step(munkres) < 0) {
+            status = SOLVE_FAILED;
+        }
+    }
+
+    if (report != NULL) {
+        report->status = status;
+        report->iterations = munkres->iterations - start_iterations;
+        report->lower_bound = munkres->lower_bound;
+        report->gap = 0.0;
+        report->matched = 0;
+        double partial_cost = 0.0;
+        for (int i = 0; i < munkres->n; i++) {
+            int j = find_star_in_row(munkres, i);
+            if (j != -1) {
+                report->gap += munkres->C[i][j];
+                // C有限而original_C为DISALLOWED的是填充位置，成本为0
+                partial_cost += IS_DISALLOWED(munkres->original_C[i][j]) ? 0.0 : munkres->original_C[i][j];
+                report->matched++;
+            }
+        }
+        // 约化成本恒等式只对完美匹配成立；不完整时直接累加原成本
+        if (report->matched == munkres->n) {
+            report->cost = report->lower_bound + report->gap;
+        } else {
+            report->cost = partial_cost;
+            report->gap = INFINITY;
+        }
+    }
+    metrics_record(ENGINE_MUNKRES, munkres->n, munkres->n, t0, munkres->augmentations - start_augmentations, 0,
+                   status == SOLVE_FAILED);
+    return status;
+}
+
+// 执行Munkres算法。返回0成功，-1无解（某行全为DISALLOWED或不存在避开DISALLOWED的完美匹配）
+int compute(Munkres* munkres) {
+    return compute_budget(munkres, NULL, NULL) == SOLVE_FAILED ? -1 : 0;
+}
+
+// 最多执行max_iterations步（0表示不限），deadline_ns > 0 时到达monotonic_ns()上的该时刻也返回。
+// 至少执行一步。结束时按累计运行时间记录指标
+RunStatus munkres_run_slice(Munkres* munkres, long long max_iterations, long long deadline_ns) {
+    if (munkres->step == 7) {
+        return RUN_DONE;
+    }
+    long long t0 = monotonic_ns();
+    long long done = 0;
+    bool failed = false;
+    while (munkres->step != 7) {
+        if (done > 0 && ((max_iterations > 0 && done >= max_iterations) ||
+                         (deadline_ns > 0 && monotonic_ns() >= deadline_ns))) {
+            break;
+        }
+        failed = munkres_step(munkres) < 0 || failed;
+        done++;
+    }
+    munkres->active_ns += monotonic_ns() - t0;
+    if (munkres->step != 7) {
+        return RUN_IN_PROGRESS;
+    }
+    long long start = metrics_start();
+    metrics_record(ENGINE_MUNKRES, munkres->n, munkres->n, start < 0 ? -1 : start - munkres->active_ns,
+                   munkres->augmentations, 0, failed);
+    return failed ? RUN_FAILED : RUN_DONE;
+}
+
+// 可恢复地执行至多n_iterations步：返回RUN_IN_PROGRESS时可在任意线程上再次调用继续
+RunStatus munkres_run_for(Munkres* munkres, long long n_iterations) {
+    return munkres_run_slice(munkres, n_iterations > 0 ? n_iterations : 1, 0);
+}
+
+// 获取配对结果
+int get_results(Munkres* munkres, Assignment results[], int original_rows, int original_cols) {
+    int count = 0;
+    for (int i = 0; i < original_rows; i++) {
+        for (int j = 0; j < original_cols; j++) {
+            if (munkres->marked[i][j] == STARRED) {
+                results[count].row = i;
+                results[count].col = j;
+                count++;
+            }
+        }
+    }
+    return count;
+}
+
+// 计算总成本基于原始成本矩阵
+float calculate_total_cost(Munkres* munkres, Assignment results[], int count) {
+    float total = 0.0;
+    for (int i = 0; i < count; i++) {
+        int r = results[i].row;
+        int c = results[i].col;
+        if (munkres->original_C[r][c] != DISALLOWED_VAL) {
+            total += munkres->original_C[r][c];
+        }
+    }
+    return total;
+}
+
+#define DEFINE_TINY_SOLVER(N)                                                     \
+    static float solve_tiny_##N(const float* c, int* assign) {                    \
+        float dp[1 << N];                                                         \
+        unsigned char choice[1 << N];                                             \
+        dp[0] = 0.0f;                                                             \
+        for (int mask = 1; mask < (1 << N); mask++) {                             \
+            dp[mask] = INFINITY;                                                  \
+        }                                                                         \
+        for (int mask = 0; mask < (1 << N) - 1; mask++) {                         \
+            if (dp[mask] == INFINITY) {                                           \
+                continue;                                                         \
+            }                                                                     \
+            const float* row = c + __builtin_popcount(mask) * N;                  \
+            for (int j = 0; j < N; j++) {                                         \
+                int next = mask | (1 << j);                                       \
+                float v = dp[mask] + row[j];                                      \
+                if (!(mask & (1 << j)) && v < dp[next]) {                         \
+                    dp[next] = v;                                                 \
+                    choice[next] = (unsigned char)j;                              \
+                }                                                                 \
+            }                                                                     \
+        }                                                                         \
+        int mask = (1 << N) - 1;                                                  \
+        if (dp[mask] == INFINITY) {                                               \
+            return INFINITY;                                                      \
+        }                                                                         \
+        for (int r = N - 1; r >= 0; r--) {                                        \
+            assign[r] = choice[mask];                                             \
+            mask ^= 1 << assign[r];                                               \
+        }                                                                         \
+        return dp[(1 << N) - 1];                                                  \
+    }
+
+DEFINE_TINY_SOLVER(1)
+DEFINE_TINY_SOLVER(2)
+DEFINE_TINY_SOLVER(3)
+DEFINE_TINY_SOLVER(4)
+DEFINE_TINY_SOLVER(5)
+DEFINE_TINY_SOLVER(6)
+DEFINE_TINY_SOLVER(7)
+DEFINE_TINY_SOLVER(8)
+
+static const TinySolver tiny_solvers[TINY_MAX_SIZE + 1] = {
+    NULL, solve_tiny_1, solve_tiny_2, solve_tiny_3, solve_tiny_4,
+    solve_tiny_5, solve_tiny_6, solve_tiny_7, solve_tiny_8
+};
+
+// 小规模求解：就地填充为n x n（填充值0，DISALLOWED为+inf），不经过Munkres工作区
+// 返回配对数，-1表示规模过大或不存在避开DISALLOWED的完美匹配
+static int solve_tiny_run(float input_matrix[][MAX_SIZE], int input_rows, int input_cols, Assignment results[]) {
+    int n = input_rows > input_cols ? input_rows : input_cols;
+    if (n < 1 || n > TINY_MAX_SIZE) {
+        return -1;
+    }
+    float c[TINY_MAX_SIZE * TINY_MAX_SIZE];
+    int assign[TINY_MAX_SIZE];
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            float v = i < input_rows && j < input_cols ? input_matrix[i][j] : 0.0f;
+            c[i * n + j] = IS_DISALLOWED(v) ? INFINITY : v;
+        }
+    }
+    if (tiny_solvers[n](c, assign) == INFINITY) {
+        return -1;
+    }
+    int count = 0;
+    for (int i = 0; i < input_rows; i++) {
+        if (assign[i] < input_cols) {
+            results[count].row = i;
+            results[count].col = assign[i];
+            count++;
+        }
+    }
+    return count;
+}
+
+int solve_tiny(float input_matrix[][MAX_SIZE], int input_rows, int input_cols, Assignment results[]) {
+    long long t0 = metrics_start();
+    int count = solve_tiny_run(input_matrix, input_rows, input_cols, results);
+    metrics_record(ENGINE_TINY, input_rows, input_cols, t0, count > 0 ? count : 0, 0, count < 0);
+    return count;
+}
+
+// 封装的匹配函数：n <= TINY_MAX_SIZE 时自动走专用求解器，否则走Munkres。
+// 含DISALLOWED时改用lap_solve：两条路径都返回不含DISALLOWED的最小成本最大匹配。返回0成功，-1内存不足
+int hungarian_match(float input_matrix[][MAX_SIZE], int input_rows, int input_cols, Assignment results[], int* result_count, float* total_cost) {
+    bool has_disallowed = false;
+    for (int i = 0; i < input_rows && !has_disallowed; i++) {
+        for (int j = 0; j < input_cols; j++) {
+            if (IS_DISALLOWED(input_matrix[i][j])) {
+                has_disallowed = true;
+                break;
+            }
+        }
+    }
+    if (has_disallowed) {
+        // 专用求解器只接受完美匹配，Munkres在无完美匹配时失败：由最短增广路求最大匹配
+        CostView view = cost_view_dense(&input_matrix[0][0], input_rows, input_cols, MAX_SIZE);
+        LapWorkspace ws;
+        lap_workspace_init(&ws);
+        if (lap_solve(&view, &ws) != 0) {
+            lap_workspace_free(&ws);
+            return -1;
+        }
+        *result_count = lap_get_results(&ws, results);
+        *total_cost = lap_total_cost(&view, &ws);
+        lap_workspace_free(&ws);
+        return 0;
+    }
+
+    int n = input_rows > input_cols ? input_rows : input_cols;
+    if (n <= TINY_MAX_SIZE) {
+        int count = solve_tiny(input_matrix, input_rows, input_cols, results);
+        if (count < 0) {
+            return -1;
+        }
+        *result_count = count;
+        *total_cost = 0.0;
+        for (int k = 0; k < count; k++) {
+            *total_cost += input_matrix[results[k].row][results[k].col];
+        }
+        return 0;
+    }
+
+    Munkres munkres;
+    pad_matrix(&munkres, input_matrix, input_rows, input_cols);
+    initialize(&munkres);
+    munkres.verbose = false;
+    if (compute_budget(&munkres, NULL, NULL) != SOLVE_OPTIMAL) {
+        return -1; // 匹配失败
+    }
+    *result_count = get_results(&munkres, results, input_rows, input_cols);
+    *total_cost = calculate_total_cost(&munkres, results, *result_count);
+    return 0; // 匹配成功
+}
+
+static inline vfloat vf_load(const float* p) {
+    vfloat v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline void vf_store(float* p, vfloat v) {
+    memcpy(p, &v, sizeof(v));
+}
+
+static inline vfloat vf_set1(float x) {
+    vfloat v;
+    for (int k = 0; k < VEC_WIDTH; k++) {
+        v[k] = x;
+    }
+    return v;
+}
+
+static inline vfloat vf_select(vmask mask, vfloat a, vfloat b) {
+    return (vfloat)((mask & (vmask)a) | (~mask & (vmask)b));
+}
+
+static inline vfloat vf_min(vfloat a, vfloat b) {
+    return vf_select(a < b, a, b);
+}
+
+static inline vfloat vf_max(vfloat a, vfloat b) {
+    return vf_select(a > b, a, b);
+}
+
+static inline bool vm_any(vmask m) {
+    // 按64位合并后只判断一次，避免逐通道分支
+    uint64_t w[VEC_WIDTH / 2], any = 0;
+    memcpy(w, &m, sizeof(w));
+    for (int l = 0; l < VEC_WIDTH / 2; l++) {
+        any |= w[l];
+    }
+    return any != 0;
+}
+
+void sparse_cost_init(SparseCost* s) {
+    memset(s, 0, sizeof(*s));
+}
+
+void sparse_cost_free(SparseCost* s) {
+    free(s->row_ptr);
+    free(s->col_idx);
+    free(s->cost);
+    sparse_cost_init(s);
+}
+
+// 预留空间，返回0成功，-1内存不足
+int sparse_cost_reserve(SparseCost* s, int rows, int nnz) {
+    if (rows + 1 > s->row_capacity) {
+        int* p = realloc(s->row_ptr, sizeof(int) * (rows + 1));
+        if (p == NULL) {
+            return -1;
+        }
+        s->row_ptr = p;
+        s->row_capacity = rows + 1;
+    }
+    if (nnz > s->capacity) {
+        int* idx = realloc(s->col_idx, sizeof(int) * nnz);
+        if (idx == NULL) {
+            return -1;
+        }
+        s->col_idx = idx;
+        float* c = realloc(s->cost, sizeof(float) * nnz);
+        if (c == NULL) {
+            return -1;
+        }
+        s->cost = c;
+        s->capacity = nnz;
+    }
+    return 0;
+}
+
+// 转置（CSR -> CSC），结果每行内列索引仍升序
+int sparse_transpose(const SparseCost* in, SparseCost* out) {
+    if (sparse_cost_reserve(out, in->cols, in->nnz) != 0) {
+        return -1;
+    }
+    out->rows = in->cols;
+    out->cols = in->rows;
+    out->nnz = in->nnz;
+    memset(out->row_ptr, 0, sizeof(int) * (out->rows + 1));
+    for (int k = 0; k < in->nnz; k++) {
+        out->row_ptr[in->col_idx[k] + 1]++;
+    }
+    for (int j = 0; j < out->rows; j++) {
+        out->row_ptr[j + 1] += out->row_ptr[j];
+    }
+    for (int i = 0; i < in->rows; i++) {
+        for (int k = in->row_ptr[i]; k < in->row_ptr[i + 1]; k++) {
+            int pos = out->row_ptr[in->col_idx[k]]++;
+            out->col_idx[pos] = i;
+            out->cost[pos] = in->cost[k];
+        }
+    }
+    // 还原行偏移
+    for (int j = out->rows; j > 0; j--) {
+        out->row_ptr[j] = out->row_ptr[j - 1];
+    }
+    out->row_ptr[0] = 0;
+    return 0;
+}
+
+static inline void cost_track_prepare(const BoxSet* tracks, int i, const BoxSet* dets, const CostParams* p, CostTrack* t) {
+    t->use_cos = tracks->emb != NULL && dets->emb != NULL && tracks->emb_dim == dets->emb_dim &&
+                 (p->w_cos != 0.0f || p->max_cos > 0.0f);
+    t->use_maha = tracks->cov_xx != NULL && (p->w_maha != 0.0f || p->max_maha > 0.0f);
+    t->x1 = tracks->x[i];
+    t->y1 = tracks->y[i];
+    t->x2 = t->x1 + tracks->w[i];
+    t->y2 = t->y1 + tracks->h[i];
+    t->area = tracks->w[i] * tracks->h[i];
+    t->cx = t->x1 + 0.5f * tracks->w[i];
+    t->cy = t->y1 + 0.5f * tracks->h[i];
+    t->ia = t->ib = t->ic = 0.0f;
+    t->gated = false;
+    if (t->use_maha) {
+        float a = tracks->cov_xx[i], b = tracks->cov_xy[i], c = tracks->cov_yy[i];
+        float det = a * c - b * b;
+        if (det > 0.0f && a > 0.0f) {
+            t->ia = c / det;
+            t->ib = -b / det;
+            t->ic = a / det;
+        } else {
+            t->gated = true;
+        }
+    }
+    t->min_iou = p->min_iou > 0.0f ? p->min_iou : -1.0f;
+    t->max_maha = p->max_maha > 0.0f ? p->max_maha : FLT_MAX;
+    t->max_cos = p->max_cos > 0.0f ? p->max_cos : FLT_MAX;
+}
+
+// 单个配对的标量代价；dot为外观特征内积（不使用余弦项时忽略）
+static inline float cost_pair_scalar(const CostTrack* t, const BoxSet* dets, int j, float dot, const CostParams* p) {
+    float dx1 = dets->x[j], dy1 = dets->y[j];
+    float dx2 = dx1 + dets->w[j], dy2 = dy1 + dets->h[j];
+    float iw = fmaxf(fminf(dx2, t->x2) - fmaxf(dx1, t->x1), 0.0f);
+    float ih = fmaxf(fminf(dy2, t->y2) - fmaxf(dy1, t->y1), 0.0f);
+    float inter = iw * ih;
+    float uni = t->area + dets->w[j] * dets->h[j] - inter;
+    float iou = uni > 0.0f ? inter / uni : 0.0f;
+    float cost = p->w_iou * (1.0f - iou);
+    bool gated = t->gated || iou < t->min_iou;
+    if (t->use_maha) {
+        float ex = dx1 + 0.5f * dets->w[j] - t->cx;
+        float ey = dy1 + 0.5f * dets->h[j] - t->cy;
+        float d2 = t->ia * ex * ex + 2.0f * t->ib * ex * ey + t->ic * ey * ey;
+        cost += p->w_maha * d2;
+        gated = gated || d2 > t->max_maha;
+    }
+    if (t->use_cos) {
+        float cd = 1.0f - dot;
+        cost += p->w_cos * cd;
+        gated = gated || cd > t->max_cos;
+    }
+    return gated ? DISALLOWED_VAL : cost;
+}
+
+// 计算目标i到所有观测的代价，门控的位置写入DISALLOWED_VAL
+static void cost_row_kernel(const BoxSet* tracks, int i, const BoxSet* dets, const CostParams* p, float* out) {
+    int nd = dets->count;
+    CostTrack t;
+    cost_track_prepare(tracks, i, dets, p, &t);
+    if (t.gated) {
+        for (int j = 0; j < nd; j++) {
+            out[j] = DISALLOWED_VAL;
+        }
+        return;
+    }
+
+    // 余弦相似度先累加到out中（维度主序，按观测方向向量化）
+    if (t.use_cos) {
+        for (int j = 0; j < nd; j++) {
+            out[j] = 0.0f;
+        }
+        for (int k = 0; k < tracks->emb_dim; k++) {
+            float e = tracks->emb[(size_t)k * tracks->count + i];
+            const float* d = dets->emb + (size_t)k * nd;
+            int j = 0;
+            for (; j + VEC_WIDTH <= nd; j += VEC_WIDTH) {
+                vf_store(out + j, vf_load(out + j) + vf_set1(e) * vf_load(d + j));
+            }
+            for (; j < nd; j++) {
+                out[j] += e * d[j];
+            }
+        }
+    }
+
+    int j = 0;
+    for (; j + VEC_WIDTH <= nd; j += VEC_WIDTH) {
+        vfloat dx1 = vf_load(dets->x + j), dy1 = vf_load(dets->y + j);
+        vfloat dw = vf_load(dets->w + j), dh = vf_load(dets->h + j);
+        vfloat dx2 = dx1 + dw, dy2 = dy1 + dh;
+        vfloat zero = vf_set1(0.0f);
+        vfloat iw = vf_max(vf_min(dx2, vf_set1(t.x2)) - vf_max(dx1, vf_set1(t.x1)), zero);
+        vfloat ih = vf_max(vf_min(dy2, vf_set1(t.y2)) - vf_max(dy1, vf_set1(t.y1)), zero);
+        vfloat inter = iw * ih;
+        vfloat uni = vf_set1(t.area) + dw * dh - inter;
+        vfloat iou = vf_select(uni > zero, inter / vf_max(uni, vf_set1(FLT_MIN)), zero);
+        vfloat cost = vf_set1(p->w_iou) * (vf_set1(1.0f) - iou);
+        vmask gated = iou < vf_set1(t.min_iou);
+        if (t.use_maha) {
+            vfloat ex = dx1 + vf_set1(0.5f) * dw - vf_set1(t.cx);
+            vfloat ey = dy1 + vf_set1(0.5f) * dh - vf_set1(t.cy);
+            vfloat d2 = vf_set1(t.ia) * ex * ex + vf_set1(2.0f * t.ib) * ex * ey + vf_set1(t.ic) * ey * ey;
+            cost += vf_set1(p->w_maha) * d2;
+            gated |= d2 > vf_set1(t.max_maha);
+        }
+        if (t.use_cos) {
+            vfloat cd = vf_set1(1.0f) - vf_load(out + j);
+            cost += vf_set1(p->w_cos) * cd;
+            gated |= cd > vf_set1(t.max_cos);
+        }
+        vf_store(out + j, vf_select(gated, vf_set1(DISALLOWED_VAL), cost));
+    }
+    for (; j < nd; j++) {
+        out[j] = cost_pair_scalar(&t, dets, j, t.use_cos ? out[j] : 0.0f, p);
+    }
+}
+
+// 直接构建到Munkres工作区：一次遍历同时写入C、original_C并完成填充，替代单独建矩阵+pad_matrix
+int build_cost_munkres(Munkres* munkres, const BoxSet* tracks, const BoxSet* dets, const CostParams* p) {
+    int rows = tracks->count, cols = dets->count;
+    int n = rows > cols ? rows : cols;
+    if (n > MAX_SIZE) {
+        return -1;
+    }
+    munkres->n = n;
+    for (int i = 0; i < n; i++) {
+        int j = 0;
+        if (i < rows) {
+            cost_row_kernel(tracks, i, dets, p, munkres->C[i]);
+            memcpy(munkres->original_C[i], munkres->C[i], sizeof(float) * cols);
+            j = cols;
+        }
+        for (; j < n; j++) {
+            munkres->C[i][j] = 0.0; // 填充值为0.0
+            munkres->original_C[i][j] = DISALLOWED_VAL;
+        }
+    }
+    return 0;
+}
+
+// 构建稠密成本矩阵（行主序，行跨度stride）
+void build_cost_dense(float* out, int stride, const BoxSet* tracks, const BoxSet* dets, const CostParams* p) {
+    for (int i = 0; i < tracks->count; i++) {
+        cost_row_kernel(tracks, i, dets, p, out + (size_t)i * stride);
+    }
+}
+
+// 构建稀疏候选列表，只保留通过门控的配对
+int build_cost_sparse(SparseCost* out, const BoxSet* tracks, const BoxSet* dets, const CostParams* p) {
+    int rows = tracks->count, cols = dets->count;
+    float* row = malloc(sizeof(float) * (cols > 0 ? cols : 1));
+    if (row == NULL || sparse_cost_reserve(out, rows, out->capacity > 0 ? out->capacity : rows) != 0) {
+        free(row);
+        return -1;
+    }
+    out->rows = rows;
+    out->cols = cols;
+    out->nnz = 0;
+    out->row_ptr[0] = 0;
+    for (int i = 0; i < rows; i++) {
+        cost_row_kernel(tracks, i, dets, p, row);
+        for (int j = 0; j < cols; j++) {
+            if (IS_DISALLOWED(row[j])) {
+                continue;
+            }
+            if (out->nnz == out->capacity && sparse_cost_reserve(out, rows, out->capacity * 2 + cols) != 0) {
+                free(row);
+                return -1;
+            }
+            out->col_idx[out->nnz] = j;
+            out->cost[out->nnz] = row[j];
+            out->nnz++;
+        }
+        out->row_ptr[i + 1] = out->nnz;
+    }
+    free(row);
+    return 0;
+}
+
+// fp32 -> fp16，最近偶数舍入；有限值溢出时截断为±65504并置*clamped
+uint16_t float_to_half(float f, bool* clamped) {
+    if (IS_DISALLOWED(f)) {
+        return 0x7C00;
+    }
+    uint32_t bits;
+    memcpy(&bits, &f, sizeof(bits));
+    uint16_t sign = (bits >> 16) & 0x8000;
+    if (f != f) {
+        return sign | 0x7E00;
+    }
+    int exp = (int)((bits >> 23) & 0xFF) - 127 + 15;
+    uint32_t mant = bits & 0x7FFFFF;
+    if (exp >= 31) {
+        *clamped = !isinf(f);
+        return sign | (isinf(f) ? 0x7C00 : 0x7BFF);
+    }
+    if (exp <= 0) {
+        if (exp < -10) {
+            return sign;
+        }
+        mant |= 0x800000;
+        int shift = 14 - exp;
+        uint32_t h = mant >> shift;
+        uint32_t rest = mant & ((1u << shift) - 1), half_way = 1u << (shift - 1);
+        if (rest > half_way || (rest == half_way && (h & 1))) {
+            h++; // 进位到指数位时恰好得到最小正规数
+        }
+        return sign | (uint16_t)h;
+    }
+    uint32_t h = ((uint32_t)exp << 10) | (mant >> 13);
+    uint32_t rest = mant & 0x1FFF;
+    if (rest > 0x1000 || (rest == 0x1000 && (h & 1))) {
+        h++;
+    }
+    if (h >= 0x7C00) {
+        *clamped = true;
+        h = 0x7BFF;
+    }
+    return sign | (uint16_t)h;
+}
+
+// fp32 -> bf16，最近偶数舍入；有限值溢出时截断为最大有限值并置*clamped
+uint16_t float_to_bf16(float f, bool* clamped) {
+    if (IS_DISALLOWED(f)) {
+        return 0x7F80;
+    }
+    uint32_t bits;
+    memcpy(&bits, &f, sizeof(bits));
+    if (f != f) {
+        return (uint16_t)((bits >> 16) | 0x40);
+    }
+    uint32_t h = (bits + 0x7FFF + ((bits >> 16) & 1)) >> 16;
+    if ((h & 0x7F80) == 0x7F80 && !isinf(f)) {
+        *clamped = true;
+        h = (h & 0x8000) | 0x7F7F;
+    }
+    return (uint16_t)h;
+}
+
+// 把fp32矩阵编码为半精度（out行跨度out_stride），返回被截断的元素个数
+int half_cost_encode(const float* src, int rows, int cols, int src_stride, HalfFormat fmt, uint16_t* out, int out_stride) {
+    int clamped_count = 0;
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < cols; j++) {
+            bool clamped = false;
+            float c = src[(size_t)i * src_stride + j];
+            out[(size_t)i * out_stride + j] = fmt == HALF_FP16 ? float_to_half(c, &clamped) : float_to_bf16(c, &clamped);
+            clamped_count += clamped;
+        }
+    }
+    return clamped_count;
+}
+
+// 解码n个半精度成本（源步长step个元素）到out
+void half_decode(const uint16_t* src, size_t step, int n, HalfFormat fmt, float* out) {
+    int j = 0;
+    if (step == 1 && fmt == HALF_BF16) {
+        for (; j + VEC_WIDTH <= n; j += VEC_WIDTH) {
+            vhalf h;
+            memcpy(&h, src + j, sizeof(h));
+            vuint bits = __builtin_convertvector(h, vuint) << 16;
+            vf_store(out + j, (vfloat)bits);
+        }
+    }
+#if defined(__F16C__) && defined(__AVX__)
+    if (step == 1 && fmt == HALF_FP16) {
+        for (; j + 8 <= n; j += 8) {
+            _mm256_storeu_ps(out + j, _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(src + j))));
+        }
+    }
+#endif
+    if (step == 1 && fmt == HALF_FP16) {
+        // 无F16C时：指数与尾数移到fp32的位置后乘2^112修正指数偏置（非规格数随之规格化），
+        // inf/NaN置满指数，最后补回符号位
+        for (; j + VEC_WIDTH <= n; j += VEC_WIDTH) {
+            vhalf h;
+            memcpy(&h, src + j, sizeof(h));
+            vuint bits = __builtin_convertvector(h, vuint);
+            vuint mag = (bits & 0x7fffu) << 13;
+            vuint scaled = (vuint)((vfloat)mag * vf_set1(0x1p112f));
+            vuint special = (vuint)(mag >= 0x0f800000u);
+            vuint out_bits = (scaled & ~special) | ((mag | 0x7f800000u) & special);
+            vf_store(out + j, (vfloat)(out_bits | (bits & 0x8000u) << 16));
+        }
+    }
+    if (fmt == HALF_BF16) {
+        for (; j < n; j++) {
+            out[j] = bf16_to_float(src[j * step]);
+        }
+    } else {
+        for (; j < n; j++) {
+            out[j] = half_to_float(src[j * step]);
+        }
+    }
+}
+
+CostView cost_view_dense(const float* data, int rows, int cols, int stride) {
+    CostView v = {COST_DENSE, rows, cols, data, stride, NULL, NULL, NULL, NULL, NULL, HALF_FP16};
+    return v;
+}
+
+CostView cost_view_sparse(const SparseCost* s) {
+    CostView v = {COST_SPARSE, s->rows, s->cols, NULL, 0, s, NULL, NULL, NULL, NULL, HALF_FP16};
+    return v;
+}
+
+// fn必须提供；rows_fn可为NULL，提供时按行求解方向上的缓存缺失整块调用它
+CostView cost_view_callback(int rows, int cols, CostFn fn, CostRowsFn rows_fn, void* arg) {
+    CostView v = {COST_CALLBACK, rows, cols, NULL, 0, NULL, fn, rows_fn, arg, NULL, HALF_FP16};
+    return v;
+}
+
+// 半精度稠密视图（数据由half_cost_encode生成），内存与带宽为fp32的一半
+CostView cost_view_half(const uint16_t* data, int rows, int cols, int stride, HalfFormat fmt) {
+    CostView v = {COST_HALF, rows, cols, NULL, stride, NULL, NULL, NULL, NULL, data, fmt};
+    return v;
+}
+
+// 读取单个成本
+float cost_view_at(const CostView* view, int i, int j) {
+    if (view->kind == COST_DENSE) {
+        return view->dense[(size_t)i * view->stride + j];
+    }
+    if (view->kind == COST_CALLBACK) {
+        return view->fn(i, j, view->arg);
+    }
+    if (view->kind == COST_HALF) {
+        uint16_t h = view->half[(size_t)i * view->stride + j];
+        return view->half_format == HALF_FP16 ? half_to_float(h) : bf16_to_float(h);
+    }
+    const SparseCost* s = view->sparse;
+    int lo = s->row_ptr[i], hi = s->row_ptr[i + 1] - 1;
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        if (s->col_idx[mid] == j) {
+            return s->cost[mid];
+        }
+        if (s->col_idx[mid] < j) {
+            lo = mid + 1;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return DISALLOWED_VAL;
+}
+
+// 取第i行的全部成本：稠密视图直接返回行指针，半精度与回调视图写入buf（稀疏视图不支持）
+static const float* cost_view_row(const CostView* view, int i, float* buf) {
+    if (view->kind == COST_DENSE) {
+        return view->dense + (size_t)i * view->stride;
+    }
+    if (view->kind == COST_HALF) {
+        half_decode(view->half + (size_t)i * view->stride, 1, view->cols, view->half_format, buf);
+        return buf;
+    }
+    if (view->rows_fn != NULL) {
+        view->rows_fn(i, 1, buf, view->cols, view->arg);
+        return buf;
+    }
+    for (int j = 0; j < view->cols; j++) {
+        buf[j] = view->fn(i, j, view->arg);
+    }
+    return buf;
+}
+
+void row_cache_init(RowCache* c) {
+    memset(c, 0, sizeof(*c));
+    c->slots = ROW_CACHE_SLOTS;
+    c->block = ROW_CACHE_BLOCK;
+}
+
+void row_cache_free(RowCache* c) {
+    free(c->data);
+    free(c->tag);
+    free(c->slot_of);
+    free(c->stamp);
+    row_cache_init(c);
+}
+
+// 设置缓存规模（需在求解前调用），返回0成功，-1参数非法
+int row_cache_configure(RowCache* c, int slots, int block) {
+    if (slots < 1 || block < 1) {
+        return -1;
+    }
+    row_cache_free(c);
+    c->slots = slots;
+    c->block = block;
+    return 0;
+}
+
+// 保证每行能容纳width个成本，返回0成功，-1内存不足
+int row_cache_reserve(RowCache* c, int width) {
+    if (width <= c->width) {
+        return 0;
+    }
+    float* data = realloc(c->data, sizeof(float) * (size_t)c->slots * c->block * width);
+    if (data == NULL) {
+        return -1;
+    }
+    c->data = data;
+    int* tag = realloc(c->tag, sizeof(int) * c->slots);
+    if (tag == NULL) {
+        return -1;
+    }
+    c->tag = tag;
+    unsigned long long* stamp = realloc(c->stamp, sizeof(unsigned long long) * c->slots);
+    if (stamp == NULL) {
+        return -1;
+    }
+    c->stamp = stamp;
+    int blocks = (width + c->block - 1) / c->block;
+    int* slot_of = realloc(c->slot_of, sizeof(int) * blocks);
+    if (slot_of == NULL) {
+        return -1;
+    }
+    c->slot_of = slot_of;
+    c->width = width;
+    for (int k = 0; k < c->slots; k++) {
+        c->tag[k] = -1;
+    }
+    for (int b = 0; b < blocks; b++) {
+        c->slot_of[b] = -1;
+    }
+    return 0;
+}
+
+void row_cache_clear(RowCache* c) {
+    for (int k = 0; c->tag != NULL && k < c->slots; k++) {
+        if (c->tag[k] != -1) {
+            c->slot_of[c->tag[k]] = -1;
+            c->tag[k] = -1;
+        }
+    }
+}
+
+void lap_workspace_init(LapWorkspace* ws) {
+    memset(ws, 0, sizeof(*ws));
+    sparse_cost_init(&ws->csc);
+    row_cache_init(&ws->cache);
+}
+
+void lap_workspace_free(LapWorkspace* ws) {
+    free(ws->u);
+    free(ws->v);
+    free(ws->row_to_col);
+    free(ws->col_to_row);
+    free(ws->dist);
+    free(ws->pred);
+    free(ws->scanned);
+    free(ws->touched);
+    free(ws->visited);
+    free(ws->row_buf);
+    free(ws->order);
+    free(ws->row_mask);
+    free(ws->col_mask);
+    free(ws->row_sel);
+    sparse_cost_free(&ws->csc);
+    row_cache_free(&ws->cache);
+    lap_workspace_init(ws);
+}
+
+// 按问题尺寸预留空间，返回0成功，-1内存不足
+int lap_workspace_reserve(LapWorkspace* ws, int rows, int cols) {
+    int n = rows > cols ? rows : cols;
+    if (n <= ws->capacity) {
+        return 0;
+    }
+    struct {
+        void** ptr;
+        size_t elem;
+    } arrays[] = {
+        {(void**)&ws->u, sizeof(double)},
+        {(void**)&ws->v, sizeof(double)},
+        {(void**)&ws->row_to_col, sizeof(int)},
+        {(void**)&ws->col_to_row, sizeof(int)},
+        {(void**)&ws->dist, sizeof(double)},
+        {(void**)&ws->pred, sizeof(int)},
+        {(void**)&ws->scanned, sizeof(unsigned char)},
+        {(void**)&ws->touched, sizeof(int)},
+        {(void**)&ws->visited, sizeof(int)},
+        {(void**)&ws->row_buf, sizeof(float)},
+        {(void**)&ws->order, sizeof(int)},
+        {(void**)&ws->row_mask, sizeof(unsigned char)},
+        {(void**)&ws->col_mask, sizeof(unsigned char)},
+        {(void**)&ws->row_sel, sizeof(unsigned char)},
+    };
+    for (size_t k = 0; k < sizeof(arrays) / sizeof(arrays[0]); k++) {
+        void* p = realloc(*arrays[k].ptr, arrays[k].elem * n);
+        if (p == NULL) {
+            return -1;
+        }
+        *arrays[k].ptr = p;
+    }
+    for (int k = 0; k < n; k++) {
+        ws->pred[k] = -1;
+        ws->scanned[k] = 0;
+    }
+    ws->capacity = n;
+    return 0;
+}
+
+// 清空匹配与对偶变量
+void lap_reset(LapWorkspace* ws, int rows, int cols) {
+    ws->rows = rows;
+    ws->cols = cols;
+    for (int i = 0; i < rows; i++) {
+        ws->u[i] = 0.0;
+        ws->row_to_col[i] = -1;
+    }
+    for (int j = 0; j < cols; j++) {
+        ws->v[j] = 0.0;
+        ws->col_to_row[j] = -1;
+    }
+    ws->augmentations = 0;
+    ws->infeasible_rows = 0;
+    row_cache_clear(&ws->cache);
+}
+
+void lap_ctx_init(LapCtx* ctx, const CostView* view, LapWorkspace* ws, bool transposed) {
+    ctx->view = view;
+    ctx->ws = ws;
+    ctx->transposed = transposed;
+    ctx->n_rows = transposed ? view->cols : view->rows;
+    ctx->n_cols = transposed ? view->rows : view->cols;
+    ctx->ur = transposed ? ws->v : ws->u;
+    ctx->vc = transposed ? ws->u : ws->v;
+    ctx->r2c = transposed ? ws->col_to_row : ws->row_to_col;
+    ctx->c2r = transposed ? ws->row_to_col : ws->col_to_row;
+    ctx->col_mask = NULL;
+    if (view->kind == COST_CALLBACK && ws->cache.transposed != transposed) {
+        row_cache_clear(&ws->cache);
+        ws->cache.transposed = transposed;
+    }
+}
+
+// 从行缓存取问题方向上的第r行，缺失时按块调用回调并替换最久未用的槽
+static const float* lap_cached_row(LapCtx* ctx, int r) {
+    const CostView* view = ctx->view;
+    RowCache* c = &ctx->ws->cache;
+    int blk = r / c->block;
+    int slot = c->slot_of[blk];
+    c->clock++;
+    if (slot != -1) {
+        c->stamp[slot] = c->clock;
+        c->hits++;
+        return c->data + ((size_t)slot * c->block + r % c->block) * c->width;
+    }
+
+    // 缺失时线性找空槽或最久未用的槽，其代价远小于重新计算一整块
+    slot = 0;
+    for (int k = 1; k < c->slots && c->tag[slot] != -1; k++) {
+        if (c->tag[k] == -1 || c->stamp[k] < c->stamp[slot]) {
+            slot = k;
+        }
+    }
+    c->misses++;
+    if (c->tag[slot] != -1) {
+        c->slot_of[c->tag[slot]] = -1;
+    }
+    c->slot_of[blk] = slot;
+    c->tag[slot] = blk;
+    c->stamp[slot] = c->clock;
+    float* base = c->data + (size_t)slot * c->block * c->width;
+    int begin = blk * c->block;
+    int count = ctx->n_rows - begin < c->block ? ctx->n_rows - begin : c->block;
+    if (!ctx->transposed && view->rows_fn != NULL) {
+        view->rows_fn(begin, count, base, c->width, view->arg);
+    } else {
+        for (int t = 0; t < count; t++) {
+            float* out = base + (size_t)t * c->width;
+            for (int j = 0; j < ctx->n_cols; j++) {
+                out[j] = ctx->transposed ? view->fn(j, begin + t, view->arg) : view->fn(begin + t, j, view->arg);
+            }
+        }
+    }
+    return base + (size_t)(r - begin) * c->width;
+}
+
+// 取问题方向上第r行的成本；*idx为NULL表示稠密行（长度为n_cols）
+static int lap_fetch_row(LapCtx* ctx, int r, const int** idx, const float** val) {
+    const CostView* view = ctx->view;
+    if (view->kind == COST_CALLBACK) {
+        *idx = NULL;
+        *val = lap_cached_row(ctx, r);
+        return ctx->n_cols;
+    }
+    if (view->kind == COST_DENSE) {
+        *idx = NULL;
+        if (!ctx->transposed) {
+            *val = view->dense + (size_t)r * view->stride;
+            return view->cols;
+        }
+        float* buf = ctx->ws->row_buf;
+        for (int i = 0; i < view->rows; i++) {
+            buf[i] = view->dense[(size_t)i * view->stride + r];
+        }
+        *val = buf;
+        return view->rows;
+    }
+    if (view->kind == COST_HALF) {
+        *idx = NULL;
+        *val = ctx->ws->row_buf;
+        if (!ctx->transposed) {
+            half_decode(view->half + (size_t)r * view->stride, 1, view->cols, view->half_format, ctx->ws->row_buf);
+            return view->cols;
+        }
+        half_decode(view->half + r, view->stride, view->rows, view->half_format, ctx->ws->row_buf);
+        return view->rows;
+    }
+    const SparseCost* s = ctx->transposed ? &ctx->ws->csc : view->sparse;
+    int b = s->row_ptr[r];
+    *idx = s->col_idx + b;
+    *val = s->cost + b;
+    return s->row_ptr[r + 1] - b;
+}
+
+// 从未匹配行cur_row出发，按约化成本做Dijkstra并沿最短路径增广
+// 返回0成功，-1表示该行无法到达任何空闲列（保持对偶与匹配不变）
+static int lap_augment(LapCtx* ctx, int cur_row) {
+    LapWorkspace* ws = ctx->ws;
+    double* ur = ctx->ur;
+    double* vc = ctx->vc;
+    int n_touched = 0, n_visited = 0;
+    double min_val = 0.0;
+    int i = cur_row, sink = -1;
+
+    while (sink == -1) {
+        ws->visited[n_visited++] = i;
+        const int* idx;
+        const float* val;
+        int len = lap_fetch_row(ctx, i, &idx, &val);
+        for (int k = 0; k < len; k++) {
+            int j = idx != NULL ? idx[k] : k;
+            float c = val[k];
+            if (IS_DISALLOWED(c) || ws->scanned[j] || (ctx->col_mask != NULL && !ctx->col_mask[j])) {
+                continue;
+            }
+            double r = min_val + c - ur[i] - vc[j];
+            if (ws->pred[j] == -1) {
+                ws->touched[n_touched++] = j;
+                ws->dist[j] = r;
+                ws->pred[j] = i;
+            } else if (r < ws->dist[j]) {
+                ws->dist[j] = r;
+                ws->pred[j] = i;
+            }
+        }
+
+        // 选出距离最小的未出队列，距离相同时优先空闲列
+        int best = -1;
+        double lowest = INFINITY;
+        for (int t = 0; t < n_touched; t++) {
+            int j = ws->touched[t];
+            if (ws->scanned[j]) {
+                continue;
+            }
+            double d = ws->dist[j];
+            if (best == -1 || d < lowest || (d == lowest && ctx->c2r[j] == -1 && ctx->c2r[best] != -1)) {
+                lowest = d;
+                best = j;
+            }
+        }
+        if (best == -1) {
+            for (int t = 0; t < n_touched; t++) {
+                ws->pred[ws->touched[t]] = -1;
+                ws->scanned[ws->touched[t]] = 0;
+            }
+            return -1;
+        }
+        min_val = lowest;
+        ws->scanned[best] = 1;
+        if (ctx->c2r[best] == -1) {
+            sink = best;
+        } else {
+            i = ctx->c2r[best];
+        }
+    }
+
+    // 更新对偶变量，保持已匹配边约化成本为0、其余非负
+    ur[cur_row] += min_val;
+    for (int t = 1; t < n_visited; t++) {
+        int r = ws->visited[t];
+        ur[r] += min_val - ws->dist[ctx->r2c[r]];
+    }
+    for (int t = 0; t < n_touched; t++) {
+        int j = ws->touched[t];
+        if (ws->scanned[j]) {
+            vc[j] -= min_val - ws->dist[j];
+        }
+    }
+
+    // 沿前驱翻转匹配
+    int j = sink;
+    while (1) {
+        int r = ws->pred[j];
+        ctx->c2r[j] = r;
+        int next = ctx->r2c[r];
+        ctx->r2c[r] = j;
+        j = next;
+        if (r == cur_row) {
+            break;
+        }
+    }
+
+    for (int t = 0; t < n_touched; t++) {
+        ws->pred[ws->touched[t]] = -1;
+        ws->scanned[ws->touched[t]] = 0;
+    }
+    return 0;
+}
+
+// 回调成本需要行缓存，两个求解方向共用，按较长的一边分配
+static int lap_cache_reserve(const CostView* view, LapWorkspace* ws) {
+    if (view->kind != COST_CALLBACK) {
+        return 0;
+    }
+    return row_cache_reserve(&ws->cache, view->rows > view->cols ? view->rows : view->cols);
+}
+
+// 求解最小成本分配；行数多于列数时按转置方向求解（等价于pad_matrix的0填充）
+// 返回0成功，-1内存不足；无可行列的行计入infeasible_rows并保持未分配
+static int lap_solve_run(const CostView* view, LapWorkspace* ws) {
+    if (lap_workspace_reserve(ws, view->rows, view->cols) != 0 || lap_cache_reserve(view, ws) != 0) {
+        return -1;
+    }
+    lap_reset(ws, view->rows, view->cols);
+    bool transposed = view->rows > view->cols;
+    ws->csc_source = NULL;
+    if (transposed && view->kind == COST_SPARSE) {
+        if (sparse_transpose(view->sparse, &ws->csc) != 0) {
+            return -1;
+        }
+        ws->csc_source = view->sparse;
+    }
+    LapCtx ctx;
+    lap_ctx_init(&ctx, view, ws, transposed);
+    for (int r = 0; r < ctx.n_rows; r++) {
+        if (lap_augment(&ctx, r) == 0) {
+            ws->augmentations++;
+        } else {
+            ws->infeasible_rows++;
+        }
+    }
+    return 0;
+}
+
+int lap_solve(const CostView* view, LapWorkspace* ws) {
+    long long t0 = metrics_start();
+    int rc = lap_solve_run(view, ws);
+    metrics_record(ENGINE_LAP, view->rows, view->cols, t0, ws->augmentations, ws->infeasible_rows, rc != 0);
+    return rc;
+}
+
+// 热启动求解方阵：沿用ws中上一次同尺寸求解的列对偶，行对偶取 u_i = min_j (c_ij - v_j) 使所有约化成本非负，
+// 上一次的匹配中仍然紧（约化成本为0）的配对保留，只对其余行重新增广。
+// 成本变化不大时（如拉格朗日迭代）大部分配对保留。非方阵或尺寸变化时等同lap_solve
+int lap_solve_warm(const CostView* view, LapWorkspace* ws) {
+    if (view->rows != view->cols || ws->rows != view->rows || ws->cols != view->cols || view->kind == COST_CALLBACK ||
+        ws->capacity < view->rows) {
+        return lap_solve(view, ws);
+    }
+    long long t0 = metrics_start();
+    int n = view->rows;
+    LapCtx ctx;
+    lap_ctx_init(&ctx, view, ws, false);
+    ws->augmentations = 0;
+    ws->infeasible_rows = 0;
+    for (int j = 0; j < n; j++) {
+        ws->col_to_row[j] = -1;
+    }
+    for (int i = 0; i < n; i++) {
+        const int* idx;
+        const float* val;
+        int len = lap_fetch_row(&ctx, i, &idx, &val);
+        double u = INFINITY, tight = INFINITY;
+        for (int k = 0; k < len; k++) {
+            int j = idx != NULL ? idx[k] : k;
+            if (IS_DISALLOWED(val[k])) {
+                continue;
+            }
+            double r = val[k] - ws->v[j];
+            u = r < u ? r : u;
+            if (j == ws->row_to_col[i]) {
+                tight = r;
+            }
+        }
+        ws->u[i] = u == INFINITY ? 0.0 : u;
+        if (tight == u && u != INFINITY) {
+            ws->col_to_row[ws->row_to_col[i]] = i;
+        } else {
+            ws->row_to_col[i] = -1;
+        }
+    }
+    for (int i = 0; i < n; i++) {
+        if (ws->row_to_col[i] != -1) {
+            continue;
+        }
+        if (lap_augment(&ctx, i) == 0) {
+            ws->augmentations++;
+        } else {
+            ws->infeasible_rows++;
+        }
+    }
+    metrics_record(ENGINE_LAP, n, n, t0, ws->augmentations, ws->infeasible_rows, false);
+    return 0;
+}
+
+// 在选中的未匹配行（row_sel非零）与当前空闲列之间求解，不拷贝子矩阵
+// 已有匹配与对偶保持不变；行多于空闲列时按转置方向增广。返回新增匹配数，-1内存不足
+static int lap_solve_subset(const CostView* view, LapWorkspace* ws, const unsigned char* row_sel) {
+    int n_sel = 0, n_free = 0;
+    for (int i = 0; i < view->rows; i++) {
+        ws->row_mask[i] = row_sel[i] && ws->row_to_col[i] == -1;
+        n_sel += ws->row_mask[i];
+    }
+    for (int j = 0; j < view->cols; j++) {
+        ws->col_mask[j] = ws->col_to_row[j] == -1;
+        n_free += ws->col_mask[j];
+    }
+    if (n_sel == 0 || n_free == 0) {
+        return 0;
+    }
+
+    bool transposed = n_sel > n_free;
+    if (transposed && view->kind == COST_SPARSE && ws->csc_source != view->sparse) {
+        if (sparse_transpose(view->sparse, &ws->csc) != 0) {
+            return -1;
+        }
+        ws->csc_source = view->sparse;
+    }
+    LapCtx ctx;
+    lap_ctx_init(&ctx, view, ws, transposed);
+    ctx.col_mask = transposed ? ws->row_mask : ws->col_mask;
+    const unsigned char* start_mask = transposed ? ws->col_mask : ws->row_mask;
+    int n_order = 0;
+    for (int r = 0; r < ctx.n_rows; r++) {
+        if (start_mask[r]) {
+            ws->order[n_order++] = r;
+        }
+    }
+
+    int matched = 0;
+    for (int k = 0; k < n_order; k++) {
+        if (lap_augment(&ctx, ws->order[k]) == 0) {
+            ws->augmentations++;
+            matched++;
+        } else if (!transposed) {
+            ws->infeasible_rows++;
+        }
+    }
+    if (transposed) {
+        ws->infeasible_rows += n_sel - matched;
+    }
+    return matched;
+}
+
+// 级联匹配（DeepSORT风格）：row_level[i]为行的优先级（如time-since-update），
+// 按0..num_levels-1逐级求解，后级只能使用前级剩下的列；各级共用工作区与对偶变量。
+// second_stage非NULL时，再用它（同尺寸，如IoU成本）对 row_level <= second_max_level 的剩余行
+// 与剩余列做一轮匹配。matched_stage（可为NULL）输出每行匹配所在的级别，
+// 第二阶段记为num_levels，未匹配为-1。返回0成功，-1失败
+static int lap_solve_cascade_run(const CostView* view, const int* row_level, int num_levels,
+                                 const CostView* second_stage, int second_max_level,
+                                 LapWorkspace* ws, int* matched_stage) {
+    if (second_stage != NULL && (second_stage->rows != view->rows || second_stage->cols != view->cols)) {
+        return -1;
+    }
+    if (lap_workspace_reserve(ws, view->rows, view->cols) != 0 || lap_cache_reserve(view, ws) != 0 ||
+        (second_stage != NULL && lap_cache_reserve(second_stage, ws) != 0)) {
+        return -1;
+    }
+    lap_reset(ws, view->rows, view->cols);
+    ws->csc_source = NULL;
+    unsigned char* sel = ws->row_sel;
+
+    for (int i = 0; i < view->rows; i++) {
+        if (matched_stage != NULL) {
+            matched_stage[i] = -1;
+        }
+    }
+    for (int level = 0; level < num_levels; level++) {
+        for (int i = 0; i < view->rows; i++) {
+            sel[i] = row_level[i] == level;
+        }
+        if (lap_solve_subset(view, ws, sel) < 0) {
+            return -1;
+        }
+        if (matched_stage != NULL) {
+            for (int i = 0; i < view->rows; i++) {
+                if (sel[i] && ws->row_to_col[i] >= 0 && matched_stage[i] == -1) {
+                    matched_stage[i] = level;
+                }
+            }
+        }
+    }
+
+    if (second_stage != NULL) {
+        // 未匹配的行和列从未被扫描过，对偶仍为0，可直接作为第二阶段的初值
+        for (int i = 0; i < view->rows; i++) {
+            sel[i] = row_level[i] <= second_max_level && ws->row_to_col[i] == -1;
+        }
+        ws->csc_source = NULL;
+        row_cache_clear(&ws->cache);
+        if (lap_solve_subset(second_stage, ws, sel) < 0) {
+            return -1;
+        }
+        if (matched_stage != NULL) {
+            for (int i = 0; i < view->rows; i++) {
+                if (sel[i] && ws->row_to_col[i] >= 0) {
+                    matched_stage[i] = num_levels;
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+int lap_solve_cascade(const CostView* view, const int* row_level, int num_levels,
+                      const CostView* second_stage, int second_max_level,
+                      LapWorkspace* ws, int* matched_stage) {
+    long long t0 = metrics_start();
+    int rc = lap_solve_cascade_run(view, row_level, num_levels, second_stage, second_max_level, ws, matched_stage);
+    metrics_record(ENGINE_CASCADE, view->rows, view->cols, t0, ws->augmentations, ws->infeasible_rows, rc != 0);
+    return rc;
+}
+
+// 部分选择：大小为k的最大堆，堆顶是目前保留的k个中最贵的一个
+static void topk_sift_down(float* key, int* idx, int k, int pos) {
+    while (1) {
+        int l = 2 * pos + 1, r = l + 1, top = pos;
+        if (l < k && key[l] > key[top]) {
+            top = l;
+        }
+        if (r < k && key[r] > key[top]) {
+            top = r;
+        }
+        if (top == pos) {
+            return;
+        }
+        float tk = key[pos];
+        key[pos] = key[top];
+        key[top] = tk;
+        int ti = idx[pos];
+        idx[pos] = idx[top];
+        idx[top] = ti;
+        pos = top;
+    }
+}
+
+// 每行保留k个最便宜的可行列，写入cand（列索引升序）；buf为回调视图的行缓冲
+static int topk_build(const CostView* view, int k, LapWorkspace* ws, SparseCost* cand, float* buf) {
+    int rows = view->rows, cols = view->cols;
+    int kk = k < cols ? k : cols;
+    if (sparse_cost_reserve(cand, rows, rows * kk) != 0) {
+        return -1;
+    }
+    float* key = ws->row_buf;
+    int* idx = ws->order;
+    cand->rows = rows;
+    cand->cols = cols;
+    cand->row_ptr[0] = 0;
+    int nnz = 0;
+    for (int i = 0; i < rows; i++) {
+        const float* row = cost_view_row(view, i, buf);
+        int len = 0;
+        for (int j = 0; j < cols; j++) {
+            // 堆满后整段都不比堆顶便宜时跳过
+            if (len == kk && j % VEC_WIDTH == 0 && j + VEC_WIDTH <= cols &&
+                !vm_any(vf_load(row + j) < vf_set1(key[0]))) {
+                j += VEC_WIDTH - 1;
+                continue;
+            }
+            float c = row[j];
+            if (len == kk) {
+                if (c < key[0]) { // 同时排除了DISALLOWED
+                    key[0] = c;
+                    idx[0] = j;
+                    topk_sift_down(key, idx, kk, 0);
+                }
+            } else if (!IS_DISALLOWED(c)) {
+                key[len] = c;
+                idx[len] = j;
+                len++;
+                if (len == kk) {
+                    for (int t = kk / 2 - 1; t >= 0; t--) {
+                        topk_sift_down(key, idx, kk, t);
+                    }
+                }
+            }
+        }
+        // k很小，插入排序按列号升序
+        for (int a = 1; a < len; a++) {
+            int j = idx[a], b = a - 1;
+            while (b >= 0 && idx[b] > j) {
+                idx[b + 1] = idx[b];
+                b--;
+            }
+            idx[b + 1] = j;
+        }
+        for (int t = 0; t < len; t++) {
+            cand->col_idx[nnz] = idx[t];
+            cand->cost[nnz] = row[idx[t]];
+            nnz++;
+        }
+        cand->row_ptr[i + 1] = nnz;
+    }
+    cand->nnz = nnz;
+    return 0;
+}
+
+// 用候选集求解得到的对偶检查被丢弃的边：约化成本 c - u - v < 0 的边并入cand
+// 第一遍只统计并标记有违反的行，第二遍只重扫这些行。返回并入的边数，-1内存不足
+static int topk_add_violations(const CostView* view, LapWorkspace* ws, SparseCost* cand, float* buf, double tol) {
+    int rows = view->rows, cols = view->cols;
+    const double* v = ws->v;
+    unsigned char* flagged = ws->row_mask;
+    int added = 0;
+    for (int i = 0; i < rows; i++) {
+        const float* row = cost_view_row(view, i, buf);
+        double limit = ws->u[i] - tol;
+        int count = 0;
+        for (int j = 0; j < cols; j++) {
+            count += (row[j] - v[j] < limit) & !IS_DISALLOWED(row[j]);
+        }
+        // 候选集内的边约化成本非负，不会被计入
+        flagged[i] = count > 0;
+        added += count;
+    }
+    if (added == 0) {
+        return 0;
+    }
+
+    SparseCost grown;
+    sparse_cost_init(&grown);
+    if (sparse_cost_reserve(&grown, rows, cand->nnz + added) != 0) {
+        return -1;
+    }
+    grown.rows = rows;
+    grown.cols = cols;
+    grown.row_ptr[0] = 0;
+    int nnz = 0;
+    for (int i = 0; i < rows; i++) {
+        int p = cand->row_ptr[i], end = cand->row_ptr[i + 1];
+        if (!flagged[i]) {
+            memcpy(grown.col_idx + nnz, cand->col_idx + p, sizeof(int) * (end - p));
+            memcpy(grown.cost + nnz, cand->cost + p, sizeof(float) * (end - p));
+            nnz += end - p;
+        } else {
+            const float* row = cost_view_row(view, i, buf);
+            double limit = ws->u[i] - tol;
+            for (int j = 0; j < cols; j++) {
+                bool present = p < end && cand->col_idx[p] == j;
+                if (present || (row[j] - v[j] < limit && !IS_DISALLOWED(row[j]))) {
+                    grown.col_idx[nnz] = j;
+                    grown.cost[nnz] = row[j];
+                    nnz++;
+                }
+                p += present;
+            }
+        }
+        grown.row_ptr[i + 1] = nnz;
+    }
+    grown.nnz = nnz;
+    added = nnz - cand->nnz; // 数值误差下候选边本身也可能被计入，以实际新增为准
+    SparseCost old = *cand;
+    *cand = grown;
+    sparse_cost_free(&old);
+    return added;
+}
+
+// 每行只保留k个最便宜的列（部分选择）求稀疏问题，再用对偶变量检查所有被丢弃的边：
+// 若存在约化成本为负的边则补回并重新求解，因此结果与稠密求解同为最优。
+// 候选集下出现无解的行，或补边轮数超过TOPK_MAX_ROUNDS时退回稠密求解。
+// cand为调用方持有、可跨帧复用的候选集缓冲。结果在ws中，按原视图的行列编号。返回0成功，-1失败
+static int lap_solve_topk_run(const CostView* view, int k, LapWorkspace* ws, SparseCost* cand, TopkReport* report) {
+    TopkReport local = {0, 0, 0, false};
+    if (view->kind == COST_SPARSE || k < 1) {
+        return -1;
+    }
+    float* buf = NULL;
+    if (view->kind != COST_DENSE && (buf = malloc(sizeof(float) * view->cols)) == NULL) {
+        return -1;
+    }
+    int status = 0;
+    if (lap_workspace_reserve(ws, view->rows, view->cols) != 0 || topk_build(view, k, ws, cand, buf) != 0) {
+        free(buf);
+        return -1;
+    }
+    while (1) {
+        CostView sparse_view = cost_view_sparse(cand);
+        if (lap_solve_run(&sparse_view, ws) != 0) {
+            status = -1;
+            break;
+        }
+        local.rounds++;
+        local.nnz = cand->nnz;
+        if (ws->infeasible_rows > 0 || local.rounds > TOPK_MAX_ROUNDS) {
+            local.dense_fallback = true;
+            status = lap_solve_run(view, ws);
+            break;
+        }
+        int added = topk_add_violations(view, ws, cand, buf, 1e-6);
+        if (added < 0) {
+            status = -1;
+            break;
+        }
+        if (added == 0) {
+            break;
+        }
+        local.added_edges += added;
+    }
+    free(buf);
+    if (report != NULL) {
+        *report = local;
+    }
+    return status;
+}
+
+int lap_solve_topk(const CostView* view, int k, LapWorkspace* ws, SparseCost* cand, TopkReport* report) {
+    long long t0 = metrics_start();
+    int rc = lap_solve_topk_run(view, k, ws, cand, report);
+    metrics_record(ENGINE_TOPK, view->rows, view->cols, t0, ws->augmentations, ws->infeasible_rows, rc != 0);
+    return rc;
+}
+
+// 获取配对结果（按行序）
+int lap_get_results(const LapWorkspace* ws, Assignment results[]) {
+    int count = 0;
+    for (int i = 0; i < ws->rows; i++) {
+        if (ws->row_to_col[i] >= 0) {
+            results[count].row = i;
+            results[count].col = ws->row_to_col[i];
+            count++;
+        }
+    }
+    return count;
+}
+
+// 计算配对结果在原始成本下的总成本
+float lap_total_cost(const CostView* view, const LapWorkspace* ws) {
+    float total = 0.0;
+    for (int i = 0; i < ws->rows; i++) {
+        if (ws->row_to_col[i] >= 0) {
+            total += cost_view_at(view, i, ws->row_to_col[i]);
+        }
+    }
+    return total;
+}
+
+// max_bytes为全部分片的总预算。返回0成功，-1失败
+int solution_cache_init(SolutionCache* cache, size_t max_bytes) {
+    memset(cache, 0, sizeof(*cache));
+    cache->shard_budget = max_bytes / SOLUTION_CACHE_SHARDS;
+    for (int s = 0; s < SOLUTION_CACHE_SHARDS; s++) {
+        if (pthread_mutex_init(&cache->shards[s].lock, NULL) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void solution_cache_free(SolutionCache* cache) {
+    for (int s = 0; s < SOLUTION_CACHE_SHARDS; s++) {
+        CacheShard* shard = &cache->shards[s];
+        for (CacheEntry* e = shard->lru_head; e != NULL;) {
+            CacheEntry* next = e->lru_next;
+            free(e);
+            e = next;
+        }
+        pthread_mutex_destroy(&shard->lock);
+    }
+    memset(cache, 0, sizeof(*cache));
+}
+
+void solution_cache_stats(SolutionCache* cache, SolutionCacheStats* out) {
+    memset(out, 0, sizeof(*out));
+    for (int s = 0; s < SOLUTION_CACHE_SHARDS; s++) {
+        CacheShard* shard = &cache->shards[s];
+        pthread_mutex_lock(&shard->lock);
+        out->hits += shard->hits;
+        out->misses += shard->misses;
+        out->collisions += shard->collisions;
+        out->evictions += shard->evictions;
+        out->bytes += shard->bytes;
+        for (CacheEntry* e = shard->lru_head; e != NULL; e = e->lru_next) {
+            out->entries++;
+        }
+        pthread_mutex_unlock(&shard->lock);
+    }
+}
+
+// 成本的规范位模式：DISALLOWED统一为+inf，-0统一为+0，使等价的输入键相同
+static inline uint32_t cache_cost_bits(float c) {
+    uint32_t bits;
+    if (IS_DISALLOWED(c)) {
+        c = INFINITY;
+    } else if (c == 0.0f) {
+        c = 0.0f;
+    }
+    memcpy(&bits, &c, sizeof(bits));
+    return bits;
+}
+
+static uint64_t cache_hash(const CostView* view, bool maximize) {
+    uint64_t h = 0x9E3779B97F4A7C15ull ^ ((uint64_t)view->rows << 32) ^ ((uint64_t)view->cols << 1) ^ maximize;
+    for (int i = 0; i < view->rows; i++) {
+        const float* row = view->dense + (size_t)i * view->stride;
+        for (int j = 0; j < view->cols; j++) {
+            h = (h ^ cache_cost_bits(row[j])) * 0xFF51AFD7ED558CCDull;
+            h ^= h >> 29;
+        }
+    }
+    return h ^ (h >> 32);
+}
+
+static bool cache_entry_matches(const CacheEntry* e, uint64_t hash, const CostView* view, bool maximize) {
+    if (e->hash != hash || e->rows != view->rows || e->cols != view->cols || e->maximize != maximize) {
+        return false;
+    }
+    for (int i = 0; i < view->rows; i++) {
+        const float* row = view->dense + (size_t)i * view->stride;
+        const uint32_t* cached = e->costs + (size_t)i * view->cols;
+        for (int j = 0; j < view->cols; j++) {
+            if (cached[j] != cache_cost_bits(row[j])) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static void cache_lru_unlink(CacheShard* shard, CacheEntry* e) {
+    if (e->lru_prev != NULL) {
+        e->lru_prev->lru_next = e->lru_next;
+    } else {
+        shard->lru_head = e->lru_next;
+    }
+    if (e->lru_next != NULL) {
+        e->lru_next->lru_prev = e->lru_prev;
+    } else {
+        shard->lru_tail = e->lru_prev;
+    }
+}
+
+static void cache_lru_push_front(CacheShard* shard, CacheEntry* e) {
+    e->lru_prev = NULL;
+    e->lru_next = shard->lru_head;
+    if (shard->lru_head != NULL) {
+        shard->lru_head->lru_prev = e;
+    } else {
+        shard->lru_tail = e;
+    }
+    shard->lru_head = e;
+}
+
+static void cache_evict_tail(CacheShard* shard) {
+    CacheEntry* e = shard->lru_tail;
+    CacheEntry** link = &shard->buckets[e->hash % SOLUTION_CACHE_BUCKETS];
+    while (*link != e) {
+        link = &(*link)->next_in_bucket;
+    }
+    *link = e->next_in_bucket;
+    cache_lru_unlink(shard, e);
+    shard->bytes -= e->bytes;
+    shard->evictions++;
+    free(e);
+}
+
+// 在分片锁内查找，命中时把结果写入ws并移到LRU表头。返回是否命中
+static bool cache_lookup(CacheShard* shard, uint64_t hash, const CostView* view, bool maximize, LapWorkspace* ws) {
+    for (CacheEntry* e = shard->buckets[hash % SOLUTION_CACHE_BUCKETS]; e != NULL; e = e->next_in_bucket) {
+        if (e->hash != hash) {
+            continue;
+        }
+        if (!cache_entry_matches(e, hash, view, maximize)) {
+            shard->collisions++;
+            continue;
+        }
+        lap_reset(ws, e->rows, e->cols);
+        for (int i = 0; i < e->rows; i++) {
+            ws->row_to_col[i] = e->row_to_col[i];
+            ws->u[i] = e->u[i];
+            if (e->row_to_col[i] >= 0) {
+                ws->col_to_row[e->row_to_col[i]] = i;
+            }
+        }
+        memcpy(ws->v, e->v, sizeof(double) * e->cols);
+        ws->augmentations = e->augmentations;
+        ws->infeasible_rows = e->infeasible_rows;
+        cache_lru_unlink(shard, e);
+        cache_lru_push_front(shard, e);
+        return true;
+    }
+    return false;
+}
+
+// 求解稠密视图，相同子问题命中缓存时直接返回之前的分配与对偶（ws中内容与lap_solve一致）。
+// maximize为true时按取负后的成本求最小，对偶对应取负后的成本。非稠密视图不经缓存直接求解。
+// 多线程可共用同一个cache（各自的ws）。maximize只支持稠密视图。返回0成功，-1内存不足或不支持
+int solution_cache_solve(SolutionCache* cache, const CostView* view, bool maximize, LapWorkspace* ws) {
+    if (view->kind != COST_DENSE) {
+        return maximize ? -1 : lap_solve(view, ws);
+    }
+    int rows = view->rows, cols = view->cols;
+    if (lap_workspace_reserve(ws, rows, cols) != 0) {
+        return -1;
+    }
+    uint64_t hash = cache_hash(view, maximize);
+    CacheShard* shard = &cache->shards[hash >> 60];
+    pthread_mutex_lock(&shard->lock);
+    bool hit = cache_lookup(shard, hash, view, maximize, ws);
+    shard->hits += hit;
+    shard->misses += !hit;
+    pthread_mutex_unlock(&shard->lock);
+    if (hit) {
+        return 0;
+    }
+
+    // 未命中：在锁外求解，再插入。条目与其数组一次分配：成本位、row_to_col，再按double对齐放u、v
+    size_t cells = (size_t)rows * cols;
+    size_t dual_offset = (sizeof(CacheEntry) + sizeof(uint32_t) * cells + sizeof(int) * rows + 7) & ~(size_t)7;
+    size_t bytes = dual_offset + sizeof(double) * (rows + cols);
+    int rc;
+    if (maximize) {
+        float* neg = malloc(sizeof(float) * (cells > 0 ? cells : 1));
+        if (neg == NULL) {
+            return -1;
+        }
+        for (int i = 0; i < rows; i++) {
+            for (int j = 0; j < cols; j++) {
+                float c = view->dense[(size_t)i * view->stride + j];
+                neg[(size_t)i * cols + j] = IS_DISALLOWED(c) ? c : -c;
+            }
+        }
+        CostView neg_view = cost_view_dense(neg, rows, cols, cols);
+        rc = lap_solve(&neg_view, ws);
+        free(neg);
+    } else {
+        rc = lap_solve(view, ws);
+    }
+    if (rc != 0 || bytes > cache->shard_budget) {
+        return rc;
+    }
+    CacheEntry* e = malloc(bytes);
+    if (e == NULL) {
+        return 0;  // 结果已在ws中，只是不缓存
+    }
+    e->costs = (uint32_t*)(e + 1);
+    e->row_to_col = (int*)(e->costs + cells);
+    e->u = (double*)((char*)e + dual_offset);
+    e->v = e->u + rows;
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < cols; j++) {
+            e->costs[(size_t)i * cols + j] = cache_cost_bits(view->dense[(size_t)i * view->stride + j]);
+        }
+    }
+    memcpy(e->row_to_col, ws->row_to_col, sizeof(int) * rows);
+    memcpy(e->u, ws->u, sizeof(double) * rows);
+    memcpy(e->v, ws->v, sizeof(double) * cols);
+    e->hash = hash;
+    e->rows = rows;
+    e->cols = cols;
+    e->maximize = maximize;
+    e->infeasible_rows = ws->infeasible_rows;
+    e->augmentations = ws->augmentations;
+    e->bytes = bytes;
+
+    pthread_mutex_lock(&shard->lock);
+    // 其他线程可能已插入同一子问题
+    for (CacheEntry* other = shard->buckets[hash % SOLUTION_CACHE_BUCKETS]; other != NULL; other = other->next_in_bucket) {
+        if (cache_entry_matches(other, hash, view, maximize)) {
+            pthread_mutex_unlock(&shard->lock);
+            free(e);
+            return 0;
+        }
+    }
+    while (shard->lru_tail != NULL && shard->bytes + bytes > cache->shard_budget) {
+        cache_evict_tail(shard);
+    }
+    CacheEntry** bucket = &shard->buckets[hash % SOLUTION_CACHE_BUCKETS];
+    e->next_in_bucket = *bucket;
+    *bucket = e;
+    cache_lru_push_front(shard, e);
+    shard->bytes += bytes;
+    pthread_mutex_unlock(&shard->lock);
+    return 0;
+}
+
+static void async_queue_init(AsyncQueue* q) {
+    atomic_store(&q->stub.next, NULL);
+    atomic_store(&q->head, &q->stub);
+    q->tail = &q->stub;
+}
+
+static void async_queue_push(AsyncQueue* q, AsyncNode* n) {
+    atomic_store_explicit(&n->next, NULL, memory_order_relaxed);
+    AsyncNode* prev = atomic_exchange_explicit(&q->head, n, memory_order_acq_rel);
+    atomic_store_explicit(&prev->next, n, memory_order_release);
+}
+
+// 只由消费者调用。生产者交换head后、链接next前的瞬间会返回NULL，稍后重试即可
+static AsyncNode* async_queue_pop(AsyncQueue* q) {
+    AsyncNode* tail = q->tail;
+    AsyncNode* next = atomic_load_explicit(&tail->next, memory_order_acquire);
+    if (tail == &q->stub) {
+        if (next == NULL) {
+            return NULL;
+        }
+        q->tail = next;
+        tail = next;
+        next = atomic_load_explicit(&tail->next, memory_order_acquire);
+    }
+    if (next != NULL) {
+        q->tail = next;
+        return tail;
+    }
+    if (tail != atomic_load_explicit(&q->head, memory_order_acquire)) {
+        return NULL;
+    }
+    async_queue_push(q, &q->stub);
+    next = atomic_load_explicit(&tail->next, memory_order_acquire);
+    if (next != NULL) {
+        q->tail = next;
+        return tail;
+    }
+    return NULL;
+}
+
+static void async_free_push(AsyncSolver* s, int index) {
+    unsigned long long top = atomic_load(&s->free_top);
+    unsigned long long next;
+    do {
+        atomic_store_explicit(&s->next_free[index], (int)(unsigned)top, memory_order_relaxed);
+        next = ((top >> 32) + 1) << 32 | (unsigned)index;
+    } while (!atomic_compare_exchange_weak(&s->free_top, &top, next));
+}
+
+// 返回空闲槽号，没有时返回-1
+static int async_free_pop(AsyncSolver* s) {
+    unsigned long long top = atomic_load(&s->free_top);
+    unsigned long long next;
+    do {
+        if ((unsigned)top == 0xFFFFFFFFu) {
+            return -1;
+        }
+        unsigned below = (unsigned)atomic_load_explicit(&s->next_free[(unsigned)top], memory_order_relaxed);
+        next = ((top >> 32) + 1) << 32 | below;
+    } while (!atomic_compare_exchange_weak(&s->free_top, &top, next));
+    return (int)(unsigned)top;
+}
+
+// 归还请求槽（未设置回调的请求在取走结果后调用）
+void async_release(AsyncSolver* s, AsyncRequest* req) {
+    atomic_store(&req->state, ASYNC_FREE);
+    async_free_push(s, req->index);
+}
+
+static void async_complete(AsyncSolver* s, AsyncRequest* req) {
+    AsyncCallback callback = req->callback;
+    atomic_store(&req->state, ASYNC_DONE);
+    if (atomic_load(&s->waiters) > 0) {
+        pthread_mutex_lock(&s->done_lock);
+        pthread_cond_broadcast(&s->done_cond);
+        pthread_mutex_unlock(&s->done_lock);
+    }
+    if (callback != NULL) {
+        callback(req, req->callback_arg);
+        async_release(s, req);
+    }
+}
+
+static void async_run(AsyncWorker* w, AsyncRequest* req) {
+    int expected = ASYNC_QUEUED;
+    if (!atomic_compare_exchange_strong(&req->state, &expected, ASYNC_RUNNING)) {
+        req->status = ASYNC_STATUS_CANCELLED; // 已被async_cancel标记
+        async_complete(w->solver, req);
+        return;
+    }
+    req->status = lap_solve(&req->view, &w->ws);
+    if (req->status == 0) {
+        memcpy(req->row_to_col, w->ws.row_to_col, sizeof(int) * req->rows);
+        req->total_cost = lap_total_cost(&req->view, &w->ws);
+        req->infeasible_rows = w->ws.infeasible_rows;
+    }
+    async_complete(w->solver, req);
+}
+
+static void* async_worker_main(void* p) {
+    AsyncWorker* w = p;
+    AsyncSolver* s = w->solver;
+    int idle = 0;
+    while (1) {
+        AsyncNode* n = async_queue_pop(&w->queue);
+        if (n != NULL) {
+            atomic_fetch_sub(&w->pending, 1);
+            async_run(w, (AsyncRequest*)n);
+            idle = 0;
+            continue;
+        }
+        if (atomic_load(&w->pending) > 0 || ++idle < ASYNC_SPIN) {
+            continue; // 生产者尚未链接完成，或短暂空转等待下一帧
+        }
+        pthread_mutex_lock(&w->lock);
+        atomic_store(&w->sleeping, 1);
+        while (atomic_load(&w->pending) == 0 && !atomic_load(&s->stop)) {
+            pthread_cond_wait(&w->wake, &w->lock);
+        }
+        atomic_store(&w->sleeping, 0);
+        pthread_mutex_unlock(&w->lock);
+        if (atomic_load(&w->pending) == 0 && atomic_load(&s->stop)) {
+            break;
+        }
+        idle = 0;
+    }
+    return NULL;
+}
+
+// 创建workers个求解线程与slots个请求槽，每个槽可容纳最多max_rows行的结果，
+// 各线程的工作区按max_rows x max_cols预留。返回0成功，-1失败
+int async_solver_init(AsyncSolver* s, int workers, int slots, int max_rows, int max_cols) {
+    memset(s, 0, sizeof(*s));
+    if (workers <= 0 || slots <= 0 || max_rows <= 0 || max_cols <= 0) {
+        return -1;
+    }
+    s->slots = slots;
+    s->max_rows = max_rows;
+    s->max_side = max_rows > max_cols ? max_rows : max_cols;
+    s->requests = calloc(slots, sizeof(AsyncRequest));
+    s->slot_rows = malloc(sizeof(int) * (size_t)slots * max_rows);
+    s->next_free = malloc(sizeof(atomic_int) * slots);
+    s->worker = calloc(workers, sizeof(AsyncWorker));
+    pthread_mutex_init(&s->done_lock, NULL);
+    pthread_cond_init(&s->done_cond, NULL);
+    if (s->requests == NULL || s->slot_rows == NULL || s->next_free == NULL || s->worker == NULL) {
+        async_solver_free(s);
+        return -1;
+    }
+    atomic_store(&s->free_top, 0xFFFFFFFFull);
+    for (int k = slots - 1; k >= 0; k--) {
+        s->requests[k].index = k;
+        s->requests[k].row_to_col = s->slot_rows + (size_t)k * max_rows;
+        async_free_push(s, k);
+    }
+    for (int k = 0; k < workers; k++) {
+        AsyncWorker* w = &s->worker[k];
+        async_queue_init(&w->queue);
+        pthread_mutex_init(&w->lock, NULL);
+        pthread_cond_init(&w->wake, NULL);
+        lap_workspace_init(&w->ws);
+        w->solver = s;
+        if (lap_workspace_reserve(&w->ws, max_rows, max_cols) != 0 ||
+            pthread_create(&w->thread, NULL, async_worker_main, w) != 0) {
+            lap_workspace_free(&w->ws);
+            pthread_mutex_destroy(&w->lock);
+            pthread_cond_destroy(&w->wake);
+            async_solver_free(s);
+            return -1;
+        }
+        s->workers = k + 1;
+    }
+    return 0;
+}
+
+// 处理完已提交的请求后停止求解线程并释放
+void async_solver_free(AsyncSolver* s) {
+    atomic_store(&s->stop, true);
+    for (int k = 0; k < s->workers; k++) {
+        AsyncWorker* w = &s->worker[k];
+        pthread_mutex_lock(&w->lock);
+        pthread_cond_signal(&w->wake);
+        pthread_mutex_unlock(&w->lock);
+    }
+    for (int k = 0; k < s->workers; k++) {
+        AsyncWorker* w = &s->worker[k];
+        pthread_join(w->thread, NULL);
+        lap_workspace_free(&w->ws);
+        pthread_mutex_destroy(&w->lock);
+        pthread_cond_destroy(&w->wake);
+    }
+    pthread_mutex_destroy(&s->done_lock);
+    pthread_cond_destroy(&s->done_cond);
+    free(s->worker);
+    free(s->requests);
+    free(s->slot_rows);
+    free(s->next_free);
+    memset(s, 0, sizeof(*s));
+}
+
+// 提交一个求解请求，stream>=0，同一stream的请求按提交顺序完成。callback为NULL时需async_wait后async_release。
+// 没有空闲槽、行数超过max_rows或较长一边超过预留的工作区时返回NULL（调用方可先等待已提交的请求）
+AsyncRequest* async_submit(AsyncSolver* s, const CostView* view, int stream, AsyncCallback callback, void* arg) {
+    if (stream < 0 || view->rows > s->max_rows || view->cols > s->max_side || atomic_load(&s->stop)) {
+        return NULL;
+    }
+    int index = async_free_pop(s);
+    if (index < 0) {
+        return NULL;
+    }
+    AsyncRequest* req = &s->requests[index];
+    req->stream = stream;
+    req->view = *view;
+    req->rows = view->rows;
+    req->callback = callback;
+    req->callback_arg = arg;
+    req->status = 0;
+    req->total_cost = 0.0f;
+    req->infeasible_rows = 0;
+    atomic_store(&req->state, ASYNC_QUEUED);
+    AsyncWorker* w = &s->worker[stream % s->workers];
+    async_queue_push(&w->queue, &req->node);
+    atomic_fetch_add(&w->pending, 1);
+    if (atomic_load(&w->sleeping)) {
+        pthread_mutex_lock(&w->lock);
+        pthread_cond_signal(&w->wake);
+        pthread_mutex_unlock(&w->lock);
+    }
+    return req;
+}
+
+// 尚未开始求解时取消，返回true；已开始或已完成时返回false。
+// 被取消的请求仍按stream顺序完成（status为ASYNC_STATUS_CANCELLED，回调照常调用）
+bool async_cancel(AsyncRequest* req) {
+    int expected = ASYNC_QUEUED;
+    return atomic_compare_exchange_strong(&req->state, &expected, ASYNC_CANCELLING);
+}
+
+bool async_done(const AsyncRequest* req) {
+    return atomic_load((atomic_int*)&req->state) == ASYNC_DONE;
+}
+
+// 阻塞到请求完成，返回其status。只用于没有回调的请求
+int async_wait(AsyncSolver* s, AsyncRequest* req) {
+    for (int k = 0; k < ASYNC_SPIN && !async_done(req); k++) {
+    }
+    if (!async_done(req)) {
+        atomic_fetch_add(&s->waiters, 1);
+        pthread_mutex_lock(&s->done_lock);
+        while (!async_done(req)) {
+            pthread_cond_wait(&s->done_cond, &s->done_lock);
+        }
+        pthread_mutex_unlock(&s->done_lock);
+        atomic_fetch_sub(&s->waiters, 1);
+    }
+    return req->status;
+}
+
+// 取出已完成请求的匹配结果，返回匹配数
+int async_get_results(const AsyncRequest* req, Assignment results[]) {
+    int count = 0;
+    if (req->status != 0) {
+        return 0;
+    }
+    for (int i = 0; i < req->rows; i++) {
+        if (req->row_to_col[i] >= 0) {
+            results[count].row = i;
+            results[count].col = req->row_to_col[i];
+            count++;
+        }
+    }
+    return count;
+}
+
+void bottleneck_workspace_init(BottleneckWorkspace* ws) {
+    memset(ws, 0, sizeof(*ws));
+}
+
+void bottleneck_workspace_free(BottleneckWorkspace* ws) {
+    free(ws->row_start);
+    free(ws->edge_col);
+    free(ws->edge_cost);
+    free(ws->deg);
+    free(ws->lo_deg);
+    free(ws->hi_deg);
+    free(ws->values);
+    free(ws->row_match);
+    free(ws->match_cost);
+    free(ws->col_match);
+    free(ws->dist);
+    free(ws->next);
+    free(ws->queue);
+    free(ws->stack);
+    free(ws->best);
+    free(ws->row_buf);
+    free(ws->col_min);
+    bottleneck_workspace_init(ws);
+}
+
+static int bottleneck_reserve(BottleneckWorkspace* ws, int rows, int cols, size_t edges) {
+    if (rows > ws->row_capacity) {
+        struct {
+            void** ptr;
+            size_t elem;
+        } arrays[] = {
+            {(void**)&ws->deg, sizeof(int)},        {(void**)&ws->lo_deg, sizeof(int)},
+            {(void**)&ws->hi_deg, sizeof(int)},     {(void**)&ws->row_match, sizeof(int)},
+            {(void**)&ws->match_cost, sizeof(float)}, {(void**)&ws->dist, sizeof(int)},
+            {(void**)&ws->next, sizeof(int)},       {(void**)&ws->queue, sizeof(int)},
+            {(void**)&ws->stack, sizeof(int)},      {(void**)&ws->best, sizeof(int)},
+        };
+        for (size_t k = 0; k < sizeof(arrays) / sizeof(arrays[0]); k++) {
+            void* p = realloc(*arrays[k].ptr, arrays[k].elem * rows);
+            if (p == NULL) {
+                return -1;
+            }
+            *arrays[k].ptr = p;
+        }
+        int* start = realloc(ws->row_start, sizeof(int) * (rows + 1));
+        if (start == NULL) {
+            return -1;
+        }
+        ws->row_start = start;
+        ws->row_capacity = rows;
+    }
+    if (cols > ws->col_capacity) {
+        int* col_match = realloc(ws->col_match, sizeof(int) * cols);
+        float* row_buf = col_match ? realloc(ws->row_buf, sizeof(float) * cols) : NULL;
+        float* col_min = row_buf ? realloc(ws->col_min, sizeof(float) * cols) : NULL;
+        ws->col_match = col_match ? col_match : ws->col_match;
+        ws->row_buf = row_buf ? row_buf : ws->row_buf;
+        ws->col_min = col_min ? col_min : ws->col_min;
+        if (col_min == NULL) {
+            return -1;
+        }
+        ws->col_capacity = cols;
+    }
+    if (edges > ws->edge_capacity) {
+        int* col = realloc(ws->edge_col, sizeof(int) * edges);
+        float* cost = col ? realloc(ws->edge_cost, sizeof(float) * edges) : NULL;
+        float* v = cost ? realloc(ws->values, sizeof(float) * edges) : NULL;
+        ws->edge_col = col ? col : ws->edge_col;
+        ws->edge_cost = cost ? cost : ws->edge_cost;
+        ws->values = v ? v : ws->values;
+        if (v == NULL) {
+            return -1;
+        }
+        ws->edge_capacity = edges;
+    }
+    return 0;
+}
+
+// 把第i行的边[begin, end)（相对row_start）中成本不超过t（strict时为小于t）的移到前面，返回分界
+static int bottleneck_partition(BottleneckWorkspace* ws, int i, int begin, int end, float t, bool strict) {
+    int* col = ws->edge_col + ws->row_start[i];
+    float* cost = ws->edge_cost + ws->row_start[i];
+    int k = begin;
+    for (int p = begin; p < end; p++) {
+        if (strict ? cost[p] < t : cost[p] <= t) {
+            int tc = col[k];
+            float tv = cost[k];
+            col[k] = col[p];
+            cost[k] = cost[p];
+            col[p] = tc;
+            cost[p] = tv;
+            k++;
+        }
+    }
+    return k;
+}
+
+// 线性期望时间选出a[0, n)中第k小的值（会打乱a）
+static float bottleneck_select(float* a, int n, int k) {
+    int lo = 0, hi = n - 1;
+    while (lo < hi) {
+        float pivot = a[lo + (hi - lo) / 2];
+        int i = lo, j = hi;
+        while (i <= j) {
+            while (a[i] < pivot) {
+                i++;
+            }
+            while (a[j] > pivot) {
+                j--;
+            }
+            if (i <= j) {
+                float tmp = a[i];
+                a[i++] = a[j];
+                a[j--] = tmp;
+            }
+        }
+        if (k <= j) {
+            hi = j;
+        } else if (k >= i) {
+            lo = i;
+        } else {
+            break;
+        }
+    }
+    return a[k];
+}
+
+// 在当前deg限定的图上用Hopcroft-Karp把现有匹配补成最大匹配，返回匹配数
+static int bottleneck_augment(BottleneckWorkspace* ws, int matched) {
+    HopcroftKarp hk = {ws->rows, ws->edge_col, ws->row_start, ws->deg, ws->row_match, ws->col_match,
+                       ws->dist, ws->next, ws->queue, ws->stack, ws->edge_cost, ws->match_cost, -1, 0};
+    matched += hk_augment(&hk);
+    ws->phases += hk.phases;
+    return matched;
+}
+
+// 删去成本超过t的配对，返回剩余匹配数与其中的最大成本
+static int bottleneck_prune(BottleneckWorkspace* ws, float t, float* worst) {
+    int matched = 0;
+    *worst = -INFINITY;
+    for (int i = 0; i < ws->rows; i++) {
+        if (ws->row_match[i] < 0) {
+            continue;
+        }
+        float cost = ws->match_cost[i];
+        if (cost > t) {
+            ws->col_match[ws->row_match[i]] = -1;
+            ws->row_match[i] = -1;
+        } else {
+            matched++;
+            *worst = cost > *worst ? cost : *worst;
+        }
+    }
+    return matched;
+}
+
+// 瓶颈指派：在所有最大基数匹配中求最大配对成本最小的一个（不考虑总成本）。
+// 支持全部CostView类型，DISALLOWED的配对不参与。返回0成功，-1内存不足
+int bottleneck_solve(const CostView* view, BottleneckWorkspace* ws) {
+    int rows = view->rows, cols = view->cols;
+    size_t max_edges = view->kind == COST_SPARSE ? (size_t)view->sparse->nnz : (size_t)rows * cols;
+    if (max_edges > INT_MAX || bottleneck_reserve(ws, rows, cols, max_edges > 0 ? max_edges : 1) != 0) {
+        return -1;
+    }
+    ws->rows = rows;
+    ws->cols = cols;
+    ws->probes = 0;
+    ws->phases = 0;
+
+    // 收集允许的边，同时记录每行、每列的最小成本
+    int m = 0;
+    for (int j = 0; j < cols; j++) {
+        ws->col_min[j] = INFINITY;
+        ws->col_match[j] = -1;
+    }
+    float row_bound = -INFINITY; // 每行都要匹配时，瓶颈不小于各行最小成本的最大值
+    for (int i = 0; i < rows; i++) {
+        ws->row_start[i] = m;
+        float row_min = INFINITY;
+        if (view->kind == COST_SPARSE) {
+            for (int k = view->sparse->row_ptr[i]; k < view->sparse->row_ptr[i + 1]; k++) {
+                if (!IS_DISALLOWED(view->sparse->cost[k])) {
+                    ws->edge_col[m] = view->sparse->col_idx[k];
+                    ws->edge_cost[m++] = view->sparse->cost[k];
+                }
+            }
+        } else {
+            const float* row = cost_view_row(view, i, ws->row_buf);
+            for (int j = 0; j < cols; j++) {
+                if (!IS_DISALLOWED(row[j])) {
+                    ws->edge_col[m] = j;
+                    ws->edge_cost[m++] = row[j];
+                }
+            }
+        }
+        for (int k = ws->row_start[i]; k < m; k++) {
+            float cost = ws->edge_cost[k];
+            int j = ws->edge_col[k];
+            row_min = cost < row_min ? cost : row_min;
+            ws->col_min[j] = cost < ws->col_min[j] ? cost : ws->col_min[j];
+        }
+        if (m > ws->row_start[i] && row_min > row_bound) {
+            row_bound = row_min;
+        }
+        ws->deg[i] = m - ws->row_start[i];
+        ws->row_match[i] = -1;
+    }
+    ws->row_start[rows] = m;
+
+    // 全部边上的最大匹配数是目标基数
+    ws->matched = bottleneck_augment(ws, 0);
+    if (ws->matched == 0) {
+        ws->bottleneck = 0.0f;
+        return 0;
+    }
+    float best, lower = -INFINITY;
+    bottleneck_prune(ws, INFINITY, &best);
+    memcpy(ws->best, ws->row_match, sizeof(int) * rows);
+    if (ws->matched == rows) {
+        lower = row_bound;
+    }
+    if (ws->matched == cols) {
+        for (int j = 0; j < cols; j++) {
+            lower = ws->col_min[j] > lower ? ws->col_min[j] : lower;
+        }
+    }
+    // 瓶颈在[lower, best]内：小于lower的边总是有效，大于best的边不再需要
+    for (int i = 0; i < rows; i++) {
+        int n = ws->row_start[i + 1] - ws->row_start[i];
+        ws->lo_deg[i] = bottleneck_partition(ws, i, 0, n, lower, true);
+        ws->hi_deg[i] = bottleneck_partition(ws, i, ws->lo_deg[i], n, best, true);
+    }
+
+    // 候选为每行[lo_deg, hi_deg)内的边，成本都在[lower, best)内
+    while (1) {
+        int count = 0;
+        for (int i = 0; i < rows; i++) {
+            const float* cost = ws->edge_cost + ws->row_start[i];
+            for (int k = ws->lo_deg[i]; k < ws->hi_deg[i]; k++) {
+                ws->values[count++] = cost[k];
+            }
+        }
+        if (count == 0) {
+            break;
+        }
+        float t = bottleneck_select(ws->values, count, count / 2);
+        ws->probes++;
+        for (int i = 0; i < rows; i++) {
+            ws->deg[i] = bottleneck_partition(ws, i, ws->lo_deg[i], ws->hi_deg[i], t, false);
+        }
+        float worst;
+        int matched = bottleneck_augment(ws, bottleneck_prune(ws, t, &worst));
+        if (matched == ws->matched) {
+            bottleneck_prune(ws, INFINITY, &best); // 找到的匹配可能比阈值更好
+            memcpy(ws->best, ws->row_match, sizeof(int) * rows);
+            for (int i = 0; i < rows; i++) {
+                ws->hi_deg[i] = bottleneck_partition(ws, i, ws->lo_deg[i], ws->deg[i], best, true);
+            }
+        } else {
+            memcpy(ws->lo_deg, ws->deg, sizeof(int) * rows);
+        }
+    }
+
+    ws->bottleneck = best;
+    memcpy(ws->row_match, ws->best, sizeof(int) * rows);
+    for (int j = 0; j < cols; j++) {
+        ws->col_match[j] = -1;
+    }
+    for (int i = 0; i < rows; i++) {
+        if (ws->row_match[i] >= 0) {
+            ws->col_match[ws->row_match[i]] = i;
+        }
+    }
+    return 0;
+}
+
+// 取出瓶颈指派结果，返回匹配数
+int bottleneck_get_results(const BottleneckWorkspace* ws, Assignment results[]) {
+    int count = 0;
+    for (int i = 0; i < ws->rows; i++) {
+        if (ws->row_match[i] >= 0) {
+            results[count].row = i;
+            results[count].col = ws->row_match[i];
+            count++;
+        }
+    }
+    return count;
+}
+
+static void* slice_worker_main(void* p) {
+    SliceWorker* w = p;
+    SliceScheduler* s = w->sched;
+    pthread_mutex_lock(&s->lock);
+    while (1) {
+        while (s->head == NULL && !s->stop) {
+            pthread_cond_wait(&s->work, &s->lock);
+        }
+        if (s->head == NULL) {
+            break;
+        }
+        SliceTask* t = s->head;
+        s->head = t->next;
+        if (s->head == NULL) {
+            s->tail = NULL;
+        }
+        s->running++;
+        s->slices++;
+        long long quantum = s->quantum_ns;
+        pthread_mutex_unlock(&s->lock);
+
+        if (t->slices > 0 && t->last_worker != w->index) {
+            t->migrations++;
+        }
+        t->slices++;
+        t->last_worker = w->index;
+        long long deadline = quantum > 0 ? monotonic_ns() + quantum : 0;
+        t->status = munkres_run_slice(t->munkres, 0, deadline);
+        bool finished = t->status != RUN_IN_PROGRESS;
+        if (finished) {
+            t->finish_ns = monotonic_ns();
+            if (t->done != NULL) {
+                t->done(t, t->arg);
+            }
+        }
+
+        pthread_mutex_lock(&s->lock);
+        s->running--;
+        if (!finished) {
+            t->next = NULL;
+            if (s->tail != NULL) {
+                s->tail->next = t;
+            } else {
+                s->head = t;
+            }
+            s->tail = t;
+        }
+        if (s->head == NULL && s->running == 0) {
+            pthread_cond_broadcast(&s->idle);
+        }
+    }
+    pthread_mutex_unlock(&s->lock);
+    return NULL;
+}
+
+// workers个工作线程，时间片quantum_ns（0表示每个任务执行到完成）。返回0成功，-1失败
+int slice_scheduler_init(SliceScheduler* s, int workers, long long quantum_ns) {
+    memset(s, 0, sizeof(*s));
+    if (workers <= 0) {
+        return -1;
+    }
+    pthread_mutex_init(&s->lock, NULL);
+    pthread_cond_init(&s->work, NULL);
+    pthread_cond_init(&s->idle, NULL);
+    s->quantum_ns = quantum_ns;
+    s->workers = calloc(workers, sizeof(SliceWorker));
+    if (s->workers == NULL) {
+        slice_scheduler_free(s);
+        return -1;
+    }
+    for (int k = 0; k < workers; k++) {
+        s->workers[k].sched = s;
+        s->workers[k].index = k;
+        if (pthread_create(&s->workers[k].thread, NULL, slice_worker_main, &s->workers[k]) != 0) {
+            slice_scheduler_free(s);
+            return -1;
+        }
+        s->n_workers = k + 1;
+    }
+    return 0;
+}
+
+// 提交任务（调用方持有task与munkres，完成前不得释放）
+void slice_submit(SliceScheduler* s, SliceTask* task, Munkres* munkres, SliceDoneFn done, void* arg) {
+    task->munkres = munkres;
+    task->done = done;
+    task->arg = arg;
+    task->status = RUN_IN_PROGRESS;
+    task->slices = 0;
+    task->last_worker = -1;
+    task->migrations = 0;
+    task->submit_ns = monotonic_ns();
+    task->finish_ns = 0;
+    task->next = NULL;
+    pthread_mutex_lock(&s->lock);
+    if (s->tail != NULL) {
+        s->tail->next = task;
+    } else {
+        s->head = task;
+    }
+    s->tail = task;
+    pthread_cond_signal(&s->work);
+    pthread_mutex_unlock(&s->lock);
+}
+
+// 等待所有已提交的任务完成
+void slice_scheduler_wait_idle(SliceScheduler* s) {
+    pthread_mutex_lock(&s->lock);
+    while (s->head != NULL || s->running > 0) {
+        pthread_cond_wait(&s->idle, &s->lock);
+    }
+    pthread_mutex_unlock(&s->lock);
+}
+
+// 完成已提交的任务后停止工作线程并释放
+void slice_scheduler_free(SliceScheduler* s) {
+    pthread_mutex_lock(&s->lock);
+    s->stop = true;
+    pthread_cond_broadcast(&s->work);
+    pthread_mutex_unlock(&s->lock);
+    for (int k = 0; k < s->n_workers; k++) {
+        pthread_join(s->workers[k].thread, NULL);
+    }
+    free(s->workers);
+    pthread_mutex_destroy(&s->lock);
+    pthread_cond_destroy(&s->work);
+    pthread_cond_destroy(&s->idle);
+    memset(s, 0, sizeof(*s));
+}
+
+// 在全精度成本exact上复核ws中的分配（如半精度求解的结果）：对偶按较小一侧逐行（逐列）
+// 补上最负的约化成本后对exact可行，由此得到下界与间隙证书，需要O(rows*cols)次读取。
+// exact需为稠密、半精度或回调视图。返回0成功，-1视图不支持、内存不足或存在未分配的行
+int lap_recheck_exact(const CostView* exact, const LapWorkspace* ws, ExactCheck* out) {
+    int rows = exact->rows, cols = exact->cols;
+    out->cost = 0.0;
+    out->lower_bound = -INFINITY;
+    out->gap = INFINITY;
+    if (exact->kind == COST_SPARSE || rows != ws->rows || cols != ws->cols) {
+        return -1;
+    }
+    for (int i = 0; i < rows; i++) {
+        if (ws->row_to_col[i] >= 0) {
+            out->cost += cost_view_at(exact, i, ws->row_to_col[i]);
+        }
+    }
+    if (ws->infeasible_rows > 0) {
+        return -1;
+    }
+    // 较小一侧全部匹配；另一侧的对偶在增广中只减不增（<= 0），可对全部求和
+    bool transposed = rows > cols;
+    float* buf = malloc(sizeof(float) * cols);
+    double* col_min = transposed ? malloc(sizeof(double) * cols) : NULL;
+    if (buf == NULL || (transposed && col_min == NULL)) {
+        free(buf);
+        free(col_min);
+        return -1;
+    }
+    double lb = 0.0;
+    for (int j = 0; j < cols; j++) {
+        if (transposed) {
+            col_min[j] = 0.0;
+        } else {
+            lb += ws->v[j];
+        }
+    }
+    for (int i = 0; i < rows; i++) {
+        const float* row = cost_view_row(exact, i, buf);
+        double row_min = 0.0;
+        for (int j = 0; j < cols; j++) {
+            if (IS_DISALLOWED(row[j])) {
+                continue;
+            }
+            double slack = row[j] - ws->u[i] - ws->v[j];
+            if (transposed) {
+                col_min[j] = slack < col_min[j] ? slack : col_min[j];
+            } else {
+                row_min = slack < row_min ? slack : row_min;
+            }
+        }
+        lb += ws->u[i] + row_min;
+    }
+    for (int j = 0; transposed && j < cols; j++) {
+        lb += ws->v[j] + col_min[j];
+    }
+    free(buf);
+    free(col_min);
+    out->lower_bound = lb;
+    out->gap = out->cost - lb;
+    return 0;
+}
+
+void flow_workspace_init(FlowWorkspace* ws) {
+    memset(ws, 0, sizeof(*ws));
+    lap_workspace_init(&ws->lap);
+}
+
+void flow_workspace_free(FlowWorkspace* ws) {
+    void* arrays[] = {ws->pi_a, ws->pi_b, ws->dist_a, ws->dist_b, ws->pred_a, ws->pred_b, ws->pred_cost,
+                      ws->done_a, ws->done_b, ws->touched_a, ws->touched_b, ws->cap_a, ws->cap_b,
+                      ws->off_a, ws->off_b, ws->used_a, ws->used_b, ws->list_a, ws->list_b, ws->cost_b, ws->mark};
+    for (size_t k = 0; k < sizeof(arrays) / sizeof(arrays[0]); k++) {
+        free(arrays[k]);
+    }
+    lap_workspace_free(&ws->lap);
+    flow_workspace_init(ws);
+}
+
+// 按节点数与配对表长度预留空间，返回0成功，-1内存不足
+static int flow_workspace_reserve(FlowWorkspace* ws, int n, int list_len) {
+    if (n > ws->capacity) {
+        struct {
+            void** ptr;
+            size_t elem;
+        } arrays[] = {
+            {(void**)&ws->pi_a, sizeof(double)}, {(void**)&ws->pi_b, sizeof(double)},
+            {(void**)&ws->dist_a, sizeof(double)}, {(void**)&ws->dist_b, sizeof(double)},
+            {(void**)&ws->pred_a, sizeof(int)}, {(void**)&ws->pred_b, sizeof(int)},
+            {(void**)&ws->pred_cost, sizeof(float)},
+            {(void**)&ws->done_a, sizeof(unsigned char)}, {(void**)&ws->done_b, sizeof(unsigned char)},
+            {(void**)&ws->touched_a, sizeof(int)}, {(void**)&ws->touched_b, sizeof(int)},
+            {(void**)&ws->cap_a, sizeof(int)}, {(void**)&ws->cap_b, sizeof(int)},
+            {(void**)&ws->off_a, sizeof(int)}, {(void**)&ws->off_b, sizeof(int)},
+            {(void**)&ws->used_a, sizeof(int)}, {(void**)&ws->used_b, sizeof(int)},
+            {(void**)&ws->mark, sizeof(unsigned int)},
+        };
+        for (size_t k = 0; k < sizeof(arrays) / sizeof(arrays[0]); k++) {
+            void* p = realloc(*arrays[k].ptr, arrays[k].elem * n);
+            if (p == NULL) {
+                return -1;
+            }
+            *arrays[k].ptr = p;
+        }
+        ws->capacity = n;
+    }
+    if (list_len > ws->list_capacity) {
+        void* a = realloc(ws->list_a, sizeof(int) * list_len);
+        if (a == NULL) {
+            return -1;
+        }
+        ws->list_a = a;
+        void* b = realloc(ws->list_b, sizeof(int) * list_len);
+        if (b == NULL) {
+            return -1;
+        }
+        ws->list_b = b;
+        void* c = realloc(ws->cost_b, sizeof(float) * list_len);
+        if (c == NULL) {
+            return -1;
+        }
+        ws->cost_b = c;
+        ws->list_capacity = list_len;
+    }
+    return 0;
+}
+
+// 从A节点src出发做Dijkstra，到达尚有容量的B节点后沿最短路增广1个单位
+// 返回0成功，-1表示无法到达（势与配对保持不变）
+static int flow_augment(FlowWorkspace* ws, LapCtx* ctx, float sign, int src) {
+    int n_ta = 0, n_tb = 0, sink = -1;
+    double d_sink = 0.0;
+    ws->dist_a[src] = 0.0;
+    ws->pred_a[src] = -1;
+    ws->touched_a[n_ta++] = src;
+
+    while (sink == -1) {
+        // 选出距离最小的未出队节点，距离相同时优先尚有容量的B节点
+        int best_a = -1, best_b = -1;
+        bool best_spare = false;
+        double lowest = INFINITY;
+        for (int t = 0; t < n_ta; t++) {
+            int a = ws->touched_a[t];
+            if (!ws->done_a[a] && ws->dist_a[a] < lowest) {
+                lowest = ws->dist_a[a];
+                best_a = a;
+            }
+        }
+        for (int t = 0; t < n_tb; t++) {
+            int b = ws->touched_b[t];
+            if (ws->done_b[b]) {
+                continue;
+            }
+            double d = ws->dist_b[b];
+            bool spare = ws->used_b[b] < ws->cap_b[b];
+            if (d < lowest || (d == lowest && spare && !best_spare)) {
+                lowest = d;
+                best_a = -1;
+                best_b = b;
+                best_spare = spare;
+            }
+        }
+        if (best_a == -1 && best_b == -1) {
+            break;
+        }
+
+        if (best_a != -1) {
+            int a = best_a;
+            ws->done_a[a] = 1;
+            ws->stamp++;
+            for (int t = 0; t < ws->used_a[a]; t++) {
+                ws->mark[ws->list_a[ws->off_a[a] + t]] = ws->stamp;
+            }
+            const int* idx;
+            const float* val;
+            int len = lap_fetch_row(ctx, a, &idx, &val);
+            double base = lowest + ws->pi_a[a];
+            for (int k = 0; k < len; k++) {
+                int b = idx != NULL ? idx[k] : k;
+                if (IS_DISALLOWED(val[k]) || ws->done_b[b] || ws->mark[b] == ws->stamp || ws->cap_b[b] == 0) {
+                    continue;
+                }
+                double d = base + sign * val[k] - ws->pi_b[b];
+                if (ws->dist_b[b] == INFINITY) {
+                    ws->touched_b[n_tb++] = b;
+                }
+                if (d < ws->dist_b[b]) {
+                    ws->dist_b[b] = d;
+                    ws->pred_b[b] = a;
+                    ws->pred_cost[b] = sign * val[k];
+                }
+            }
+        } else {
+            int b = best_b;
+            ws->done_b[b] = 1;
+            if (best_spare) {
+                sink = b;
+                d_sink = lowest;
+                break;
+            }
+            // 反向边：撤销已有的配对(a, b)
+            for (int t = 0; t < ws->used_b[b]; t++) {
+                int a = ws->list_b[ws->off_b[b] + t];
+                double d = lowest - ws->cost_b[ws->off_b[b] + t] + ws->pi_b[b] - ws->pi_a[a];
+                if (ws->done_a[a]) {
+                    continue;
+                }
+                if (ws->dist_a[a] == INFINITY) {
+                    ws->touched_a[n_ta++] = a;
+                }
+                if (d < ws->dist_a[a]) {
+                    ws->dist_a[a] = d;
+                    ws->pred_a[a] = b;
+                }
+            }
+        }
+    }
+
+    if (sink != -1) {
+        // 只更新已出队的节点，保持残量网络上的约化成本非负；尚有容量的B节点势不变
+        for (int t = 0; t < n_ta; t++) {
+            int a = ws->touched_a[t];
+            if (ws->done_a[a]) {
+                ws->pi_a[a] += ws->dist_a[a] - d_sink;
+            }
+        }
+        for (int t = 0; t < n_tb; t++) {
+            int b = ws->touched_b[t];
+            if (ws->done_b[b]) {
+                ws->pi_b[b] += ws->dist_b[b] - d_sink;
+            }
+        }
+
+        // 沿前驱增广：新增(a, b)；a经反向边到达时撤销(a, prev)，由prev的前驱补上
+        int b = sink;
+        ws->used_b[b]++;
+        while (1) {
+            int a = ws->pred_b[b];
+            int pos = ws->off_b[b] + ws->used_b[b] - 1;
+            ws->list_b[pos] = a;
+            ws->cost_b[pos] = ws->pred_cost[b];
+            int prev = ws->pred_a[a];
+            if (prev == -1) {
+                ws->list_a[ws->off_a[a] + ws->used_a[a]++] = b;
+                break;
+            }
+            for (int t = 0; t < ws->used_a[a]; t++) {
+                if (ws->list_a[ws->off_a[a] + t] == prev) {
+                    ws->list_a[ws->off_a[a] + t] = b;
+                    break;
+                }
+            }
+            // 从prev的配对表中移除a：末尾元素填入空位，末尾位置留给prev的前驱
+            int base = ws->off_b[prev], last = base + ws->used_b[prev] - 1;
+            for (int t = base; t < last; t++) {
+                if (ws->list_b[t] == a) {
+                    ws->list_b[t] = ws->list_b[last];
+                    ws->cost_b[t] = ws->cost_b[last];
+                    break;
+                }
+            }
+            b = prev;
+        }
+    }
+
+    for (int t = 0; t < n_ta; t++) {
+        ws->dist_a[ws->touched_a[t]] = INFINITY;
+        ws->done_a[ws->touched_a[t]] = 0;
+    }
+    for (int t = 0; t < n_tb; t++) {
+        ws->dist_b[ws->touched_b[t]] = INFINITY;
+        ws->done_b[ws->touched_b[t]] = 0;
+    }
+    return sink != -1 ? 0 : -1;
+}
+
+static int flow_clamp(const int* cap, int k, int limit) {
+    int c = cap != NULL ? cap[k] : 1;
+    return c < 0 ? 0 : c > limit ? limit : c;
+}
+
+// 带容量的分配：row_cap/col_cap为NULL时容量为1，容量<=0的行列不参与，DISALLOWED的配对不使用
+// maximize为true时最大化总成本（按取负处理）。与lap_solve相同，较小一侧的每个容量单位都被分配时结果最优；
+// 无法分配的单位计入ws->unrouted。结果用flow_get_results读取，ws->flow为配对数，ws->cost为总成本
+// 返回0成功，-1内存不足
+static int flow_solve_run(const CostView* view, const int* row_cap, const int* col_cap, bool maximize, FlowWorkspace* ws) {
+    int rows = view->rows, cols = view->cols;
+    long long total_r = 0, total_c = 0;
+    for (int i = 0; i < rows; i++) {
+        total_r += flow_clamp(row_cap, i, cols);
+    }
+    for (int j = 0; j < cols; j++) {
+        total_c += flow_clamp(col_cap, j, rows);
+    }
+    bool transposed = total_r > total_c;
+    LapWorkspace* lap = &ws->lap;
+    if (lap_workspace_reserve(lap, rows, cols) != 0 || lap_cache_reserve(view, lap) != 0) {
+        return -1;
+    }
+    row_cache_clear(&lap->cache);
+    lap->csc_source = NULL;
+    if (transposed && view->kind == COST_SPARSE) {
+        if (sparse_transpose(view->sparse, &lap->csc) != 0) {
+            return -1;
+        }
+        lap->csc_source = view->sparse;
+    }
+    LapCtx ctx;
+    lap_ctx_init(&ctx, view, lap, transposed);
+    int n_a = ctx.n_rows, n_b = ctx.n_cols;
+    long long list_len = total_r > total_c ? total_r : total_c;
+    if (list_len > INT_MAX || flow_workspace_reserve(ws, rows > cols ? rows : cols, (int)list_len) != 0) {
+        return -1;
+    }
+
+    ws->rows = rows;
+    ws->cols = cols;
+    ws->transposed = transposed;
+    const int* caps_a = transposed ? col_cap : row_cap;
+    const int* caps_b = transposed ? row_cap : col_cap;
+    int off = 0;
+    for (int a = 0; a < n_a; a++) {
+        ws->cap_a[a] = flow_clamp(caps_a, a, n_b);
+        ws->off_a[a] = off;
+        off += ws->cap_a[a];
+        ws->used_a[a] = 0;
+        ws->pi_a[a] = 0.0;
+        ws->dist_a[a] = INFINITY;
+        ws->done_a[a] = 0;
+    }
+    off = 0;
+    for (int b = 0; b < n_b; b++) {
+        ws->cap_b[b] = flow_clamp(caps_b, b, n_a);
+        ws->off_b[b] = off;
+        off += ws->cap_b[b];
+        ws->used_b[b] = 0;
+        ws->pi_b[b] = 0.0;
+        ws->dist_b[b] = INFINITY;
+        ws->done_b[b] = 0;
+        ws->mark[b] = 0;
+    }
+    ws->stamp = 0;
+    ws->flow = 0;
+    ws->unrouted = 0;
+
+    float sign = maximize ? -1.0f : 1.0f;
+    for (int a = 0; a < n_a; a++) {
+        for (int unit = 0; unit < ws->cap_a[a]; unit++) {
+            if (flow_augment(ws, &ctx, sign, a) != 0) {
+                ws->unrouted += ws->cap_a[a] - unit; // 此后的单位同样无法到达
+                break;
+            }
+            ws->flow++;
+        }
+    }
+    ws->cost = 0.0;
+    for (int b = 0; b < n_b; b++) {
+        for (int t = 0; t < ws->used_b[b]; t++) {
+            ws->cost += sign * ws->cost_b[ws->off_b[b] + t];
+        }
+    }
+    return 0;
+}
+
+int flow_solve(const CostView* view, const int* row_cap, const int* col_cap, bool maximize, FlowWorkspace* ws) {
+    long long t0 = metrics_start();
+    int rc = flow_solve_run(view, row_cap, col_cap, maximize, ws);
+    metrics_record(ENGINE_FLOW, view->rows, view->cols, t0, rc == 0 ? ws->flow : 0, rc == 0 ? ws->unrouted : 0, rc != 0);
+    return rc;
+}
+
+// 获取配对结果（按行序，每行可有多个），返回配对数
+int flow_get_results(const FlowWorkspace* ws, Assignment results[]) {
+    int count = 0;
+    const int* off = ws->transposed ? ws->off_b : ws->off_a;
+    const int* used = ws->transposed ? ws->used_b : ws->used_a;
+    const int* list = ws->transposed ? ws->list_b : ws->list_a;
+    for (int i = 0; i < ws->rows; i++) {
+        for (int t = 0; t < used[i]; t++) {
+            results[count].row = i;
+            results[count].col = list[off[i] + t];
+            count++;
+        }
+    }
+    return count;
+}
+
+void default_workspace_init(DefaultWorkspace* ws) {
+    memset(ws, 0, sizeof(*ws));
+    flow_workspace_init(&ws->flow);
+    sparse_cost_init(&ws->by_col);
+    sparse_cost_init(&ws->compact);
+}
+
+void default_workspace_free(DefaultWorkspace* ws) {
+    flow_workspace_free(&ws->flow);
+    sparse_cost_free(&ws->by_col);
+    sparse_cost_free(&ws->compact);
+    free(ws->slot);
+    free(ws->col_map);
+    free(ws->plain);
+    free(ws->col_cap);
+    free(ws->row_to_col);
+    free(ws->pairs);
+    default_workspace_init(ws);
+}
+
+static int default_workspace_reserve(DefaultWorkspace* ws, int rows, int cols) {
+    int n = rows > cols ? rows : cols;
+    if (n + 1 > ws->col_capacity) {
+        int** arrays[] = {&ws->slot, &ws->col_map, &ws->plain, &ws->col_cap};
+        for (size_t k = 0; k < sizeof(arrays) / sizeof(arrays[0]); k++) {
+            int* p = realloc(*arrays[k], sizeof(int) * (n + 1));
+            if (p == NULL) {
+                return -1;
+            }
+            *arrays[k] = p;
+        }
+        ws->col_capacity = n + 1;
+    }
+    if (n > ws->row_capacity) {
+        int* r2c = realloc(ws->row_to_col, sizeof(int) * n);
+        if (r2c == NULL) {
+            return -1;
+        }
+        ws->row_to_col = r2c;
+        Assignment* pairs = realloc(ws->pairs, sizeof(Assignment) * n);
+        if (pairs == NULL) {
+            return -1;
+        }
+        ws->pairs = pairs;
+        ws->row_capacity = n;
+    }
+    return 0;
+}
+
+// 从稠密矩阵中取出不等于value的元素作为例外（out为CSR），返回0成功，-1内存不足
+int default_cost_extract(const float* data, int rows, int cols, int stride, float value, SparseCost* out) {
+    int nnz = 0;
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < cols; j++) {
+            nnz += data[(size_t)i * stride + j] != value;
+        }
+    }
+    if (sparse_cost_reserve(out, rows, nnz) != 0) {
+        return -1;
+    }
+    out->rows = rows;
+    out->cols = cols;
+    out->nnz = 0;
+    for (int i = 0; i < rows; i++) {
+        out->row_ptr[i] = out->nnz;
+        for (int j = 0; j < cols; j++) {
+            float c = data[(size_t)i * stride + j];
+            if (c != value) {
+                out->col_idx[out->nnz] = j;
+                out->cost[out->nnz++] = c;
+            }
+        }
+    }
+    out->row_ptr[rows] = out->nnz;
+    return 0;
+}
+
+// 求解默认值矩阵，结果与lap_solve相同：较小一侧尽量全部匹配、总成本最小
+// 行多于列且默认值全矩阵统一时先转置，使合并发生在较长的一侧。平局按确定的顺序解决：
+// 类节点中的列按列号升序依次分给按行号升序的匹配行，相同输入总得到相同结果
+// 结果在ws->row_to_col中，ws->matched为配对数，ws->cost为总成本。返回0成功，-1内存不足
+int default_cost_solve(const DefaultCost* m, DefaultWorkspace* ws) {
+    bool transposed = m->rows > m->cols && m->row_default == NULL;
+    const SparseCost* ex = m->exceptions;
+    if (transposed) {
+        if (sparse_transpose(m->exceptions, &ws->by_col) != 0) {
+            return -1;
+        }
+        ex = &ws->by_col;
+    }
+    int rows = transposed ? m->cols : m->rows;
+    int cols = transposed ? m->rows : m->cols;
+    if (default_workspace_reserve(ws, rows, cols) != 0) {
+        return -1;
+    }
+
+    // 有例外元素的列保留，其余列合并
+    for (int j = 0; j < cols; j++) {
+        ws->slot[j] = -1;
+    }
+    for (int k = 0; k < ex->nnz; k++) {
+        ws->slot[ex->col_idx[k]] = 0;
+    }
+    int n_ex = 0, n_plain = 0;
+    for (int j = 0; j < cols; j++) {
+        if (ws->slot[j] == 0) {
+            ws->col_map[n_ex] = j;
+            ws->slot[j] = n_ex++;
+        } else {
+            ws->plain[n_plain++] = j;
+        }
+    }
+    int n_compact = n_ex + (n_plain > 0);
+    long long nnz = (long long)rows * n_compact;
+    if (nnz > INT_MAX || sparse_cost_reserve(&ws->compact, rows, (int)nnz) != 0) {
+        return -1;
+    }
+    SparseCost* c = &ws->compact;
+    c->rows = rows;
+    c->cols = n_compact;
+    c->nnz = 0;
+    for (int i = 0; i < rows; i++) {
+        c->row_ptr[i] = c->nnz;
+        float d = m->row_default != NULL ? m->row_default[i] : m->value;
+        int k = ex->row_ptr[i];
+        for (int s = 0; s < n_ex; s++) {
+            float cost = d;
+            if (k < ex->row_ptr[i + 1] && ex->col_idx[k] == ws->col_map[s]) {
+                cost = ex->cost[k++];
+            }
+            if (!IS_DISALLOWED(cost)) {
+                c->col_idx[c->nnz] = s;
+                c->cost[c->nnz++] = cost;
+            }
+        }
+        if (n_plain > 0 && !IS_DISALLOWED(d)) {
+            c->col_idx[c->nnz] = n_ex;
+            c->cost[c->nnz++] = d;
+        }
+    }
+    c->row_ptr[rows] = c->nnz;
+    for (int s = 0; s < n_ex; s++) {
+        ws->col_cap[s] = 1;
+    }
+    ws->col_cap[n_ex] = n_plain;
+
+    CostView view = cost_view_sparse(c);
+    if (flow_solve(&view, NULL, ws->col_cap, false, &ws->flow) != 0) {
+        return -1;
+    }
+    int count = flow_get_results(&ws->flow, ws->pairs);
+    ws->rows = m->rows;
+    for (int i = 0; i < m->rows; i++) {
+        ws->row_to_col[i] = -1;
+    }
+    int next_plain = 0;
+    for (int t = 0; t < count; t++) {
+        int i = ws->pairs[t].row;
+        int j = ws->pairs[t].col < n_ex ? ws->col_map[ws->pairs[t].col] : ws->plain[next_plain++];
+        if (transposed) {
+            ws->row_to_col[j] = i;
+        } else {
+            ws->row_to_col[i] = j;
+        }
+    }
+    ws->matched = count;
+    ws->exception_cols = n_ex;
+    ws->cost = ws->flow.cost;
+    return 0;
+}
+
+// 获取配对结果，返回配对数
+int default_cost_get_results(const DefaultWorkspace* ws, Assignment results[]) {
+    int count = 0;
+    for (int i = 0; i < ws->rows; i++) {
+        if (ws->row_to_col[i] >= 0) {
+            results[count].row = i;
+            results[count].col = ws->row_to_col[i];
+            count++;
+        }
+    }
+    return count;
+}
+
+static void worker_pool_run_chunk(WorkerPool* pool, int w) {
+    int begin = w * pool->chunk;
+    int end = begin + pool->chunk < pool->count ? begin + pool->chunk : pool->count;
+    if (begin < end) {
+        pool->fn(begin, end, w, pool->arg);
+    }
+}
+
+static void* worker_pool_main(void* p) {
+    WorkerStart* start = p;
+    WorkerPool* pool = start->pool;
+    int w = start->index;
+    free(start);
+    unsigned long seen = 0;
+    pthread_mutex_lock(&pool->lock);
+    while (1) {
+        while (pool->generation == seen && !pool->stop) {
+            pthread_cond_wait(&pool->start_cond, &pool->lock);
+        }
+        if (pool->stop) {
+            break;
+        }
+        seen = pool->generation;
+        pthread_mutex_unlock(&pool->lock);
+        worker_pool_run_chunk(pool, w);
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->pending == 0) {
+            pthread_cond_signal(&pool->done_cond);
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+// 创建线程池，threads<=0时取在线CPU数。返回0成功，-1失败
+int worker_pool_init(WorkerPool* pool, int threads) {
+    if (threads <= 0) {
+        threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+        if (threads <= 0) {
+            threads = 1;
+        }
+    }
+    memset(pool, 0, sizeof(*pool));
+    pool->threads = threads;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->start_cond, NULL);
+    pthread_cond_init(&pool->done_cond, NULL);
+    pool->handles = calloc(threads, sizeof(pthread_t));
+    if (pool->handles == NULL) {
+        return -1;
+    }
+    for (int w = 1; w < threads; w++) {
+        WorkerStart* start = malloc(sizeof(WorkerStart));
+        if (start == NULL) {
+            pool->threads = w;
+            return -1;
+        }
+        start->pool = pool;
+        start->index = w;
+        if (pthread_create(&pool->handles[w], NULL, worker_pool_main, start) != 0) {
+            free(start);
+            pool->threads = w;
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void worker_pool_free(WorkerPool* pool) {
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = true;
+    pthread_cond_broadcast(&pool->start_cond);
+    pthread_mutex_unlock(&pool->lock);
+    for (int w = 1; w < pool->threads; w++) {
+        pthread_join(pool->handles[w], NULL);
+    }
+    free(pool->handles);
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->start_cond);
+    pthread_cond_destroy(&pool->done_cond);
+}
+
+// 并行执行fn，块大小按grain对齐（如按缓存行对齐列块）；pool为NULL时在当前线程执行
+void worker_pool_parallel_for(WorkerPool* pool, int count, int grain, ParallelFn fn, void* arg) {
+    if (count <= 0) {
+        return;
+    }
+    if (pool == NULL || pool->threads == 1 || count <= grain) {
+        fn(0, count, 0, arg);
+        return;
+    }
+    int chunk = (count + pool->threads - 1) / pool->threads;
+    if (grain > 1) {
+        chunk = (chunk + grain - 1) / grain * grain;
+    }
+    pthread_mutex_lock(&pool->lock);
+    pool->fn = fn;
+    pool->arg = arg;
+    pool->count = count;
+    pool->chunk = chunk;
+    pool->pending = pool->threads - 1;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->start_cond);
+    pthread_mutex_unlock(&pool->lock);
+
+    worker_pool_run_chunk(pool, 0);
+
+    pthread_mutex_lock(&pool->lock);
+    while (pool->pending > 0) {
+        pthread_cond_wait(&pool->done_cond, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+void candidate_builder_init(CandidateBuilder* b) {
+    memset(b, 0, sizeof(*b));
+}
+
+void candidate_builder_free(CandidateBuilder* b) {
+    free(b->grid.cell_start);
+    free(b->grid.items);
+    free(b->grid.cell_of);
+    for (int c = 0; c < b->chunk_capacity; c++) {
+        free(b->chunks[c].col);
+        free(b->chunks[c].cost);
+    }
+    free(b->chunks);
+    free(b->row_count);
+    candidate_builder_init(b);
+}
+
+// 按观测中心重建网格。cell<=0时取观测框平均边长的2倍；网格数不超过观测数的4倍。返回0成功，-1内存不足
+int spatial_grid_build(SpatialGrid* g, const BoxSet* dets, float cell) {
+    int n = dets->count;
+    float min_x = FLT_MAX, min_y = FLT_MAX, max_x = -FLT_MAX, max_y = -FLT_MAX;
+    double sum_size = 0.0;
+    g->max_w = 0.0f;
+    g->max_h = 0.0f;
+    for (int j = 0; j < n; j++) {
+        float cx = dets->x[j] + 0.5f * dets->w[j], cy = dets->y[j] + 0.5f * dets->h[j];
+        min_x = cx < min_x ? cx : min_x;
+        min_y = cy < min_y ? cy : min_y;
+        max_x = cx > max_x ? cx : max_x;
+        max_y = cy > max_y ? cy : max_y;
+        g->max_w = dets->w[j] > g->max_w ? dets->w[j] : g->max_w;
+        g->max_h = dets->h[j] > g->max_h ? dets->h[j] : g->max_h;
+        sum_size += dets->w[j] + dets->h[j];
+    }
+    if (n == 0) {
+        min_x = min_y = max_x = max_y = 0.0f;
+    }
+    if (cell <= 0.0f) {
+        cell = n > 0 ? (float)(sum_size / n) : 1.0f;
+    }
+    double span_x = (double)max_x - min_x, span_y = (double)max_y - min_y;
+    double limit = 4.0 * n + 16.0;
+    if (cell <= 0.0f || (span_x / cell + 1.0) * (span_y / cell + 1.0) > limit) {
+        cell = (float)fmax(sqrt(span_x * span_y / limit), fmax(span_x, span_y) / limit);
+        cell = cell > 0.0f ? cell * 1.01f : 1.0f;
+    }
+    g->cell = cell;
+    g->min_x = min_x;
+    g->min_y = min_y;
+    g->nx = (int)(span_x / cell) + 1;
+    g->ny = (int)(span_y / cell) + 1;
+    int cells = g->nx * g->ny;
+    if (cells + 1 > g->cell_capacity) {
+        int* p = realloc(g->cell_start, sizeof(int) * (cells + 1));
+        if (p == NULL) {
+            return -1;
+        }
+        g->cell_start = p;
+        g->cell_capacity = cells + 1;
+    }
+    if (n > g->item_capacity) {
+        int* items = realloc(g->items, sizeof(int) * n);
+        int* cell_of = items ? realloc(g->cell_of, sizeof(int) * n) : NULL;
+        g->items = items ? items : g->items;
+        g->cell_of = cell_of ? cell_of : g->cell_of;
+        if (cell_of == NULL) {
+            return -1;
+        }
+        g->item_capacity = n;
+    }
+
+    // 计数排序：网格内按观测下标升序
+    memset(g->cell_start, 0, sizeof(int) * (cells + 1));
+    for (int j = 0; j < n; j++) {
+        int gx = (int)((dets->x[j] + 0.5f * dets->w[j] - min_x) / cell);
+        int gy = (int)((dets->y[j] + 0.5f * dets->h[j] - min_y) / cell);
+        gx = gx < 0 ? 0 : (gx >= g->nx ? g->nx - 1 : gx);
+        gy = gy < 0 ? 0 : (gy >= g->ny ? g->ny - 1 : gy);
+        g->cell_of[j] = gy * g->nx + gx;
+        g->cell_start[g->cell_of[j] + 1]++;
+    }
+    for (int c = 0; c < cells; c++) {
+        g->cell_start[c + 1] += g->cell_start[c];
+    }
+    for (int j = 0; j < n; j++) {
+        g->items[g->cell_start[g->cell_of[j]]++] = j;
+    }
+    for (int c = cells; c > 0; c--) {
+        g->cell_start[c] = g->cell_start[c - 1];
+    }
+    g->cell_start[0] = 0;
+    return 0;
+}
+
+// 单个配对的代价（t由cost_track_prepare预计算），与cost_row_kernel共用标量公式
+static float cost_pair_kernel(const CostTrack* t, const BoxSet* tracks, int i, const BoxSet* dets, int j, const CostParams* p) {
+    float dot = 0.0f;
+    if (t->use_cos) {
+        for (int k = 0; k < tracks->emb_dim; k++) {
+            dot += tracks->emb[(size_t)k * tracks->count + i] * dets->emb[(size_t)k * dets->count + j];
+        }
+    }
+    return cost_pair_scalar(t, dets, j, dot, p);
+}
+
+// 目标i的门控区域：观测中心必须落在的轴对齐矩形（保守外接）。没有空间门控时返回false
+static bool gate_region(const BoxSet* tracks, int i, const CostParams* p, const SpatialGrid* g, float* x0, float* y0,
+                        float* x1, float* y1) {
+    float tcx = tracks->x[i] + 0.5f * tracks->w[i], tcy = tracks->y[i] + 0.5f * tracks->h[i];
+    float rx = FLT_MAX, ry = FLT_MAX;
+    if (p->min_iou > 0.0f) {
+        // IoU>0要求两框相交，中心距离小于半宽之和
+        rx = 0.5f * (tracks->w[i] + g->max_w);
+        ry = 0.5f * (tracks->h[i] + g->max_h);
+    }
+    if (p->max_maha > 0.0f && tracks->cov_xx != NULL) {
+        float a = tracks->cov_xx[i], b = tracks->cov_xy[i], c = tracks->cov_yy[i];
+        if (a * c - b * b > 0.0f) {
+            // 椭圆 e^T S^-1 e <= g 的外接矩形半宽为 sqrt(g * S_xx)
+            rx = fminf(rx, sqrtf(p->max_maha * a));
+            ry = fminf(ry, sqrtf(p->max_maha * c));
+        }
+    }
+    if (rx == FLT_MAX || ry == FLT_MAX) {
+        return false;
+    }
+    rx = rx * 1.001f + 1e-3f; // 舍入余量，区域只需要偏大
+    ry = ry * 1.001f + 1e-3f;
+    *x0 = tcx - rx;
+    *x1 = tcx + rx;
+    *y0 = tcy - ry;
+    *y1 = tcy + ry;
+    return true;
+}
+
+static int candidate_push(CandidateChunk* c, int col, float cost) {
+    if (c->count == c->capacity) {
+        int capacity = c->capacity * 2 + 256;
+        int* cols = realloc(c->col, sizeof(int) * capacity);
+        float* costs = cols ? realloc(c->cost, sizeof(float) * capacity) : NULL;
+        c->col = cols ? cols : c->col;
+        c->cost = costs ? costs : c->cost;
+        if (costs == NULL) {
+            return -1;
+        }
+        c->capacity = capacity;
+    }
+    c->col[c->count] = col;
+    c->cost[c->count] = cost;
+    c->count++;
+    return 0;
+}
+
+static void candidate_worker(int begin, int end, int worker, void* arg) {
+    CandidateTask* t = arg;
+    CandidateChunk* c = &t->b->chunks[worker];
+    const SpatialGrid* g = &t->b->grid;
+    c->count = 0;
+    c->error = 0;
+    c->tested = 0;
+    for (int i = begin; i < end; i++) {
+        int start = c->count;
+        float x0, y0, x1, y1;
+        CostTrack track;
+        cost_track_prepare(t->tracks, i, t->dets, t->p, &track);
+        if (track.gated) {
+            t->b->row_count[i] = 0;
+            continue;
+        }
+        if (!gate_region(t->tracks, i, t->p, g, &x0, &y0, &x1, &y1)) {
+            for (int j = 0; j < t->dets->count; j++) {
+                float cost = cost_pair_kernel(&track, t->tracks, i, t->dets, j, t->p);
+                if (!IS_DISALLOWED(cost) && candidate_push(c, j, cost) != 0) {
+                    c->error = 1;
+                    return;
+                }
+            }
+            c->tested += t->dets->count;
+            t->b->row_count[i] = c->count - start;
+            continue;
+        }
+        int gx0 = (int)floorf((x0 - g->min_x) / g->cell), gx1 = (int)floorf((x1 - g->min_x) / g->cell);
+        int gy0 = (int)floorf((y0 - g->min_y) / g->cell), gy1 = (int)floorf((y1 - g->min_y) / g->cell);
+        gx0 = gx0 < 0 ? 0 : gx0;
+        gy0 = gy0 < 0 ? 0 : gy0;
+        gx1 = gx1 >= g->nx ? g->nx - 1 : gx1;
+        gy1 = gy1 >= g->ny ? g->ny - 1 : gy1;
+        for (int gy = gy0; gy <= gy1; gy++) {
+            for (int gx = gx0; gx <= gx1; gx++) {
+                int cell = gy * g->nx + gx;
+                for (int k = g->cell_start[cell]; k < g->cell_start[cell + 1]; k++) {
+                    int j = g->items[k];
+                    float cx = t->dets->x[j] + 0.5f * t->dets->w[j], cy = t->dets->y[j] + 0.5f * t->dets->h[j];
+                    if (cx < x0 || cx > x1 || cy < y0 || cy > y1) {
+                        continue;
+                    }
+                    c->tested++;
+                    float cost = cost_pair_kernel(&track, t->tracks, i, t->dets, j, t->p);
+                    if (!IS_DISALLOWED(cost) && candidate_push(c, j, cost) != 0) {
+                        c->error = 1;
+                        return;
+                    }
+                }
+            }
+        }
+        // 行内按列升序（候选通常很少，插入排序）
+        for (int a = start + 1; a < c->count; a++) {
+            int col = c->col[a];
+            float cost = c->cost[a];
+            int k = a;
+            for (; k > start && c->col[k - 1] > col; k--) {
+                c->col[k] = c->col[k - 1];
+                c->cost[k] = c->cost[k - 1];
+            }
+            c->col[k] = col;
+            c->cost[k] = cost;
+        }
+        t->b->row_count[i] = c->count - start;
+    }
+}
+
+// 用空间网格构建稀疏候选列表，结果与build_cost_sparse相同。每帧重建网格；pool非NULL时按目标并行。
+// 返回0成功，-1内存不足
+int build_cost_sparse_indexed(CandidateBuilder* b, SparseCost* out, const BoxSet* tracks, const BoxSet* dets,
+                              const CostParams* p, WorkerPool* pool) {
+    int rows = tracks->count, cols = dets->count;
+    int workers = pool != NULL ? pool->threads : 1;
+    if (spatial_grid_build(&b->grid, dets, 0.0f) != 0) {
+        return -1;
+    }
+    if (workers > b->chunk_capacity) {
+        CandidateChunk* chunks = realloc(b->chunks, sizeof(CandidateChunk) * workers);
+        if (chunks == NULL) {
+            return -1;
+        }
+        memset(chunks + b->chunk_capacity, 0, sizeof(CandidateChunk) * (workers - b->chunk_capacity));
+        b->chunks = chunks;
+        b->chunk_capacity = workers;
+    }
+    if (rows > b->row_capacity) {
+        int* counts = realloc(b->row_count, sizeof(int) * rows);
+        if (counts == NULL) {
+            return -1;
+        }
+        b->row_count = counts;
+        b->row_capacity = rows;
+    }
+    for (int w = 0; w < workers; w++) {
+        b->chunks[w].count = 0;
+        b->chunks[w].tested = 0;
+        b->chunks[w].error = 0;
+    }
+    CandidateTask task = {b, tracks, dets, p};
+    worker_pool_parallel_for(pool, rows, 1, candidate_worker, &task);
+
+    // 各段按目标顺序拼接成CSR
+    long long nnz = 0;
+    b->tested = 0;
+    for (int w = 0; w < workers; w++) {
+        if (b->chunks[w].error) {
+            return -1;
+        }
+        nnz += b->chunks[w].count;
+        b->tested += b->chunks[w].tested;
+    }
+    if (nnz > INT_MAX || sparse_cost_reserve(out, rows, (int)(nnz > 0 ? nnz : 1)) != 0) {
+        return -1;
+    }
+    out->rows = rows;
+    out->cols = cols;
+    out->nnz = 0;
+    for (int w = 0; w < workers; w++) {
+        memcpy(out->col_idx + out->nnz, b->chunks[w].col, sizeof(int) * b->chunks[w].count);
+        memcpy(out->cost + out->nnz, b->chunks[w].cost, sizeof(float) * b->chunks[w].count);
+        out->nnz += b->chunks[w].count;
+    }
+    out->row_ptr[0] = 0;
+    for (int i = 0; i < rows; i++) {
+        out->row_ptr[i + 1] = out->row_ptr[i] + b->row_count[i];
+    }
+    return 0;
+}
+
+static void spin_barrier_init(SpinBarrier* b, int threads) {
+    atomic_init(&b->count, 0);
+    atomic_init(&b->sense, 0);
+    atomic_init(&b->sleepers, 0);
+    b->threads = threads;
+    pthread_mutex_init(&b->lock, NULL);
+    pthread_cond_init(&b->cond, NULL);
+}
+
+static void spin_barrier_destroy(SpinBarrier* b) {
+    pthread_mutex_destroy(&b->lock);
+    pthread_cond_destroy(&b->cond);
+}
+
+static void spin_barrier_wait(SpinBarrier* b, int* local_sense) {
+    int s = !*local_sense;
+    *local_sense = s;
+    if (atomic_fetch_add(&b->count, 1) == b->threads - 1) {
+        atomic_store(&b->count, 0);
+        atomic_store(&b->sense, s);
+        // 先发布sense再检查休眠者：休眠者在锁内复查sense，不会错过唤醒
+        if (atomic_load(&b->sleepers) > 0) {
+            pthread_mutex_lock(&b->lock);
+            pthread_cond_broadcast(&b->cond);
+            pthread_mutex_unlock(&b->lock);
+        }
+        return;
+    }
+    for (int spins = 0; spins < 4096; spins++) {
+        if (atomic_load(&b->sense) == s) {
+            return;
+        }
+    }
+    atomic_fetch_add(&b->sleepers, 1);
+    pthread_mutex_lock(&b->lock);
+    while (atomic_load(&b->sense) != s) {
+        pthread_cond_wait(&b->cond, &b->lock);
+    }
+    pthread_mutex_unlock(&b->lock);
+    atomic_fetch_sub(&b->sleepers, 1);
+}
+
+static inline bool lap_candidate_less(const LapCandidate* a, const LapCandidate* b) {
+    if (b->j == -1) {
+        return a->j != -1;
+    }
+    if (a->j == -1 || a->d != b->d) {
+        return a->j != -1 && a->d < b->d;
+    }
+    if (a->busy != b->busy) {
+        return a->busy < b->busy;
+    }
+    return a->step != b->step ? a->step < b->step : a->j < b->j;
+}
+
+// 每个工作线程运行完整的求解循环。ws->touched在此记录列首次触达的步数
+static void lap_parallel_worker(int begin, int end, int worker, void* arg) {
+    (void)end;
+    (void)worker;
+    LapParallel* p = arg;
+    LapCtx* ctx = &p->ctx;
+    LapWorkspace* ws = ctx->ws;
+    double* ur = ctx->ur;
+    double* vc = ctx->vc;
+    int w = begin;
+    int j0 = w * p->block < ctx->n_cols ? w * p->block : ctx->n_cols;
+    int j1 = j0 + p->block < ctx->n_cols ? j0 + p->block : ctx->n_cols;
+    size_t row_step = ctx->transposed ? 1 : (size_t)ctx->view->stride;
+    size_t col_step = ctx->transposed ? (size_t)ctx->view->stride : 1;
+    int sense = 0, parity = 0;
+
+    for (int cur_row = 0; cur_row < ctx->n_rows; cur_row++) {
+        double min_val = 0.0;
+        int i = cur_row, sink = -1, n_visited = 0;
+        for (int step = 0; sink == -1; step++) {
+            if (w == 0) {
+                ws->visited[n_visited++] = i;
+            }
+            const float* base = ctx->view->dense + (size_t)i * row_step;
+            LapCandidate local = {INFINITY, 1, INT_MAX, -1};
+            for (int j = j0; j < j1; j++) {
+                if (ws->scanned[j]) {
+                    continue;
+                }
+                float c = base[j * col_step];
+                if (!IS_DISALLOWED(c)) {
+                    double r = min_val + c - ur[i] - vc[j];
+                    if (ws->pred[j] == -1) {
+                        ws->touched[j] = step;
+                        ws->dist[j] = r;
+                        ws->pred[j] = i;
+                    } else if (r < ws->dist[j]) {
+                        ws->dist[j] = r;
+                        ws->pred[j] = i;
+                    }
+                }
+                if (ws->pred[j] != -1) {
+                    LapCandidate cand = {ws->dist[j], ctx->c2r[j] != -1, ws->touched[j], j};
+                    if (lap_candidate_less(&cand, &local)) {
+                        local = cand;
+                    }
+                }
+            }
+            LapCandidate* group = p->slots + (size_t)parity * p->threads;
+            group[w] = local;
+            spin_barrier_wait(&p->barrier, &sense);
+            // 下一步写另一组，本组在所有线程越过下一次屏障前不会被覆盖
+            parity ^= 1;
+            LapCandidate best = group[0];
+            for (int t = 1; t < p->threads; t++) {
+                if (lap_candidate_less(&group[t], &best)) {
+                    best = group[t];
+                }
+            }
+            if (best.j == -1) {
+                break;
+            }
+            min_val = best.d;
+            if (best.j >= j0 && best.j < j1) {
+                ws->scanned[best.j] = 1;
+            }
+            // 用屏障前记录的busy判断：0号线程找到终点后会立即翻转匹配，不能再读c2r[best.j]
+            if (!best.busy) {
+                sink = best.j;
+            } else {
+                i = ctx->c2r[best.j];
+            }
+        }
+
+        if (sink != -1) {
+            // 各块更新自己的列对偶；0号线程更新行对偶并翻转匹配（需要各块的pred，之后才能清除）
+            for (int j = j0; j < j1; j++) {
+                if (ws->scanned[j]) {
+                    vc[j] -= min_val - ws->dist[j];
+                }
+            }
+            if (w == 0) {
+                ur[cur_row] += min_val;
+                for (int t = 1; t < n_visited; t++) {
+                    int r = ws->visited[t];
+                    ur[r] += min_val - ws->dist[ctx->r2c[r]];
+                }
+                int j = sink;
+                while (1) {
+                    int r = ws->pred[j];
+                    ctx->c2r[j] = r;
+                    int next = ctx->r2c[r];
+                    ctx->r2c[r] = j;
+                    j = next;
+                    if (r == cur_row) {
+                        break;
+                    }
+                }
+                ws->augmentations++;
+            }
+            spin_barrier_wait(&p->barrier, &sense);
+        } else if (w == 0) {
+            ws->infeasible_rows++;
+        }
+        for (int j = j0; j < j1; j++) {
+            ws->pred[j] = -1;
+            ws->scanned[j] = 0;
+        }
+    }
+}
+
+// 稠密成本的多线程求解，结果（含平局的选择）与lap_solve完全相同。
+// 非稠密视图、pool为NULL或单线程、以及问题方向上列数较少时直接走串行版。返回0成功，-1内存不足
+int lap_solve_parallel(const CostView* view, LapWorkspace* ws, WorkerPool* pool) {
+    int n_cols = view->rows > view->cols ? view->rows : view->cols;
+    if (view->kind != COST_DENSE || pool == NULL || pool->threads < 2 || n_cols < LAP_PARALLEL_MIN_COLS) {
+        return lap_solve(view, ws);
+    }
+    long long t0 = metrics_start();
+    if (lap_workspace_reserve(ws, view->rows, view->cols) != 0) {
+        metrics_record(ENGINE_LAP, view->rows, view->cols, t0, 0, 0, true);
+        return -1;
+    }
+    lap_reset(ws, view->rows, view->cols);
+    LapParallel p;
+    lap_ctx_init(&p.ctx, view, ws, view->rows > view->cols);
+    p.threads = pool->threads;
+    p.block = (n_cols + p.threads - 1) / p.threads;
+    p.block = (p.block + LAP_PARALLEL_ALIGN - 1) / LAP_PARALLEL_ALIGN * LAP_PARALLEL_ALIGN;
+    spin_barrier_init(&p.barrier, p.threads);
+    p.slots = aligned_alloc(64, sizeof(LapCandidate) * 2 * p.threads);
+    if (p.slots == NULL) {
+        spin_barrier_destroy(&p.barrier);
+        metrics_record(ENGINE_LAP, view->rows, view->cols, t0, 0, 0, true);
+        return -1;
+    }
+    worker_pool_parallel_for(pool, p.threads, 1, lap_parallel_worker, &p);
+    spin_barrier_destroy(&p.barrier);
+    free(p.slots);
+    metrics_record(ENGINE_LAP, view->rows, view->cols, t0, ws->augmentations, ws->infeasible_rows, false);
+    return 0;
+}
+
+static int mda_item_cmp(const void* x, const void* y) {
+    const MdaSortItem* a = x;
+    const MdaSortItem* b = y;
+    if (a->key != b->key) {
+        return a->key < b->key ? -1 : 1;
+    }
+    return a->hyp - b->hyp;
+}
+
+// 建立松弛(a, b)的分组与稀疏图结构（成本每次迭代重填）
+static int mda_relax_build(MdaRelax* r, const MdaSolver* s, int a, int b) {
+    const HypothesisList* h = &s->hyps;
+    int na = h->size[a], nb = h->size[b], total = s->offset[h->dims];
+    memset(r, 0, sizeof(*r));
+    lap_workspace_init(&r->ws);
+    sparse_cost_init(&r->graph);
+    r->a = a;
+    r->b = b;
+    r->n = na + nb;
+    r->step_scale = 2.0;
+    r->best_lower = -INFINITY;
+    MdaSortItem* items = malloc(sizeof(MdaSortItem) * (h->count > 0 ? h->count : 1));
+    r->order = malloc(sizeof(int) * (h->count > 0 ? h->count : 1));
+    r->group_start = malloc(sizeof(int) * (h->count + 1));
+    r->group_row = malloc(sizeof(int) * (h->count > 0 ? h->count : 1));
+    r->group_col = malloc(sizeof(int) * (h->count > 0 ? h->count : 1));
+    r->best = malloc(sizeof(int) * (h->count > 0 ? h->count : 1));
+    r->row_empty = malloc(sizeof(int) * (na > 0 ? na : 1));
+    r->col_empty = malloc(sizeof(int) * (nb > 0 ? nb : 1));
+    r->lambda = calloc(total > 0 ? total : 1, sizeof(double));
+    r->usage = malloc(sizeof(int) * (total > 0 ? total : 1));
+    r->used = malloc(total > 0 ? total : 1);
+    r->rc = malloc(sizeof(double) * (h->count > 0 ? h->count : 1));
+    r->chosen = malloc(h->count > 0 ? h->count : 1);
+    r->feasible = malloc(h->count > 0 ? h->count : 1);
+    if (items == NULL || r->order == NULL || r->group_start == NULL || r->group_row == NULL || r->group_col == NULL ||
+        r->best == NULL || r->row_empty == NULL || r->col_empty == NULL ||
+        r->lambda == NULL || r->usage == NULL || r->used == NULL || r->rc == NULL || r->chosen == NULL ||
+        r->feasible == NULL) {
+        free(items);
+        return -1;
+    }
+
+    // 按(i_a, i_b)分组
+    for (int k = 0; k < h->count; k++) {
+        items[k].key = (double)(h->idx[k * h->dims + a] + 1) * (nb + 1) + h->idx[k * h->dims + b] + 1;
+        items[k].hyp = k;
+    }
+    qsort(items, h->count, sizeof(MdaSortItem), mda_item_cmp);
+    for (int k = 0; k < h->count; k++) {
+        r->order[k] = items[k].hyp;
+    }
+    for (int i = 0; i < na; i++) {
+        r->row_empty[i] = -1;
+    }
+    for (int j = 0; j < nb; j++) {
+        r->col_empty[j] = -1;
+    }
+    int edges = 0;
+    for (int k = 0; k < h->count; k++) {
+        int hyp = r->order[k];
+        if (k > 0 && items[k].key == items[k - 1].key) {
+            continue;
+        }
+        int g = r->groups++;
+        r->group_start[g] = k;
+        r->group_row[g] = h->idx[hyp * h->dims + a];
+        r->group_col[g] = h->idx[hyp * h->dims + b];
+        if (r->group_row[g] >= 0 && r->group_col[g] >= 0) {
+            edges++;
+        } else if (r->group_row[g] >= 0) {
+            r->row_empty[r->group_row[g]] = g;
+        } else if (r->group_col[g] >= 0) {
+            r->col_empty[r->group_col[g]] = g;
+        }
+    }
+    r->group_start[r->groups] = h->count;
+    free(items);
+
+    // 稀疏图：实行i为(i, j)边与自己的空列 nb+i；空行 na+j 为(空行, j)与每条边(i, j)对应的(na+j, nb+i)
+    int nnz = 2 * edges + na + nb;
+    r->edge_group = malloc(sizeof(int) * (nnz > 0 ? nnz : 1));
+    int* col_count = calloc(nb + 1, sizeof(int));
+    if (r->edge_group == NULL || col_count == NULL || sparse_cost_reserve(&r->graph, r->n, nnz > 0 ? nnz : 1) != 0) {
+        free(col_count);
+        return -1;
+    }
+    SparseCost* g = &r->graph;
+    g->rows = g->cols = r->n;
+    g->nnz = 0;
+    int grp = 0;
+    for (int i = 0; i < na; i++) {
+        g->row_ptr[i] = g->nnz;
+        while (grp < r->groups && r->group_row[grp] < i) {
+            grp++;
+        }
+        for (; grp < r->groups && r->group_row[grp] == i; grp++) {
+            if (r->group_col[grp] >= 0) {
+                g->col_idx[g->nnz] = r->group_col[grp];
+                r->edge_group[g->nnz++] = grp;
+                col_count[r->group_col[grp]]++;
+            }
+        }
+        g->col_idx[g->nnz] = nb + i;
+        r->edge_group[g->nnz++] = -2 - i; // 空列：成本取(i, -1)分组
+    }
+    // 空行按列j分桶，桶内i升序
+    int base = g->nnz;
+    g->row_ptr[na] = base;
+    int* fill = malloc(sizeof(int) * (nb + 1));
+    if (fill == NULL) {
+        free(col_count);
+        return -1;
+    }
+    fill[0] = base;
+    for (int j = 0; j < nb; j++) {
+        fill[j + 1] = fill[j] + 1 + col_count[j];
+    }
+    for (int j = 0; j < nb; j++) {
+        g->row_ptr[na + j] = fill[j];
+        g->col_idx[fill[j]] = j;
+        r->edge_group[fill[j]] = -2 - na - j; // (空行, j)：成本取(-1, j)分组
+        fill[j]++;
+    }
+    for (int i = 0; i < na; i++) {
+        for (int k = g->row_ptr[i]; k < g->row_ptr[i + 1] - 1; k++) {
+            int j = g->col_idx[k];
+            g->col_idx[fill[j]] = nb + i;
+            r->edge_group[fill[j]++] = -1;
+        }
+    }
+    g->nnz = nnz;
+    g->row_ptr[r->n] = nnz;
+    free(fill);
+    free(col_count);
+    return 0;
+}
+
+static void mda_relax_free(MdaRelax* r) {
+    free(r->group_start);
+    free(r->order);
+    free(r->group_row);
+    free(r->group_col);
+    free(r->row_empty);
+    free(r->col_empty);
+    free(r->edge_group);
+    free(r->lambda);
+    free(r->rc);
+    free(r->best);
+    free(r->usage);
+    free(r->chosen);
+    free(r->feasible);
+    free(r->used);
+    sparse_cost_free(&r->graph);
+    lap_workspace_free(&r->ws);
+}
+
+static bool mda_fits(const MdaSolver* s, const unsigned char* used, int hyp) {
+    const HypothesisList* h = &s->hyps;
+    for (int d = 0; d < h->dims; d++) {
+        int o = h->idx[hyp * h->dims + d];
+        if (o >= 0 && used[s->offset[d] + o]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void mda_take(const MdaSolver* s, unsigned char* used, int hyp) {
+    const HypothesisList* h = &s->hyps;
+    for (int d = 0; d < h->dims; d++) {
+        int o = h->idx[hyp * h->dims + d];
+        if (o >= 0) {
+            used[s->offset[d] + o] = 1;
+        }
+    }
+}
+
+// 稀疏图第k个元素的双精度成本：分组的最小约化成本，空配对为0，单帧缺失的分组为 min(0, 约化成本)
+static double mda_edge_cost(const MdaRelax* r, int na, int k) {
+    int e = r->edge_group[k];
+    if (e >= 0) {
+        return r->rc[r->best[e]];
+    }
+    if (e == -1) {
+        return 0.0;
+    }
+    int slot = -2 - e;
+    int g = slot < na ? r->row_empty[slot] : r->col_empty[slot - na];
+    return g >= 0 && r->rc[r->best[g]] < 0.0 ? r->rc[r->best[g]] : 0.0;
+}
+
+// 松弛(a, b)的一次次梯度迭代：求松弛问题得到下界，修复得到可行解，再更新乘子
+static void mda_relax_step(MdaRelax* r, const MdaSolver* s) {
+    const HypothesisList* h = &s->hyps;
+    int dims = h->dims, total = s->offset[dims];
+    int na = h->size[r->a];
+
+    // 约化成本与各分组中约化成本最小的假设
+    for (int k = 0; k < h->count; k++) {
+        double c = h->cost[k];
+        for (int d = 0; d < dims; d++) {
+            int o = h->idx[k * dims + d];
+            if (d != r->a && d != r->b && o >= 0) {
+                c += r->lambda[s->offset[d] + o];
+            }
+        }
+        r->rc[k] = c;
+    }
+    for (int g = 0; g < r->groups; g++) {
+        int best = r->order[r->group_start[g]];
+        for (int k = r->group_start[g] + 1; k < r->group_start[g + 1]; k++) {
+            best = r->rc[r->order[k]] < r->rc[best] ? r->order[k] : best;
+        }
+        r->best[g] = best;
+    }
+    SparseCost* graph = &r->graph;
+    for (int k = 0; k < graph->nnz; k++) {
+        graph->cost[k] = (float)mda_edge_cost(r, na, k);
+    }
+    CostView view = cost_view_sparse(graph);
+    if ((r->warm ? lap_solve_warm(&view, &r->ws) : lap_solve(&view, &r->ws)) != 0) {
+        r->error = 1;
+        return;
+    }
+    r->warm = true;
+
+    // 松弛解：匹配到的分组各取最优假设，两帧都缺失的分组取所有负约化成本的假设。
+    // 下界不用松弛解的双精度成本（它是float成本上的最优解，可能高于真正的拉格朗日对偶值），
+    // 而用LAP的列对偶：对任意v，sum_j v_j + sum_i min_j (c_ij - v_j) 按弱对偶不超过双精度成本上的最优值
+    memset(r->chosen, 0, h->count);
+    double lower = 0.0;
+    for (int j = 0; j < r->n; j++) {
+        lower += r->ws.v[j];
+    }
+    for (int i = 0; i < r->n; i++) {
+        double row_min = INFINITY;
+        for (int p = graph->row_ptr[i]; p < graph->row_ptr[i + 1]; p++) {
+            double c = mda_edge_cost(r, na, p) - r->ws.v[graph->col_idx[p]];
+            row_min = c < row_min ? c : row_min;
+        }
+        lower += row_min;
+    }
+    for (int d = 0; d < dims; d++) {
+        if (d == r->a || d == r->b) {
+            continue;
+        }
+        for (int o = 0; o < h->size[d]; o++) {
+            lower -= r->lambda[s->offset[d] + o];
+        }
+    }
+    for (int i = 0; i < r->n; i++) {
+        int k = -1, j = r->ws.row_to_col[i];
+        for (int p = graph->row_ptr[i]; p < graph->row_ptr[i + 1]; p++) {
+            if (graph->col_idx[p] == j) {
+                k = p;
+                break;
+            }
+        }
+        if (k < 0 || r->edge_group[k] == -1) {
+            continue;
+        }
+        int e = r->edge_group[k], g = e;
+        if (e < -1) {
+            int slot = -2 - e;
+            g = slot < na ? r->row_empty[slot] : r->col_empty[slot - na];
+            if (g < 0 || r->rc[r->best[g]] >= 0.0) {
+                continue;
+            }
+        }
+        r->chosen[r->best[g]] = 1;
+    }
+    for (int g = 0; g < r->groups; g++) {
+        if (r->group_row[g] < 0 && r->group_col[g] < 0) {
+            for (int k = r->group_start[g]; k < r->group_start[g + 1]; k++) {
+                if (r->rc[r->order[k]] < 0.0) {
+                    r->chosen[r->order[k]] = 1;
+                    lower += r->rc[r->order[k]];
+                }
+            }
+        }
+    }
+    r->lower_bound = lower;
+
+    // 修复：先按原始成本贪心保留松弛解中不冲突的假设，再用其余负成本假设补充
+    memset(r->used, 0, total);
+    memset(r->feasible, 0, h->count);
+    memset(r->usage, 0, sizeof(int) * total);
+    double upper = 0.0;
+    for (int pass = 0; pass < 2; pass++) {
+        for (int k = 0; k < h->count; k++) {
+            int hyp = s->by_cost[k];
+            if (h->cost[hyp] >= 0.0f) {
+                break;
+            }
+            if ((pass == 0 && !r->chosen[hyp]) || r->feasible[hyp] || !mda_fits(s, r->used, hyp)) {
+                continue;
+            }
+            mda_take(s, r->used, hyp);
+            r->feasible[hyp] = 1;
+            upper += h->cost[hyp];
+        }
+    }
+    r->upper_bound = upper;
+
+    // 次梯度：被松弛的约束 sum x - 1 <= 0，投影到lambda >= 0
+    for (int k = 0; k < h->count; k++) {
+        if (!r->chosen[k]) {
+            continue;
+        }
+        for (int d = 0; d < dims; d++) {
+            int o = h->idx[k * dims + d];
+            if (d != r->a && d != r->b && o >= 0) {
+                r->usage[s->offset[d] + o]++;
+            }
+        }
+    }
+    double norm = 0.0;
+    for (int d = 0; d < dims; d++) {
+        if (d == r->a || d == r->b) {
+            continue;
+        }
+        for (int o = s->offset[d]; o < s->offset[d + 1]; o++) {
+            double g = r->usage[o] - 1.0;
+            if (g > 0.0 || r->lambda[o] > 0.0) {
+                norm += g * g;
+            }
+        }
+    }
+    if (lower > r->best_lower + 1e-9 * fabs(r->best_lower)) {
+        r->best_lower = lower;
+        r->stall = 0;
+    } else if (++r->stall >= 5) {
+        r->step_scale *= 0.5;
+        r->stall = 0;
+    }
+    double target = s->global_upper < upper ? s->global_upper : upper;
+    if (norm == 0.0) {
+        return;
+    }
+    double step = r->step_scale * (target - lower) / norm;
+    if (step <= 0.0) {
+        step = r->step_scale * 1e-3 / norm;
+    }
+    for (int d = 0; d < dims; d++) {
+        if (d == r->a || d == r->b) {
+            continue;
+        }
+        for (int o = s->offset[d]; o < s->offset[d + 1]; o++) {
+            double v = r->lambda[o] + step * (r->usage[o] - 1.0);
+            r->lambda[o] = v > 0.0 ? v : 0.0;
+        }
+    }
+}
+
+static void mda_parallel_step(int begin, int end, int worker, void* arg) {
+    MdaSolver* s = arg;
+    (void)worker;
+    for (int k = begin; k < end; k++) {
+        mda_relax_step(&s->relax[k], s);
+    }
+}
+
+void mda_solver_free(MdaSolver* s) {
+    for (int k = 0; k < s->relaxations; k++) {
+        mda_relax_free(&s->relax[k]);
+    }
+    free(s->relax);
+    free(s->by_cost);
+    free(s->selected);
+    memset(s, 0, sizeof(*s));
+}
+
+// 建立求解器：对每对相邻帧(s, s+1)各建一个松弛。hyps的数组在求解期间保持有效。
+// 返回0成功，-1参数非法（帧数不在3..MDA_MAX_DIMS、对象下标越界）或内存不足
+int mda_solver_init(MdaSolver* s, const HypothesisList* hyps) {
+    memset(s, 0, sizeof(*s));
+    if (hyps->dims < 3 || hyps->dims > MDA_MAX_DIMS || hyps->count < 0) {
+        return -1;
+    }
+    for (int d = 0; d < hyps->dims; d++) {
+        if (hyps->size[d] < 0) {
+            return -1;
+        }
+    }
+    // 对象下标必须在 [-1, size[d]) 内（-1为该帧缺失）
+    for (int k = 0; k < hyps->count; k++) {
+        for (int d = 0; d < hyps->dims; d++) {
+            int o = hyps->idx[k * hyps->dims + d];
+            if (o < -1 || o >= hyps->size[d]) {
+                return -1;
+            }
+        }
+    }
+    s->hyps = *hyps;
+    for (int d = 0; d < hyps->dims; d++) {
+        s->offset[d + 1] = s->offset[d] + hyps->size[d];
+    }
+    s->by_cost = malloc(sizeof(int) * (hyps->count > 0 ? hyps->count : 1));
+    s->selected = calloc(hyps->count > 0 ? hyps->count : 1, 1);
+    s->relax = calloc(hyps->dims - 1, sizeof(MdaRelax));
+    if (s->by_cost == NULL || s->selected == NULL || s->relax == NULL) {
+        mda_solver_free(s);
+        return -1;
+    }
+    MdaSortItem* items = malloc(sizeof(MdaSortItem) * (hyps->count > 0 ? hyps->count : 1));
+    if (items == NULL) {
+        mda_solver_free(s);
+        return -1;
+    }
+    for (int k = 0; k < hyps->count; k++) {
+        items[k].key = hyps->cost[k];
+        items[k].hyp = k;
+    }
+    qsort(items, hyps->count, sizeof(MdaSortItem), mda_item_cmp);
+    for (int k = 0; k < hyps->count; k++) {
+        s->by_cost[k] = items[k].hyp;
+    }
+    free(items);
+    for (int d = 0; d + 1 < hyps->dims; d++) {
+        s->relaxations++;
+        if (mda_relax_build(&s->relax[d], s, d, d + 1) != 0) {
+            mda_solver_free(s);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// 迭代到达到目标间隙、迭代上限或时间预算。结果在s->selected、lower_bound、upper_bound、gap中。
+// 返回0成功，-1内存不足
+int mda_solve(MdaSolver* s, const MdaParams* params) {
+    long long t0 = monotonic_ns();
+    s->lower_bound = -INFINITY;
+    s->upper_bound = 0.0; // 什么都不选是可行解
+    s->global_upper = 0.0;
+    memset(s->selected, 0, s->hyps.count);
+    s->iterations = 0;
+    s->gap = INFINITY;
+    for (int it = 0; it < params->max_iterations; it++) {
+        worker_pool_parallel_for(params->pool, s->relaxations, 1, mda_parallel_step, s);
+        s->iterations++;
+        for (int k = 0; k < s->relaxations; k++) {
+            MdaRelax* r = &s->relax[k];
+            if (r->error) {
+                return -1;
+            }
+            s->lower_bound = r->lower_bound > s->lower_bound ? r->lower_bound : s->lower_bound;
+            if (r->upper_bound < s->upper_bound) {
+                s->upper_bound = r->upper_bound;
+                memcpy(s->selected, r->feasible, s->hyps.count);
+            }
+        }
+        s->global_upper = s->upper_bound;
+        double scale = fabs(s->upper_bound) > 1e-9 ? fabs(s->upper_bound) : 1.0;
+        s->gap = (s->upper_bound - s->lower_bound) / scale;
+        s->elapsed_ms = (monotonic_ns() - t0) / 1e6;
+        if (s->gap <= params->target_gap || (params->time_budget_ms > 0.0 && s->elapsed_ms >= params->time_budget_ms)) {
+            break;
+        }
+    }
+    s->elapsed_ms = (monotonic_ns() - t0) / 1e6;
+    return 0;
+}
+
+void greedy_workspace_init(GreedyWorkspace* ws) {
+    memset(ws, 0, sizeof(*ws));
+}
+
+void greedy_workspace_free(GreedyWorkspace* ws) {
+    free(ws->penalty);
+    free(ws->row_pot);
+    free(ws->col_pot);
+    free(ws->row_min);
+    free(ws->row_arg);
+    free(ws->row_to_col);
+    free(ws->col_to_row);
+    free(ws->cand);
+    free(ws->cand_pos);
+    free(ws->heap);
+    free(ws->col_min);
+    greedy_workspace_init(ws);
+}
+
+static int greedy_workspace_reserve(GreedyWorkspace* ws, int rows, int cols, int candidates) {
+    if (rows > ws->row_capacity) {
+        float* row_min = realloc(ws->row_min, sizeof(float) * rows);
+        if (row_min == NULL) {
+            return -1;
+        }
+        ws->row_min = row_min;
+        int* row_arg = realloc(ws->row_arg, sizeof(int) * rows);
+        if (row_arg == NULL) {
+            return -1;
+        }
+        ws->row_arg = row_arg;
+        int* row_to_col = realloc(ws->row_to_col, sizeof(int) * rows);
+        if (row_to_col == NULL) {
+            return -1;
+        }
+        ws->row_to_col = row_to_col;
+        float* row_pot = realloc(ws->row_pot, sizeof(float) * rows);
+        if (row_pot == NULL) {
+            return -1;
+        }
+        ws->row_pot = row_pot;
+        int* cand_pos = realloc(ws->cand_pos, sizeof(int) * rows);
+        if (cand_pos == NULL) {
+            return -1;
+        }
+        ws->cand_pos = cand_pos;
+        int* heap = realloc(ws->heap, sizeof(int) * rows);
+        if (heap == NULL) {
+            return -1;
+        }
+        ws->heap = heap;
+        ws->row_capacity = rows;
+    }
+    if (cols > ws->col_capacity) {
+        float* penalty = realloc(ws->penalty, sizeof(float) * cols);
+        if (penalty == NULL) {
+            return -1;
+        }
+        ws->penalty = penalty;
+        int* col_to_row = realloc(ws->col_to_row, sizeof(int) * cols);
+        if (col_to_row == NULL) {
+            return -1;
+        }
+        ws->col_to_row = col_to_row;
+        double* col_min = realloc(ws->col_min, sizeof(double) * cols);
+        if (col_min == NULL) {
+            return -1;
+        }
+        ws->col_min = col_min;
+        float* col_pot = realloc(ws->col_pot, sizeof(float) * cols);
+        if (col_pot == NULL) {
+            return -1;
+        }
+        ws->col_pot = col_pot;
+        ws->col_capacity = cols;
+    }
+    if ((long long)rows * candidates > ws->cand_capacity) {
+        int* cand = realloc(ws->cand, sizeof(int) * rows * candidates);
+        if (cand == NULL) {
+            return -1;
+        }
+        ws->cand = cand;
+        ws->cand_capacity = rows * candidates;
+    }
+    return 0;
+}
+
+// 未占用列上的最小代价及其列（相同时取较小的列），没有可用列时返回+inf、*arg为-1
+static float greedy_row_argmin(const float* row, const float* penalty, int cols, int* arg) {
+    vfloat best = vf_set1(INFINITY);
+    vmask best_idx = {0}, idx, step;
+    for (int l = 0; l < VEC_WIDTH; l++) {
+        idx[l] = l;
+        step[l] = VEC_WIDTH;
+    }
+    int j = 0;
+    for (; j + VEC_WIDTH <= cols; j += VEC_WIDTH) {
+        vfloat v = vf_load(row + j) + vf_load(penalty + j);
+        vmask better = v < best;
+        best = vf_select(better, v, best);
+        best_idx = (better & idx) | (~better & best_idx);
+        idx += step;
+    }
+    float m = INFINITY;
+    int a = -1;
+    for (int l = 0; l < VEC_WIDTH; l++) {
+        if (best[l] < m || (best[l] == m && a != -1 && best_idx[l] < a)) {
+            m = best[l];
+            a = best_idx[l];
+        }
+    }
+    for (; j < cols; j++) {
+        float v = row[j] + penalty[j];
+        if (v < m) {
+            m = v;
+            a = j;
+        }
+    }
+    *arg = m == INFINITY ? -1 : a;
+    return m;
+}
+
+static inline double greedy_cost(const float* cost, int stride, int i, int j) {
+    float c = cost[(size_t)i * stride + j];
+    return IS_DISALLOWED(c) ? INFINITY : c;
+}
+
+static void greedy_assign(GreedyWorkspace* ws, int i, int j) {
+    int old = ws->row_to_col[i];
+    if (old >= 0) {
+        ws->col_to_row[old] = -1;
+        ws->penalty[old] = 0.0f;
+    }
+    if (j >= 0) {
+        ws->col_to_row[j] = i;
+        ws->penalty[j] = INFINITY;
+    }
+    ws->row_to_col[i] = j;
+}
+
+// 行归约再列归约（同step1），全为DISALLOWED的列 v_j 取0
+static void greedy_reduce(const float* cost, int rows, int cols, int stride, GreedyWorkspace* ws) {
+    float* v = ws->col_pot;
+    for (int j = 0; j < cols; j++) {
+        v[j] = INFINITY;
+    }
+    for (int i = 0; i < rows; i++) {
+        const float* row = cost + (size_t)i * stride;
+        // 两组累加器交替，避免最小值的依赖链限制吞吐
+        vfloat lane_min = vf_set1(INFINITY), lane_min2 = lane_min;
+        int j = 0;
+        for (; j + 2 * VEC_WIDTH <= cols; j += 2 * VEC_WIDTH) {
+            lane_min = vf_min(lane_min, vf_load(row + j));
+            lane_min2 = vf_min(lane_min2, vf_load(row + j + VEC_WIDTH));
+        }
+        for (; j + VEC_WIDTH <= cols; j += VEC_WIDTH) {
+            lane_min = vf_min(lane_min, vf_load(row + j));
+        }
+        lane_min = vf_min(lane_min, lane_min2);
+        float r = INFINITY;
+        for (int l = 0; l < VEC_WIDTH; l++) {
+            r = lane_min[l] < r ? lane_min[l] : r;
+        }
+        for (; j < cols; j++) {
+            r = row[j] < r ? row[j] : r;
+        }
+        ws->row_pot[i] = r;
+        if (r == INFINITY) {
+            continue;
+        }
+        vfloat rv = vf_set1(r);
+        j = 0;
+        for (; j + VEC_WIDTH <= cols; j += VEC_WIDTH) {
+            vf_store(v + j, vf_min(vf_load(row + j) - rv, vf_load(v + j)));
+        }
+        for (; j < cols; j++) {
+            float reduced = row[j] - r;
+            v[j] = reduced < v[j] ? reduced : v[j];
+        }
+    }
+    for (int j = 0; j < cols; j++) {
+        v[j] = v[j] == INFINITY ? 0.0f : v[j];
+    }
+}
+
+// 行堆的顺序：约化成本小的在前，相同时行号小的在前
+static inline bool greedy_heap_less(const GreedyWorkspace* ws, int a, int b) {
+    return ws->row_min[a] < ws->row_min[b] || (ws->row_min[a] == ws->row_min[b] && a < b);
+}
+
+static void greedy_heap_push(GreedyWorkspace* ws, int* size, int i) {
+    int p = (*size)++;
+    while (p > 0 && greedy_heap_less(ws, i, ws->heap[(p - 1) / 2])) {
+        ws->heap[p] = ws->heap[(p - 1) / 2];
+        p = (p - 1) / 2;
+    }
+    ws->heap[p] = i;
+}
+
+static int greedy_heap_pop(GreedyWorkspace* ws, int* size) {
+    int top = ws->heap[0];
+    int last = ws->heap[--(*size)];
+    int p = 0;
+    while (2 * p + 1 < *size) {
+        int child = 2 * p + 1;
+        if (child + 1 < *size && greedy_heap_less(ws, ws->heap[child + 1], ws->heap[child])) {
+            child++;
+        }
+        if (!greedy_heap_less(ws, ws->heap[child], last)) {
+            break;
+        }
+        ws->heap[p] = ws->heap[child];
+        p = child;
+    }
+    ws->heap[p] = last;
+    return top;
+}
+
+// 行i在未占用列上的最小约化成本（写入row_min/row_arg，没有可用列时row_arg为-1）。
+// 候选列按约化成本升序，第一个未占用的即为最小；候选都被占用后才整行扫描
+static void greedy_row_best(const float* cost, int stride, int k, GreedyWorkspace* ws, int i) {
+    const float* row = cost + (size_t)i * stride;
+    for (; ws->cand_pos[i] < k; ws->cand_pos[i]++) {
+        int j = ws->cand[(size_t)i * k + ws->cand_pos[i]];
+        if (j < 0) {
+            // 候选不足k个：该行允许的列都在候选中且已被占用
+            ws->row_arg[i] = -1;
+            ws->row_min[i] = INFINITY;
+            return;
+        }
+        if (ws->col_to_row[j] < 0) {
+            ws->row_arg[i] = j;
+            ws->row_min[i] = (row[j] + ws->penalty[j]) - ws->row_pot[i];
+            return;
+        }
+    }
+    ws->row_min[i] = greedy_row_argmin(row, ws->penalty, ws->cols, &ws->row_arg[i]) - ws->row_pot[i];
+}
+
+// 约化成本上的全局最小贪心：各行的最小值放在小根堆中，每次弹出最小的一行。
+// 其最小值所在列已被别的行占用时（堆中的值偏小）重算后放回，不必扫描其他行
+static void greedy_initial(const float* cost, int rows, int cols, int stride, int k, GreedyWorkspace* ws) {
+    for (int j = 0; j < cols; j++) {
+        ws->penalty[j] = -ws->col_pot[j];
+        ws->col_to_row[j] = -1;
+    }
+    int size = 0;
+    for (int i = 0; i < rows; i++) {
+        ws->row_to_col[i] = -1;
+        ws->cand_pos[i] = 0;
+        greedy_row_best(cost, stride, k, ws, i);
+        if (ws->row_arg[i] >= 0) {
+            greedy_heap_push(ws, &size, i);
+        }
+    }
+    while (size > 0) {
+        int i = greedy_heap_pop(ws, &size);
+        int j = ws->row_arg[i];
+        if (ws->col_to_row[j] >= 0) {
+            greedy_row_best(cost, stride, k, ws, i);
+            if (ws->row_arg[i] >= 0) {
+                greedy_heap_push(ws, &size, i);
+            }
+            continue;
+        }
+        ws->row_to_col[i] = j;
+        ws->col_to_row[j] = i;
+        ws->penalty[j] = INFINITY;
+    }
+    // 局部搜索阶段的占用标记只区分空闲与占用
+    for (int j = 0; j < cols; j++) {
+        ws->penalty[j] = ws->col_to_row[j] >= 0 ? INFINITY : 0.0f;
+    }
+}
+
+// 每行约化成本最小的k列（升序，相同时列号小的在前；插入排序，k很小）。
+// 先用四组累加器求各通道的最小值（4 * VEC_WIDTH个，分别取自互不相交的元素），
+// k不超过其个数时，其中第k小的值之下至少有k个元素，作为初始上界；
+// 之后整块都超过上界（已满k个时为当前第k小）的向量化跳过
+static void greedy_candidates(const float* cost, int rows, int cols, int stride, int k, GreedyWorkspace* ws) {
+    const float* v = ws->col_pot;
+    for (int i = 0; i < rows; i++) {
+        const float* row = cost + (size_t)i * stride;
+        int* cand = ws->cand + (size_t)i * k;
+        float key[64];
+        int n = 0;
+        float limit = INFINITY;
+        if (k <= 4 * VEC_WIDTH) {
+            vfloat acc[4];
+            for (int a = 0; a < 4; a++) {
+                acc[a] = vf_set1(INFINITY);
+            }
+            int j = 0;
+            for (; j + 4 * VEC_WIDTH <= cols; j += 4 * VEC_WIDTH) {
+                for (int a = 0; a < 4; a++) {
+                    acc[a] = vf_min(acc[a], vf_load(row + j + a * VEC_WIDTH) - vf_load(v + j + a * VEC_WIDTH));
+                }
+            }
+            for (int a = 0; j + VEC_WIDTH <= cols; j += VEC_WIDTH, a++) {
+                acc[a] = vf_min(acc[a], vf_load(row + j) - vf_load(v + j));
+            }
+            float lanes[4 * VEC_WIDTH];
+            for (int l = 0; l < 4 * VEC_WIDTH; l++) {
+                float x = acc[l / VEC_WIDTH][l % VEC_WIDTH];
+                int p = l < k ? l : k;
+                if (p == k && !(x < lanes[k - 1])) {
+                    continue;
+                }
+                p = p == k ? k - 1 : p;
+                while (p > 0 && lanes[p - 1] > x) {
+                    lanes[p] = lanes[p - 1];
+                    p--;
+                }
+                lanes[p] = x;
+            }
+            limit = lanes[k - 1];
+        }
+        int j = 0;
+        while (j < cols) {
+            if (j + VEC_WIDTH <= cols && !vm_any(vf_load(row + j) - vf_load(v + j) <= vf_set1(limit))) {
+                j += VEC_WIDTH;
+                continue;
+            }
+            int end = j + VEC_WIDTH < cols ? j + VEC_WIDTH : cols;
+            for (; j < end; j++) {
+                float c = row[j] - v[j];
+                if (IS_DISALLOWED(row[j]) || !(n < k ? c <= limit : c < limit)) {
+                    continue;
+                }
+                int p = n < k ? n++ : k - 1;
+                while (p > 0 && key[p - 1] > c) {
+                    cand[p] = cand[p - 1];
+                    key[p] = key[p - 1];
+                    p--;
+                }
+                cand[p] = j;
+                key[p] = c;
+                limit = n == k ? key[k - 1] : limit;
+            }
+        }
+        for (; n < k; n++) {
+            cand[n] = -1;
+        }
+    }
+}
+
+// 约化成本 c_ij - r_i - v_j（非负；DISALLOWED为+inf）。交换类移动中势相互抵消，增益与原成本相同
+static inline double greedy_reduced(const float* cost, int stride, const GreedyWorkspace* ws, int i, int j) {
+    return greedy_cost(cost, stride, i, j) - ws->row_pot[i] - ws->col_pot[j];
+}
+
+// 一轮局部搜索，返回改进步数。移动与交换都只考察各行的候选列，一轮为O(rows * k^2)
+static int greedy_improve(const float* cost, int rows, int cols, int stride, int k, GreedyWorkspace* ws) {
+    const double eps = 1e-9;
+    int moves = 0;
+    int* r2c = ws->row_to_col;
+    int* c2r = ws->col_to_row;
+    int matched = 0;
+    for (int i = 0; i < rows; i++) {
+        matched += r2c[i] >= 0;
+    }
+    // 移到更便宜的空闲列：已匹配的行只看候选列，未匹配的行（借此补上）整行扫描
+    for (int i = 0; i < rows && matched < cols; i++) {
+        int a = r2c[i], f = -1;
+        double m = INFINITY;
+        if (a < 0 || k == 0) {
+            m = greedy_row_argmin(cost + (size_t)i * stride, ws->penalty, cols, &f);
+        } else {
+            for (int x = 0; x < k; x++) {
+                int b = ws->cand[(size_t)i * k + x];
+                if (b < 0) {
+                    break;
+                }
+                if (c2r[b] < 0 && greedy_cost(cost, stride, i, b) < m) {
+                    m = greedy_cost(cost, stride, i, b);
+                    f = b;
+                }
+            }
+        }
+        if (f >= 0 && (a < 0 || m < greedy_cost(cost, stride, i, a) - eps)) {
+            matched += a < 0;
+            greedy_assign(ws, i, f);
+            moves++;
+        }
+    }
+    // 两行交换（2-opt）：i 取候选列 b，b 原来的行 t 取 i 的列 a（i未匹配时t让出b）
+    for (int i = 0; i < rows; i++) {
+        for (int x = 0; x < k; x++) {
+            int a = r2c[i], b = ws->cand[(size_t)i * k + x];
+            int t = b >= 0 ? c2r[b] : -1;
+            if (t < 0 || t == i) {
+                continue;
+            }
+            double before = (a >= 0 ? greedy_cost(cost, stride, i, a) : 0.0) + greedy_cost(cost, stride, t, b);
+            double after = greedy_cost(cost, stride, i, b) + (a >= 0 ? greedy_cost(cost, stride, t, a) : 0.0);
+            if (after < before - eps) {
+                r2c[i] = b;
+                c2r[b] = i;
+                r2c[t] = a;
+                if (a >= 0) {
+                    c2r[a] = t;
+                }
+                moves++;
+            }
+        }
+    }
+    // 已匹配边的约化成本（松弛），用于剪枝三行轮换
+    double* slack = ws->col_min; // 借用：行不多于列时按行存放
+    double max_slack = 0.0;
+    if (rows <= cols) {
+        for (int i = 0; i < rows; i++) {
+            slack[i] = r2c[i] >= 0 ? greedy_reduced(cost, stride, ws, i, r2c[i]) : 0.0;
+            max_slack = slack[i] > max_slack ? slack[i] : max_slack;
+        }
+    }
+    // 三行轮换：i 取 t 的列 b，t 取 s 的列 c，s 取 i 的列 a；b、c 取自各自行的候选列。
+    // 约化成本下增益为 rc(i,a) + rc(t,b) - rc(i,b) + rc(s,c) - rc(t,c) - rc(s,a)，后三项不超过 slack_s
+    for (int i = 0; i < rows && k > 0; i++) {
+        int a = r2c[i];
+        if (a < 0) {
+            continue;
+        }
+        double slack_i = greedy_reduced(cost, stride, ws, i, a);
+        for (int x = 0; x < k; x++) {
+            int b = ws->cand[(size_t)i * k + x];
+            int t = b >= 0 ? c2r[b] : -1;
+            if (t < 0 || t == i) {
+                continue;
+            }
+            double gain_it = slack_i + greedy_reduced(cost, stride, ws, t, b) - greedy_reduced(cost, stride, ws, i, b);
+            if (rows <= cols && gain_it + max_slack <= eps) {
+                continue;
+            }
+            for (int y = 0; y < k; y++) {
+                int c = ws->cand[(size_t)t * k + y];
+                int s = c >= 0 ? c2r[c] : -1;
+                if (s < 0 || s == i || s == t) {
+                    continue;
+                }
+                double rest = greedy_reduced(cost, stride, ws, s, c) - greedy_reduced(cost, stride, ws, t, c) -
+                              greedy_reduced(cost, stride, ws, s, a);
+                if (gain_it + rest > eps) {
+                    r2c[i] = b;
+                    c2r[b] = i;
+                    r2c[t] = c;
+                    c2r[c] = t;
+                    r2c[s] = a;
+                    c2r[a] = s;
+                    if (rows <= cols) {
+                        slack[t] = greedy_reduced(cost, stride, ws, t, c);
+                        slack[s] = greedy_reduced(cost, stride, ws, s, a);
+                        max_slack = slack[t] > max_slack ? slack[t] : max_slack;
+                        max_slack = slack[s] > max_slack ? slack[s] : max_slack;
+                    }
+                    moves++;
+                    break;
+                }
+            }
+            if (r2c[i] != a) {
+                break;
+            }
+        }
+    }
+    return moves;
+}
+
+// 对偶下界：方阵为 sum r_i + sum v_j；行少于列时列对偶须 <= 0，只能用 sum r_i；行多于列时用列最小值之和
+static double greedy_lower_bound(const float* cost, int rows, int cols, int stride, GreedyWorkspace* ws) {
+    double bound = 0.0;
+    if (rows <= cols) {
+        for (int i = 0; i < rows; i++) {
+            if (ws->row_pot[i] == INFINITY) {
+                return -INFINITY;
+            }
+            bound += ws->row_pot[i];
+        }
+        for (int j = 0; rows == cols && j < cols; j++) {
+            bound += ws->col_pot[j];
+        }
+        return bound;
+    }
+    for (int j = 0; j < cols; j++) {
+        ws->col_min[j] = INFINITY;
+    }
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < cols; j++) {
+            double c = greedy_cost(cost, stride, i, j);
+            ws->col_min[j] = c < ws->col_min[j] ? c : ws->col_min[j];
+        }
+    }
+    for (int j = 0; j < cols; j++) {
+        if (ws->col_min[j] == INFINITY) {
+            return -INFINITY;
+        }
+        bound += ws->col_min[j];
+    }
+    return bound;
+}
+
+// 统计当前匹配的代价与差距，返回配对数。下界只对覆盖较短一边的匹配成立，否则差距为+inf
+static int greedy_measure(const float* cost, int rows, int cols, int stride, double bound, GreedyWorkspace* ws) {
+    double total = 0.0;
+    int matched = 0;
+    for (int i = 0; i < rows; i++) {
+        if (ws->row_to_col[i] >= 0) {
+            total += cost[(size_t)i * stride + ws->row_to_col[i]];
+            matched++;
+        }
+    }
+    ws->cost = (float)total;
+    ws->lower_bound = matched == (rows < cols ? rows : cols) ? bound : -INFINITY;
+    ws->gap = total - ws->lower_bound;
+    ws->rel_gap = ws->gap / (fabs(total) > 1e-12 ? fabs(total) : 1e-12);
+    if (ws->gap < 0.0) {
+        ws->gap = 0.0; // 浮点舍入
+        ws->rel_gap = 0.0;
+    }
+    return matched;
+}
+
+// 近似求解稠密成本矩阵（行跨度stride），params为NULL时用默认参数。
+// 贪心或某轮局部搜索后证明差距已不超过target_gap时提前结束。返回0成功，-1内存不足
+int greedy_solve(const float* cost, int rows, int cols, int stride, const GreedyParams* params, GreedyWorkspace* ws) {
+    long long t0 = metrics_start();
+    GreedyParams p = params != NULL ? *params : (GreedyParams){4, 4, 1e-3};
+    int k = p.candidates > 0 ? (p.candidates < 64 ? p.candidates : 64) : 0;
+    if (greedy_workspace_reserve(ws, rows, cols, k) != 0) {
+        metrics_record(ENGINE_GREEDY, rows, cols, t0, 0, 0, true);
+        return -1;
+    }
+    ws->rows = rows;
+    ws->cols = cols;
+    ws->passes = 0;
+    ws->moves = 0;
+    greedy_reduce(cost, rows, cols, stride, ws);
+    double bound = greedy_lower_bound(cost, rows, cols, stride, ws);
+    if (k > 0) {
+        greedy_candidates(cost, rows, cols, stride, k, ws);
+    }
+    greedy_initial(cost, rows, cols, stride, k, ws);
+    int matched = greedy_measure(cost, rows, cols, stride, bound, ws);
+    while (ws->passes < p.max_passes && ws->rel_gap > p.target_gap) {
+        ws->passes++;
+        int moves = greedy_improve(cost, rows, cols, stride, k, ws);
+        ws->moves += moves;
+        matched = greedy_measure(cost, rows, cols, stride, bound, ws);
+        if (moves == 0) {
+            break;
+        }
+    }
+    int unmatched = (rows < cols ? rows : cols) - matched;
+    metrics_record(ENGINE_GREEDY, rows, cols, t0, matched, unmatched > 0 ? unmatched : 0, false);
+    return 0;
+}
+
+int greedy_get_results(const GreedyWorkspace* ws, Assignment results[]) {
+    int count = 0;
+    for (int i = 0; i < ws->rows; i++) {
+        if (ws->row_to_col[i] >= 0) {
+            results[count].row = i;
+            results[count].col = ws->row_to_col[i];
+            count++;
+        }
+    }
+    return count;
+}
+
+const char* const strategy_names[STRATEGY_COUNT] = {"tiny", "munkres", "lap", "sparse", "parallel", "greedy"};
+
+const float dispatch_densities[DISPATCH_DENSITY_BUCKETS] = {1.0f, 0.2f, 0.03f};
+
+static int float_ascending(const void* a, const void* b) {
+    float x = *(const float*)a, y = *(const float*)b;
+    return x < y ? -1 : x > y;
+}
+
+void dispatch_workspace_init(DispatchWorkspace* ws) {
+    lap_workspace_init(&ws->lap);
+    sparse_cost_init(&ws->sparse);
+    greedy_workspace_init(&ws->greedy);
+    ws->square = NULL;
+}
+
+void dispatch_workspace_free(DispatchWorkspace* ws) {
+    lap_workspace_free(&ws->lap);
+    sparse_cost_free(&ws->sparse);
+    greedy_workspace_free(&ws->greedy);
+    free(ws->square);
+    ws->square = NULL;
+}
+
+// 内置默认参数（单核x86-64上测得），没有校准或加载profile时使用
+void dispatcher_init(Dispatcher* d) {
+    static const double defaults[DISPATCH_DENSITY_BUCKETS][STRATEGY_COUNT][2] = {
+        {{4e-4, 1.0}, {2e-5, 2.6}, {1.5e-5, 2.3}, {2e-5, 2.3}, {4e-5, 2.1}, {0.0, 0.0}},
+        {{4e-4, 1.0}, {0.0, 0.0}, {1e-5, 2.2}, {5e-6, 2.2}, {3e-5, 2.0}, {0.0, 0.0}},
+        {{4e-4, 1.0}, {0.0, 0.0}, {8e-6, 2.1}, {2e-6, 2.1}, {2e-5, 2.0}, {0.0, 0.0}},
+    };
+    memset(d, 0, sizeof(*d));
+    for (int k = 0; k < DISPATCH_DENSITY_BUCKETS; k++) {
+        for (int s = 0; s < STRATEGY_COUNT; s++) {
+            d->fit[k][s].a = defaults[k][s][0];
+            d->fit[k][s].b = defaults[k][s][1];
+            d->fit[k][s].valid = defaults[k][s][0] > 0.0;
+        }
+    }
+}
+
+// 扫描密度并抽样估计平局比例；lines_ok表示没有任何DISALLOWED元素（Munkres的适用条件）
+static void dispatch_features(const float* cost, int rows, int cols, int stride, DispatchDecision* out, bool* lines_ok) {
+    long long admissible = 0;
+    for (int i = 0; i < rows; i++) {
+        const float* row = cost + (size_t)i * stride;
+        int count = 0;
+        for (int j = 0; j < cols; j++) {
+            count += !IS_DISALLOWED(row[j]);
+        }
+        admissible += count;
+    }
+    long long cells = (long long)rows * cols;
+    out->rows = rows;
+    out->cols = cols;
+    out->density = cells > 0 ? (double)admissible / cells : 1.0;
+    *lines_ok = admissible == cells;
+
+    float sample[DISPATCH_TIE_SAMPLES];
+    int n = 0;
+    // 等间隔抽取互不相同的元素
+    int samples = cells < DISPATCH_TIE_SAMPLES ? (int)cells : DISPATCH_TIE_SAMPLES;
+    for (int k = 0; k < samples; k++) {
+        long long e = (long long)k * cells / samples;
+        float v = cost[(size_t)(e / cols) * stride + e % cols];
+        if (!IS_DISALLOWED(v)) {
+            sample[n++] = v;
+        }
+    }
+    qsort(sample, n, sizeof(float), float_ascending);
+    int tied = 0;
+    for (int k = 0; k < n; k++) {
+        tied += (k > 0 && sample[k] == sample[k - 1]) || (k + 1 < n && sample[k] == sample[k + 1]);
+    }
+    out->tie_ratio = n > 0 ? (double)tied / n : 0.0;
+}
+
+// 按预测耗时选择策略
+static Strategy dispatch_choose(const Dispatcher* d, const DispatchDecision* f, bool lines_ok, const WorkerPool* pool,
+                                double* predicted) {
+    int n_max = f->rows > f->cols ? f->rows : f->cols;
+    double n = sqrt((double)f->rows * f->cols);
+    // 密度分档：取对数距离最近的一档
+    int bucket = 0;
+    for (int k = 1; k < DISPATCH_DENSITY_BUCKETS; k++) {
+        if (fabs(log(f->density + 1e-6) - log(dispatch_densities[k])) <
+            fabs(log(f->density + 1e-6) - log(dispatch_densities[bucket]))) {
+            bucket = k;
+        }
+    }
+    bool eligible[STRATEGY_COUNT] = {
+        n_max <= TINY_MAX_SIZE,
+        n_max <= MAX_SIZE && lines_ok,
+        true,
+        true,
+        pool != NULL && pool->threads >= 2 && n_max >= LAP_PARALLEL_MIN_COLS,
+        false,
+    };
+    Strategy best = STRATEGY_LAP;
+    *predicted = INFINITY;
+    for (int s = 0; s < STRATEGY_COUNT; s++) {
+        const StrategyFit* fit = &d->fit[bucket][s];
+        if (!eligible[s] || !fit->valid) {
+            continue;
+        }
+        double t = fit->a * pow(n, fit->b);
+        if (t < *predicted) {
+            *predicted = t;
+            best = (Strategy)s;
+        }
+    }
+    return best;
+}
+
+static int dispatch_square(DispatchWorkspace* ws, const float* cost, int rows, int cols, int stride) {
+    if (ws->square == NULL) {
+        ws->square = malloc(sizeof(float) * MAX_SIZE * MAX_SIZE);
+        if (ws->square == NULL) {
+            return -1;
+        }
+    }
+    for (int i = 0; i < rows; i++) {
+        memcpy(ws->square[i], cost + (size_t)i * stride, sizeof(float) * cols);
+    }
+    return 0;
+}
+
+// 按指定策略求解稠密成本矩阵，结果不含DISALLOWED配对；除greedy外与lap_solve一样是代价最小的最大匹配。
+// 返回0成功，-1失败
+int dispatch_run(Strategy s, const float* cost, int rows, int cols, int stride, double tie_ratio,
+                 WorkerPool* pool, DispatchWorkspace* ws, Assignment results[], int* count) {
+    *count = 0;
+    if (s == STRATEGY_TINY || s == STRATEGY_MUNKRES) {
+        if (dispatch_square(ws, cost, rows, cols, stride) != 0) {
+            return -1;
+        }
+        Assignment all[MAX_SIZE];
+        int n_all;
+        if (s == STRATEGY_TINY) {
+            n_all = solve_tiny(ws->square, rows, cols, all);
+            if (n_all < 0) {
+                // 不存在避开DISALLOWED的完美匹配：改用LAP求最大匹配
+                return dispatch_run(STRATEGY_LAP, cost, rows, cols, stride, tie_ratio, pool, ws, results, count);
+            }
+        } else {
+            Munkres* munkres = malloc(sizeof(Munkres));
+            if (munkres == NULL) {
+                return -1;
+            }
+            pad_matrix(munkres, ws->square, rows, cols);
+            initialize(munkres);
+            munkres->verbose = false;
+            munkres->max_matching_init = tie_ratio > DISPATCH_TIE_THRESHOLD;
+            SolveStatus status = compute_budget(munkres, NULL, NULL);
+            n_all = status == SOLVE_OPTIMAL ? get_results(munkres, all, rows, cols) : -1;
+            free(munkres);
+            if (n_all < 0) {
+                // 同上：无完美匹配时由LAP求最大匹配
+                return dispatch_run(STRATEGY_LAP, cost, rows, cols, stride, tie_ratio, pool, ws, results, count);
+            }
+        }
+        for (int k = 0; k < n_all; k++) {
+            if (!IS_DISALLOWED(cost[(size_t)all[k].row * stride + all[k].col])) {
+                results[(*count)++] = all[k];
+            }
+        }
+        return 0;
+    }
+    if (s == STRATEGY_GREEDY) {
+        if (greedy_solve(cost, rows, cols, stride, NULL, &ws->greedy) != 0) {
+            return -1;
+        }
+        *count = greedy_get_results(&ws->greedy, results);
+        return 0;
+    }
+    CostView view = cost_view_dense(cost, rows, cols, stride);
+    int rc;
+    if (s == STRATEGY_SPARSE) {
+        SparseCost* sp = &ws->sparse;
+        long long nnz = 0;
+        for (int i = 0; i < rows; i++) {
+            for (int j = 0; j < cols; j++) {
+                nnz += !IS_DISALLOWED(cost[(size_t)i * stride + j]);
+            }
+        }
+        if (nnz > INT_MAX || sparse_cost_reserve(sp, rows, (int)(nnz > 0 ? nnz : 1)) != 0) {
+            return -1;
+        }
+        sp->rows = rows;
+        sp->cols = cols;
+        sp->nnz = 0;
+        for (int i = 0; i < rows; i++) {
+            sp->row_ptr[i] = sp->nnz;
+            const float* row = cost + (size_t)i * stride;
+            for (int j = 0; j < cols; j++) {
+                if (!IS_DISALLOWED(row[j])) {
+                    sp->col_idx[sp->nnz] = j;
+                    sp->cost[sp->nnz++] = row[j];
+                }
+            }
+        }
+        sp->row_ptr[rows] = sp->nnz;
+        view = cost_view_sparse(sp);
+        rc = lap_solve(&view, &ws->lap);
+    } else if (s == STRATEGY_PARALLEL) {
+        rc = lap_solve_parallel(&view, &ws->lap, pool);
+    } else {
+        rc = lap_solve(&view, &ws->lap);
+    }
+    if (rc != 0) {
+        return -1;
+    }
+    *count = lap_get_results(&ws->lap, results);
+    return 0;
+}
+
+// 自动选择策略求解稠密成本矩阵（行跨度stride）。results至少能容纳min(rows, cols)个配对。
+// decision可为NULL。pool可为NULL（此时不考虑parallel）。返回0成功，-1失败
+int assign_auto(Dispatcher* d, const float* cost, int rows, int cols, int stride, WorkerPool* pool,
+                DispatchWorkspace* ws, Assignment results[], int* count, float* total_cost, DispatchDecision* decision) {
+    DispatchDecision local;
+    DispatchDecision* f = decision != NULL ? decision : &local;
+    bool lines_ok;
+    dispatch_features(cost, rows, cols, stride, f, &lines_ok);
+    f->strategy = dispatch_choose(d, f, lines_ok, pool, &f->predicted_ms);
+    atomic_fetch_add_explicit(&d->decisions[f->strategy], 1, memory_order_relaxed);
+    if (dispatch_run(f->strategy, cost, rows, cols, stride, f->tie_ratio, pool, ws, results, count) != 0) {
+        return -1;
+    }
+    *total_cost = 0.0f;
+    for (int k = 0; k < *count; k++) {
+        *total_cost += cost[(size_t)results[k].row * stride + results[k].col];
+    }
+    return 0;
+}
+
+// 按次指定策略求解（如对延迟敏感的调用用greedy），策略不适用于该形状时返回-1。
+// 选greedy时下界与差距见ws->greedy。其余参数同assign_auto
+int assign_engine(Strategy strategy, const float* cost, int rows, int cols, int stride, WorkerPool* pool,
+                  DispatchWorkspace* ws, Assignment results[], int* count, float* total_cost) {
+    int n_max = rows > cols ? rows : cols;
+    if ((strategy == STRATEGY_TINY && n_max > TINY_MAX_SIZE) || (strategy == STRATEGY_MUNKRES && n_max > MAX_SIZE)) {
+        return -1;
+    }
+    if (dispatch_run(strategy, cost, rows, cols, stride, 0.0, pool, ws, results, count) != 0) {
+        return -1;
+    }
+    *total_cost = 0.0f;
+    for (int k = 0; k < *count; k++) {
+        *total_cost += cost[(size_t)results[k].row * stride + results[k].col];
+    }
+    return 0;
+}
+
+// 最小二乘拟合 log t = log a + b log n
+static StrategyFit dispatch_fit(const double* n, const double* t, int count) {
+    StrategyFit fit = {0.0, 0.0, false};
+    if (count == 1) {
+        fit.a = t[0];
+        fit.valid = true;
+        return fit;
+    }
+    double sx = 0, sy = 0, sxx = 0, sxy = 0;
+    for (int k = 0; k < count; k++) {
+        double x = log(n[k]), y = log(t[k]);
+        sx += x;
+        sy += y;
+        sxx += x * x;
+        sxy += x * y;
+    }
+    double denom = count * sxx - sx * sx;
+    if (count < 2 || denom <= 0.0) {
+        return fit;
+    }
+    fit.b = (count * sxy - sx * sy) / denom;
+    fit.a = exp((sy - fit.b * sx) / count);
+    fit.valid = true;
+    return fit;
+}
+
+// 启动校准：在每个密度档上对各策略计时若干尺寸并拟合参数。pool为NULL时不校准parallel。
+// 单核上约需几百毫秒。返回0成功，-1内存不足
+int dispatcher_calibrate(Dispatcher* d, WorkerPool* pool) {
+    static const int sizes[STRATEGY_COUNT][4] = {
+        {4, 6, 8, 0}, {16, 48, 100, 0}, {16, 64, 192, 384}, {16, 64, 192, 384}, {512, 640, 0, 0}, {0, 0, 0, 0},
+    };
+    int max_n = 640;
+    float* cost = malloc(sizeof(float) * max_n * max_n);
+    Assignment* results = malloc(sizeof(Assignment) * max_n);
+    DispatchWorkspace ws;
+    dispatch_workspace_init(&ws);
+    if (cost == NULL || results == NULL) {
+        free(cost);
+        free(results);
+        return -1;
+    }
+    unsigned int state = 12345u;
+    for (int k = 0; k < DISPATCH_DENSITY_BUCKETS; k++) {
+        for (int s = 0; s < STRATEGY_COUNT; s++) {
+            double ns[4], ts[4];
+            int points = 0;
+            if (s == STRATEGY_GREEDY) {
+                continue;
+            }
+            if (s == STRATEGY_MUNKRES && k > 0) {
+                d->fit[k][s].valid = false; // 含DISALLOWED时Munkres不适用
+                continue;
+            }
+            if (s == STRATEGY_PARALLEL && (pool == NULL || pool->threads < 2)) {
+                continue; // 保留默认参数
+            }
+            for (int p = 0; p < 4 && sizes[s][p] > 0; p++) {
+                int n = sizes[s][p];
+                for (int e = 0; e < n * n; e++) {
+                    state = state * 1103515245u + 12345u;
+                    bool allowed = (state >> 8) % 10000 < (unsigned)(dispatch_densities[k] * 10000);
+                    // 稀疏时保证对角线可行，使问题总能完全匹配
+                    cost[e] = allowed || e / n == e % n ? (float)((state >> 12) % 100000) / 100.0f : (float)DISALLOWED_VAL;
+                }
+                // 重复到累计约1ms，取平均
+                int reps = 0, count;
+                long long t0 = monotonic_ns(), elapsed;
+                do {
+                    if (dispatch_run((Strategy)s, cost, n, n, n, 0.0, pool, &ws, results, &count) != 0) {
+                        free(cost);
+                        free(results);
+                        dispatch_workspace_free(&ws);
+                        return -1;
+                    }
+                    reps++;
+                    elapsed = monotonic_ns() - t0;
+                } while (elapsed < 1000000 && reps < 1000);
+                ns[points] = n;
+                ts[points++] = elapsed / 1e6 / reps;
+            }
+            d->fit[k][s] = dispatch_fit(ns, ts, points);
+        }
+    }
+    d->calibrated = true;
+    free(cost);
+    free(results);
+    dispatch_workspace_free(&ws);
+    return 0;
+}
+
+// profile文本格式：每行“密度档 策略名 a b”，无效项不写出
+int dispatcher_save_profile(const Dispatcher* d, const char* path) {
+    FILE* f = fopen(path, "w");
+    if (f == NULL) {
+        return -1;
+    }
+    for (int k = 0; k < DISPATCH_DENSITY_BUCKETS; k++) {
+        for (int s = 0; s < STRATEGY_COUNT; s++) {
+            if (d->fit[k][s].valid) {
+                fprintf(f, "%d %s %.9g %.9g\n", k, strategy_names[s], d->fit[k][s].a, d->fit[k][s].b);
+            }
+        }
+    }
+    return fclose(f) == 0 ? 0 : -1;
+}
+
+// 加载profile：文件中出现的项覆盖当前参数，未出现的项标为无效。返回0成功，-1失败
+int dispatcher_load_profile(Dispatcher* d, const char* path) {
+    FILE* f = fopen(path, "r");
+    if (f == NULL) {
+        return -1;
+    }
+    StrategyFit fit[DISPATCH_DENSITY_BUCKETS][STRATEGY_COUNT];
+    memset(fit, 0, sizeof(fit));
+    int k;
+    char name[32];
+    double a, b;
+    int rc = 0;
+    while (fscanf(f, "%d %31s %lf %lf", &k, name, &a, &b) == 4) {
+        int s = 0;
+        while (s < STRATEGY_COUNT && strcmp(name, strategy_names[s]) != 0) {
+            s++;
+        }
+        if (k < 0 || k >= DISPATCH_DENSITY_BUCKETS || s == STRATEGY_COUNT || !(a > 0.0)) {
+            rc = -1;
+            break;
+        }
+        fit[k][s] = (StrategyFit){a, b, true};
+    }
+    if (!feof(f)) {
+        rc = -1;
+    }
+    fclose(f);
+    if (rc == 0) {
+        memcpy(d->fit, fit, sizeof(fit));
+        d->calibrated = true;
+    }
+    return rc;
+}
+
+// 各策略被选中的次数
+void dispatcher_stats(Dispatcher* d, unsigned long long out[STRATEGY_COUNT]) {
+    for (int s = 0; s < STRATEGY_COUNT; s++) {
+        out[s] = atomic_load_explicit(&d->decisions[s], memory_order_relaxed);
+    }
+}
+
+// 画廊规模的矩形分配（行数 << 列数，如重识别中几百个查询对上百万个库条目）：
+// 列按块流式读取，不构造 rows x cols 矩阵。每行只保留有界的候选（代价最小的若干列），
+// 在候选的并集上求LAP，再用对偶证明在全部列上最优：LAP的列对偶 v_j <= 0，未匹配列 v_j = 0，
+// 若每行 u_i <= tau_i（tau_i 为该行未保留元素的最小代价），则 (u, v) 对全体列都是可行对偶，
+// 候选解即全局最优。违反的行只重扫该行，且只收集 c_ij < u_i 的列（其余列不可能破坏证明）。
+// 要求 rows <= cols；DISALLOWED 元素不进入候选
+
+static int gallery_mmap_block(const int* rows, int n_rows, int col_begin, int n_cols, float* out, void* arg) {
+    const GallerySource* src = arg;
+    for (int c = 0; c < n_cols; c++) {
+        const float* column = src->map + (size_t)(col_begin + c) * src->rows;
+        for (int k = 0; k < n_rows; k++) {
+            out[(size_t)k * n_cols + c] = column[rows[k]];
+        }
+    }
+    return 0;
+}
+
+GallerySource gallery_source_callback(int rows, int cols, GalleryBlockFn fn, void* arg) {
+    GallerySource src = {rows, cols, fn, arg, NULL, 0};
+    return src;
+}
+
+// 映射列主序的float32成本文件（大小必须为 rows * cols * 4 字节）。返回0成功，-1失败
+int gallery_source_mmap(GallerySource* src, const char* path, int rows, int cols) {
+    memset(src, 0, sizeof(*src));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    struct stat st;
+    size_t bytes = sizeof(float) * (size_t)rows * cols;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size != bytes || bytes == 0) {
+        close(fd);
+        return -1;
+    }
+    void* map = mmap(NULL, bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return -1;
+    }
+    madvise(map, bytes, MADV_SEQUENTIAL);
+    src->rows = rows;
+    src->cols = cols;
+    src->fn = gallery_mmap_block;
+    src->arg = src;
+    src->map = map;
+    src->map_bytes = bytes;
+    return 0;
+}
+
+void gallery_source_close(GallerySource* src) {
+    if (src->map != NULL) {
+        munmap((void*)src->map, src->map_bytes);
+    }
+    memset(src, 0, sizeof(*src));
+}
+
+// (cost, col) 字典序，保证候选集合与并行划分无关
+static inline bool gallery_less(GalleryCand a, GalleryCand b) {
+    return a.cost < b.cost || (a.cost == b.cost && a.col < b.col);
+}
+
+// 有界最大堆：保留字典序最小的cap个，被淘汰或拒绝的最小代价计入tau
+static inline void gallery_heap_push(GalleryCand* heap, int* count, int cap, GalleryCand e, float* tau) {
+    if (*count == cap) {
+        if (!gallery_less(e, heap[0])) {
+            *tau = e.cost < *tau ? e.cost : *tau;
+            return;
+        }
+        *tau = heap[0].cost < *tau ? heap[0].cost : *tau;
+        int k = 0;
+        while (1) {
+            int l = 2 * k + 1, r = l + 1, big = k;
+            GalleryCand top = e;
+            if (l < cap && gallery_less(top, heap[l])) {
+                big = l;
+                top = heap[l];
+            }
+            if (r < cap && gallery_less(top, heap[r])) {
+                big = r;
+            }
+            if (big == k) {
+                break;
+            }
+            heap[k] = heap[big];
+            k = big;
+        }
+        heap[k] = e;
+        return;
+    }
+    int k = (*count)++;
+    while (k > 0 && gallery_less(heap[(k - 1) / 2], e)) {
+        heap[k] = heap[(k - 1) / 2];
+        k = (k - 1) / 2;
+    }
+    heap[k] = e;
+}
+
+void gallery_solver_init(GallerySolver* g) {
+    memset(g, 0, sizeof(*g));
+    sparse_cost_init(&g->sparse);
+    lap_workspace_init(&g->ws);
+}
+
+void gallery_solver_free(GallerySolver* g) {
+    for (int i = 0; g->cand != NULL && i < g->rows; i++) {
+        free(g->cand[i]);
+    }
+    for (int w = 0; w < g->n_workers; w++) {
+        free(g->workers[w].heap);
+        free(g->workers[w].count);
+        free(g->workers[w].tau);
+        free(g->workers[w].block);
+    }
+    free(g->workers);
+    free(g->cand);
+    free(g->cand_count);
+    free(g->cap);
+    free(g->tau);
+    free(g->theta);
+    free(g->active);
+    free(g->offset);
+    free(g->union_cols);
+    free(g->lap_row);
+    free(g->queue);
+    free(g->reached);
+    free(g->row_to_col);
+    sparse_cost_free(&g->sparse);
+    lap_workspace_free(&g->ws);
+    gallery_solver_init(g);
+}
+
+static void gallery_scan_blocks(int begin, int end, int worker, void* arg) {
+    GallerySolver* g = arg;
+    GalleryWorker* w = &g->workers[worker];
+    int bc = g->params->block_cols;
+    for (int b = begin; b < end && atomic_load_explicit(&g->error, memory_order_relaxed) == 0; b++) {
+        int col_begin = b * bc;
+        int n_cols = g->cols - col_begin < bc ? g->cols - col_begin : bc;
+        if (g->src->fn(g->active, g->n_active, col_begin, n_cols, w->block, g->src->arg) != 0) {
+            atomic_store(&g->error, 1);
+            return;
+        }
+        for (int k = 0; k < g->n_active; k++) {
+            int i = g->active[k];
+            const float* row = w->block + (size_t)k * n_cols;
+            GalleryCand* heap = w->heap + g->offset[k];
+            double theta = g->theta[i];
+            float tau = w->tau[k];
+            int count = w->count[k], cap = g->cap[i];
+            for (int c = 0; c < n_cols; c++) {
+                float v = row[c];
+                if (IS_DISALLOWED(v)) {
+                    continue;
+                }
+                if (!(v < theta)) {
+                    tau = v < tau ? v : tau;
+                } else if (count < cap || v <= heap[0].cost) {
+                    gallery_heap_push(heap, &count, cap, (GalleryCand){v, col_begin + c}, &tau);
+                } else {
+                    tau = v < tau ? v : tau;
+                }
+            }
+            w->count[k] = count;
+            w->tau[k] = tau;
+        }
+    }
+}
+
+static int gallery_cand_compare(const void* a, const void* b) {
+    int x = ((const GalleryCand*)a)->col, y = ((const GalleryCand*)b)->col;
+    return (x > y) - (x < y);
+}
+
+static int int_compare(const void* a, const void* b) {
+    int x = *(const int*)a, y = *(const int*)b;
+    return (x > y) - (x < y);
+}
+
+// 扫描活跃行：各线程在自己的列块上维护有界堆，最后按行合并。返回0成功，-1失败
+static int gallery_scan(GallerySolver* g) {
+    size_t heap_total = 0;
+    for (int k = 0; k < g->n_active; k++) {
+        g->offset[k] = (int)heap_total;
+        heap_total += g->cap[g->active[k]];
+    }
+    for (int w = 0; w < g->n_workers; w++) {
+        GalleryWorker* wk = &g->workers[w];
+        if (heap_total > wk->heap_capacity) {
+            GalleryCand* heap = realloc(wk->heap, sizeof(GalleryCand) * heap_total);
+            if (heap == NULL) {
+                return -1;
+            }
+            wk->heap = heap;
+            wk->heap_capacity = heap_total;
+        }
+        if (wk->block == NULL) {
+            wk->count = malloc(sizeof(int) * g->rows);
+            wk->tau = malloc(sizeof(float) * g->rows);
+            wk->block = malloc(sizeof(float) * (size_t)g->rows * g->params->block_cols);
+            if (wk->count == NULL || wk->tau == NULL || wk->block == NULL) {
+                return -1;
+            }
+        }
+        for (int k = 0; k < g->n_active; k++) {
+            wk->count[k] = 0;
+            wk->tau[k] = INFINITY;
+        }
+    }
+    atomic_store(&g->error, 0);
+    int blocks = (g->cols + g->params->block_cols - 1) / g->params->block_cols;
+    worker_pool_parallel_for(g->params->pool, blocks, 1, gallery_scan_blocks, g);
+    if (atomic_load(&g->error) != 0) {
+        return -1;
+    }
+    g->cells_scanned += (long long)g->n_active * g->cols;
+
+    // 合并各线程的堆，按列排序后作为该行的候选
+    for (int k = 0; k < g->n_active; k++) {
+        int i = g->active[k], cap = g->cap[i];
+        GalleryCand* merged = realloc(g->cand[i], sizeof(GalleryCand) * cap);
+        if (merged == NULL) {
+            return -1;
+        }
+        g->cand[i] = merged;
+        int count = 0;
+        float tau = INFINITY;
+        for (int w = 0; w < g->n_workers; w++) {
+            GalleryWorker* wk = &g->workers[w];
+            tau = wk->tau[k] < tau ? wk->tau[k] : tau;
+            for (int e = 0; e < wk->count[k]; e++) {
+                gallery_heap_push(merged, &count, cap, wk->heap[g->offset[k] + e], &tau);
+            }
+        }
+        qsort(merged, count, sizeof(GalleryCand), gallery_cand_compare);
+        g->cand_count[i] = count;
+        g->tau[i] = tau;
+    }
+    return 0;
+}
+
+// 该行在全部列上都没有可行元素，永远无法匹配
+static inline bool gallery_row_dead(const GallerySolver* g, int i) {
+    return g->cand_count[i] == 0 && g->tau[i] == INFINITY;
+}
+
+// 在候选并集上求解LAP（跳过无可行列的行），返回0成功，-1内存不足
+static int gallery_solve_reduced(GallerySolver* g) {
+    long long total = 0;
+    g->n_lap_rows = 0;
+    for (int i = 0; i < g->rows; i++) {
+        total += g->cand_count[i];
+        if (!gallery_row_dead(g, i)) {
+            g->lap_row[g->n_lap_rows++] = i;
+        }
+    }
+    g->candidates = total;
+    int* cols = realloc(g->union_cols, sizeof(int) * (total > 0 ? total : 1));
+    if (cols == NULL || total > INT_MAX) {
+        if (cols != NULL) {
+            g->union_cols = cols;
+        }
+        return -1;
+    }
+    g->union_cols = cols;
+    int n = 0;
+    for (int i = 0; i < g->rows; i++) {
+        for (int e = 0; e < g->cand_count[i]; e++) {
+            cols[n++] = g->cand[i][e].col;
+        }
+    }
+    qsort(cols, n, sizeof(int), int_compare);
+    int u = 0;
+    for (int k = 0; k < n; k++) {
+        if (u == 0 || cols[k] != cols[u - 1]) {
+            cols[u++] = cols[k];
+        }
+    }
+    g->union_size = u;
+
+    SparseCost* sp = &g->sparse;
+    if (sparse_cost_reserve(sp, g->rows, n > 0 ? n : 1) != 0) {
+        return -1;
+    }
+    if (g->n_lap_rows == 0) {
+        return 0;
+    }
+    sp->rows = g->n_lap_rows;
+    sp->cols = u;
+    sp->nnz = 0;
+    for (int r = 0; r < g->n_lap_rows; r++) {
+        int i = g->lap_row[r];
+        sp->row_ptr[r] = sp->nnz;
+        for (int e = 0; e < g->cand_count[i]; e++) {
+            int* at = bsearch(&g->cand[i][e].col, cols, u, sizeof(int), int_compare);
+            sp->col_idx[sp->nnz] = (int)(at - cols);
+            sp->cost[sp->nnz++] = g->cand[i][e].cost;
+        }
+    }
+    sp->row_ptr[g->n_lap_rows] = sp->nnz;
+    CostView view = cost_view_sparse(sp);
+    return lap_solve(&view, &g->ws);
+}
+
+// 从未匹配的LAP行出发沿交错路径（候选边到列，再沿匹配回到行）标记可达行，这些行构成不可行分量，
+// 只有扩大它们的候选才可能让未匹配行增广。返回分量中仍有未保留元素（可扩大）的行数
+static int gallery_infeasible_component(GallerySolver* g) {
+    memset(g->reached, 0, g->n_lap_rows);
+    int head = 0, tail = 0, open = 0;
+    for (int r = 0; r < g->n_lap_rows; r++) {
+        if (g->ws.row_to_col[r] == -1) {
+            g->reached[r] = 1;
+            g->queue[tail++] = r;
+        }
+    }
+    const SparseCost* sp = &g->sparse;
+    while (head < tail) {
+        int r = g->queue[head++];
+        open += g->tau[g->lap_row[r]] != INFINITY;
+        for (int e = sp->row_ptr[r]; e < sp->row_ptr[r + 1]; e++) {
+            int owner = g->ws.col_to_row[sp->col_idx[e]];
+            if (owner >= 0 && !g->reached[owner]) {
+                g->reached[owner] = 1;
+                g->queue[tail++] = owner;
+            }
+        }
+    }
+    return open;
+}
+
+// 求解：行数必须不多于列数。certified为false表示候选达到max_k仍未能证明最优，此时结果为候选上的最优解。
+// 返回0成功，-1参数错误、内存不足或取块失败
+int gallery_solve(GallerySolver* g, const GallerySource* src, const GalleryParams* params) {
+    GalleryParams p = *params;
+    p.initial_k = p.initial_k > 0 ? p.initial_k : 16;
+    p.block_cols = p.block_cols > 0 ? p.block_cols : 4096;
+    int max_k = p.max_k > 0 && p.max_k < src->cols ? p.max_k : src->cols;
+    if (src->rows < 1 || src->rows > src->cols || src->fn == NULL) {
+        return -1;
+    }
+    gallery_solver_free(g);
+    int rows = src->rows;
+    g->rows = rows;
+    g->cols = src->cols;
+    g->src = src;
+    g->params = &p;
+    g->n_workers = p.pool != NULL ? p.pool->threads : 1;
+    g->cand = calloc(rows, sizeof(GalleryCand*));
+    g->cand_count = calloc(rows, sizeof(int));
+    g->cap = malloc(sizeof(int) * rows);
+    g->tau = malloc(sizeof(float) * rows);
+    g->theta = malloc(sizeof(double) * rows);
+    g->active = malloc(sizeof(int) * rows);
+    g->offset = malloc(sizeof(int) * rows);
+    g->row_to_col = malloc(sizeof(int) * rows);
+    g->lap_row = malloc(sizeof(int) * rows);
+    g->queue = malloc(sizeof(int) * rows);
+    g->reached = malloc(rows);
+    g->workers = calloc(g->n_workers, sizeof(GalleryWorker));
+    if (g->cand == NULL || g->cand_count == NULL || g->cap == NULL || g->tau == NULL || g->theta == NULL ||
+        g->active == NULL || g->offset == NULL || g->row_to_col == NULL || g->lap_row == NULL ||
+        g->queue == NULL || g->reached == NULL || g->workers == NULL) {
+        return -1;
+    }
+    for (int i = 0; i < rows; i++) {
+        g->cap[i] = p.initial_k < max_k ? p.initial_k : max_k;
+        g->theta[i] = INFINITY;
+        g->active[i] = i;
+    }
+    g->n_active = rows;
+
+    while (1) {
+        g->passes++;
+        if (gallery_scan(g) != 0 || gallery_solve_reduced(g) != 0) {
+            return -1;
+        }
+        // 候选并集少于参与行数（LAP会转置求解）时对偶不能直接用于证明，扩大所有未取全的行；
+        // 有行未分配时只扩大其不可行分量中未取全的行。分量内都已取全说明这些行在全体列上也无法全部匹配，
+        // 此时按对偶检查其余行。无可行列的行不参与LAP，也不触发扩大
+        bool whole = g->union_size < g->n_lap_rows;
+        bool component = !whole && g->n_lap_rows > 0 && g->ws.infeasible_rows > 0 && gallery_infeasible_component(g) > 0;
+        g->n_active = 0;
+        bool capped = false;
+        for (int r = 0; r < g->n_lap_rows; r++) {
+            int i = g->lap_row[r];
+            double u = g->ws.u[r];
+            bool expand = whole || (component && g->reached[r]);
+            bool violated = expand ? g->tau[i] != INFINITY
+                                   : !component && u > g->tau[i] + 1e-6 * (1.0 + fabs(g->tau[i]));
+            if (!violated) {
+                continue;
+            }
+            if (g->cap[i] >= max_k && g->cand_count[i] >= max_k) {
+                capped = true;
+                continue;
+            }
+            g->cap[i] = g->cap[i] * 2 < max_k ? g->cap[i] * 2 : max_k;
+            g->theta[i] = expand ? INFINITY : u;
+            g->active[g->n_active++] = i;
+        }
+        if (g->n_active == 0) {
+            g->certified = !capped;
+            break;
+        }
+    }
+
+    g->total_cost = 0.0f;
+    for (int i = 0; i < rows; i++) {
+        g->row_to_col[i] = -1;
+    }
+    for (int r = 0; r < g->n_lap_rows; r++) {
+        int i = g->lap_row[r], j = g->ws.row_to_col[r];
+        if (j >= 0) {
+            g->row_to_col[i] = g->union_cols[j];
+            for (int e = 0; e < g->cand_count[i]; e++) {
+                if (g->cand[i][e].col == g->row_to_col[i]) {
+                    g->total_cost += g->cand[i][e].cost;
+                    break;
+                }
+            }
+        }
+    }
+    g->src = NULL;
+    g->params = NULL;
+    return 0;
+}
+
+// 导出结果（行升序），返回配对数
+int gallery_get_results(const GallerySolver* g, Assignment results[]) {
+    int count = 0;
+    for (int i = 0; i < g->rows; i++) {
+        if (g->row_to_col[i] >= 0) {
+            results[count].row = i;
+            results[count].col = g->row_to_col[i];
+            count++;
+        }
+    }
+    return count;
+}
+
+// 向量化exp（Cephes多项式，相对误差约1e-7），x < -87 时返回0
+static inline vfloat vf_exp(vfloat x) {
+    vmask underflow = x < vf_set1(-87.3f);
+    x = vf_min(vf_max(x, vf_set1(-87.3f)), vf_set1(88.7f));
+    vfloat fx = x * vf_set1(1.44269504088896341f) + vf_set1(0.5f);
+    vmask k = __builtin_convertvector(fx, vmask);
+    vfloat kf = __builtin_convertvector(k, vfloat);
+    vmask adjust = kf > fx;
+    kf = kf - vf_select(adjust, vf_set1(1.0f), vf_set1(0.0f));
+    k = __builtin_convertvector(kf, vmask);
+    vfloat r = x - kf * vf_set1(0.693359375f) + kf * vf_set1(2.12194440e-4f);
+    vfloat y = vf_set1(1.9875691500e-4f);
+    y = y * r + vf_set1(1.3981999507e-3f);
+    y = y * r + vf_set1(8.3334519073e-3f);
+    y = y * r + vf_set1(4.1665795894e-2f);
+    y = y * r + vf_set1(1.6666665459e-1f);
+    y = y * r + vf_set1(5.0000001201e-1f);
+    y = y * r * r + r + vf_set1(1.0f);
+    vmask bits = (k + 127) << 23;
+    y = y * (vfloat)bits;
+    return vf_select(underflow, vf_set1(0.0f), y);
+}
+
+static inline float vf_hmax(vfloat v) {
+    float m = v[0];
+    for (int k = 1; k < VEC_WIDTH; k++) {
+        m = v[k] > m ? v[k] : m;
+    }
+    return m;
+}
+
+static inline float vf_hsum(vfloat v) {
+    float s = 0.0f;
+    for (int k = 0; k < VEC_WIDTH; k++) {
+        s += v[k];
+    }
+    return s;
+}
+
+// 行更新：f_i = -eps * LSE_j((g_j - c_ij)/eps)，DISALLOWED位置的核质量为0
+static void sinkhorn_rows(int begin, int end, int worker, void* arg) {
+    SinkhornState* s = arg;
+    (void)worker;
+    for (int i = begin; i < end; i++) {
+        const float* c = s->cost + (size_t)i * s->stride;
+        vfloat vmax = vf_set1(-INFINITY);
+        int j = 0;
+        for (; j + VEC_WIDTH <= s->cols; j += VEC_WIDTH) {
+            vfloat cv = vf_load(c + j);
+            vfloat x = (vf_load(s->g + j) - cv) * vf_set1(s->inv_eps);
+            vmax = vf_max(vmax, vf_select(cv >= vf_set1(FLT_MAX), vf_set1(-INFINITY), x));
+        }
+        float m = vf_hmax(vmax);
+        for (; j < s->cols; j++) {
+            if (!IS_DISALLOWED(c[j])) {
+                m = fmaxf(m, (s->g[j] - c[j]) * s->inv_eps);
+            }
+        }
+        if (s->slack_col_mass > 0.0f) {
+            m = fmaxf(m, s->g[s->cols] * s->inv_eps);
+        }
+        if (m == -INFINITY) {
+            s->f[i] = -INFINITY; // 整行DISALLOWED
+            continue;
+        }
+        vfloat vsum = vf_set1(0.0f);
+        for (j = 0; j + VEC_WIDTH <= s->cols; j += VEC_WIDTH) {
+            vfloat cv = vf_load(c + j);
+            vfloat x = (vf_load(s->g + j) - cv) * vf_set1(s->inv_eps) - vf_set1(m);
+            vsum += vf_select(cv >= vf_set1(FLT_MAX), vf_set1(0.0f), vf_exp(x));
+        }
+        float sum = vf_hsum(vsum);
+        for (; j < s->cols; j++) {
+            if (!IS_DISALLOWED(c[j])) {
+                sum += expf((s->g[j] - c[j]) * s->inv_eps - m);
+            }
+        }
+        if (s->slack_col_mass > 0.0f) {
+            sum += expf(s->g[s->cols] * s->inv_eps - m);
+        }
+        s->f[i] = -s->eps * (m + logf(sum));
+    }
+}
+
+// 列更新：按列块并行，每个线程顺序扫描所有行，对本块内的列做流式LSE
+static void sinkhorn_cols(int begin, int end, int worker, void* arg) {
+    SinkhornState* s = arg;
+    (void)worker;
+    float slack = s->slack_row_mass > 0.0f ? s->f[s->rows] * s->inv_eps : -INFINITY;
+    for (int j = begin; j < end; j++) {
+        s->col_max[j] = slack;
+        s->col_sum[j] = 0.0f;
+    }
+    for (int i = 0; i < s->rows; i++) {
+        if (s->f[i] == -INFINITY) {
+            continue;
+        }
+        const float* c = s->cost + (size_t)i * s->stride;
+        vfloat fi = vf_set1(s->f[i]);
+        int j = begin;
+        for (; j + VEC_WIDTH <= end; j += VEC_WIDTH) {
+            vfloat cv = vf_load(c + j);
+            vfloat x = vf_select(cv >= vf_set1(FLT_MAX), vf_set1(-INFINITY), (fi - cv) * vf_set1(s->inv_eps));
+            vf_store(s->col_max + j, vf_max(vf_load(s->col_max + j), x));
+        }
+        for (; j < end; j++) {
+            if (!IS_DISALLOWED(c[j])) {
+                s->col_max[j] = fmaxf(s->col_max[j], (s->f[i] - c[j]) * s->inv_eps);
+            }
+        }
+    }
+    for (int i = 0; i < s->rows; i++) {
+        if (s->f[i] == -INFINITY) {
+            continue;
+        }
+        const float* c = s->cost + (size_t)i * s->stride;
+        vfloat fi = vf_set1(s->f[i]);
+        int j = begin;
+        for (; j + VEC_WIDTH <= end; j += VEC_WIDTH) {
+            vfloat cv = vf_load(c + j);
+            vfloat x = (fi - cv) * vf_set1(s->inv_eps) - vf_load(s->col_max + j);
+            vfloat e = vf_select(cv >= vf_set1(FLT_MAX), vf_set1(0.0f), vf_exp(x));
+            vf_store(s->col_sum + j, vf_load(s->col_sum + j) + e);
+        }
+        for (; j < end; j++) {
+            if (!IS_DISALLOWED(c[j])) {
+                s->col_sum[j] += expf((s->f[i] - c[j]) * s->inv_eps - s->col_max[j]);
+            }
+        }
+    }
+    for (int j = begin; j < end; j++) {
+        if (s->col_max[j] == -INFINITY) {
+            s->g[j] = -INFINITY; // 整列DISALLOWED
+            continue;
+        }
+        if (slack != -INFINITY) {
+            s->col_sum[j] += expf(slack - s->col_max[j]);
+        }
+        s->g[j] = -s->eps * (s->col_max[j] + logf(s->col_sum[j]));
+    }
+}
+
+// 行边缘误差：|sum_j P_ij - 1|
+static void sinkhorn_row_error(int begin, int end, int worker, void* arg) {
+    SinkhornState* s = arg;
+    (void)worker;
+    for (int i = begin; i < end; i++) {
+        const float* c = s->cost + (size_t)i * s->stride;
+        if (s->f[i] == -INFINITY) {
+            s->row_err[i] = 0.0f;
+            continue;
+        }
+        float sum = 0.0f;
+        for (int j = 0; j < s->cols; j++) {
+            if (!IS_DISALLOWED(c[j]) && s->g[j] != -INFINITY) {
+                sum += expf((s->f[i] + s->g[j] - c[j]) * s->inv_eps);
+            }
+        }
+        if (s->slack_col_mass > 0.0f) {
+            sum += expf((s->f[i] + s->g[s->cols]) * s->inv_eps);
+        }
+        s->row_err[i] = fabsf(sum - 1.0f);
+    }
+}
+
+// 松弛节点的势：质量为mass、对所有真实节点成本为0
+static float sinkhorn_slack(const float* pot, int count, float mass, float eps) {
+    float m = -INFINITY;
+    for (int k = 0; k < count; k++) {
+        m = fmaxf(m, pot[k] / eps);
+    }
+    if (m == -INFINITY) {
+        return 0.0f;
+    }
+    double sum = 0.0;
+    for (int k = 0; k < count; k++) {
+        sum += exp(pot[k] / eps - m);
+    }
+    return eps * logf(mass) - eps * (m + (float)log(sum));
+}
+
+static void sinkhorn_state_free(SinkhornState* s) {
+    free(s->f);
+    free(s->g);
+    free(s->col_max);
+    free(s->col_sum);
+    free(s->row_err);
+}
+
+static int compare_row_prob_desc(const void* a, const void* b) {
+    const RowProb* x = a;
+    const RowProb* y = b;
+    if (x->log_p != y->log_p) {
+        return x->log_p > y->log_p ? -1 : 1;
+    }
+    return x->row - y->row;
+}
+
+// 取整：按各行最大概率从大到小处理，列已被占用时改取该行剩余列中概率最大者；
+// 松弛列表示“不分配”，容量为 rows-cols，用满后其余行只能选真实列
+static int sinkhorn_round(const SinkhornState* s, int* row_to_col, float min_prob) {
+    int rows = s->rows, cols = s->cols;
+    RowProb* order = malloc(sizeof(RowProb) * (rows > 0 ? rows : 1));
+    unsigned char* used = calloc(cols > 0 ? cols : 1, 1);
+    if (order == NULL || used == NULL) {
+        free(order);
+        free(used);
+        return -1;
+    }
+    for (int i = 0; i < rows; i++) {
+        const float* c = s->cost + (size_t)i * s->stride;
+        order[i].log_p = -INFINITY;
+        order[i].row = i;
+        row_to_col[i] = -1;
+        if (s->f[i] == -INFINITY) {
+            continue;
+        }
+        for (int j = 0; j < cols; j++) {
+            if (!IS_DISALLOWED(c[j]) && s->g[j] != -INFINITY) {
+                order[i].log_p = fmaxf(order[i].log_p, (s->f[i] + s->g[j] - c[j]) * s->inv_eps);
+            }
+        }
+        if (s->slack_col_mass > 0.0f) {
+            order[i].log_p = fmaxf(order[i].log_p, (s->f[i] + s->g[cols]) * s->inv_eps);
+        }
+    }
+    qsort(order, rows, sizeof(RowProb), compare_row_prob_desc);
+    int slack_left = (int)s->slack_col_mass;
+    for (int k = 0; k < rows; k++) {
+        int i = order[k].row;
+        if (order[k].log_p == -INFINITY) {
+            continue;
+        }
+        const float* c = s->cost + (size_t)i * s->stride;
+        float slack_p = slack_left > 0 ? expf((s->f[i] + s->g[cols]) * s->inv_eps) : 0.0f;
+        int best_j = -1;
+        float best_p = fmaxf(min_prob, slack_p);
+        for (int j = 0; j < cols; j++) {
+            if (used[j] || IS_DISALLOWED(c[j]) || s->g[j] == -INFINITY) {
+                continue;
+            }
+            float p = expf((s->f[i] + s->g[j] - c[j]) * s->inv_eps);
+            if (p > best_p) {
+                best_p = p;
+                best_j = j;
+            }
+        }
+        if (best_j != -1) {
+            row_to_col[i] = best_j;
+            used[best_j] = 1;
+        } else if (slack_p > min_prob) {
+            slack_left--;
+        }
+    }
+    free(order);
+    free(used);
+    return 0;
+}
+
+// 熵正则软分配：每行、每列质量为1，多出的质量由一个成本为0的松弛行/列吸收。
+// view需为稠密视图；plan（rows x cols，跨度plan_stride，可为NULL）输出传输方案P_ij，
+// 即目标i与观测j的关联概率。row_to_col非NULL时按概率从大到小贪心取整为一对一分配，
+// 概率低于min_prob或低于该行的松弛概率时不分配（-1）。返回0成功，-1失败
+static int sinkhorn_solve_run(const CostView* view, const SinkhornParams* params, float* plan, int plan_stride,
+                              int* row_to_col, float min_prob, SinkhornReport* report) {
+    if (view->kind != COST_DENSE || params->epsilon <= 0.0f) {
+        return -1;
+    }
+    int rows = view->rows, cols = view->cols;
+    SinkhornState s;
+    s.cost = view->dense;
+    s.stride = view->stride;
+    s.rows = rows;
+    s.cols = cols;
+    s.eps = params->epsilon;
+    s.inv_eps = 1.0f / params->epsilon;
+    s.slack_row_mass = cols > rows ? (float)(cols - rows) : 0.0f;
+    s.slack_col_mass = rows > cols ? (float)(rows - cols) : 0.0f;
+    s.f = calloc(rows + 1, sizeof(float));
+    s.g = calloc(cols + 1, sizeof(float));
+    s.col_max = malloc(sizeof(float) * (cols + 1));
+    s.col_sum = malloc(sizeof(float) * (cols + 1));
+    s.row_err = malloc(sizeof(float) * (rows + 1));
+    if (s.f == NULL || s.g == NULL || s.col_max == NULL || s.col_sum == NULL || s.row_err == NULL) {
+        sinkhorn_state_free(&s);
+        return -1;
+    }
+
+    SinkhornReport local = {0, INFINITY, false};
+    for (int it = 0; it < params->max_iterations; it++) {
+        worker_pool_parallel_for(params->pool, rows, 1, sinkhorn_rows, &s);
+        if (s.slack_row_mass > 0.0f) {
+            s.f[rows] = sinkhorn_slack(s.g, cols, s.slack_row_mass, s.eps);
+        }
+        worker_pool_parallel_for(params->pool, cols, 16, sinkhorn_cols, &s);
+        if (s.slack_col_mass > 0.0f) {
+            s.g[cols] = sinkhorn_slack(s.f, rows, s.slack_col_mass, s.eps);
+        }
+        local.iterations = it + 1;
+        if ((it + 1) % 10 == 0 || it + 1 == params->max_iterations) {
+            worker_pool_parallel_for(params->pool, rows, 1, sinkhorn_row_error, &s);
+            float err = 0.0f;
+            for (int i = 0; i < rows; i++) {
+                err += s.row_err[i];
+            }
+            local.marginal_error = err;
+            if (err < params->tolerance) {
+                local.converged = true;
+                break;
+            }
+        }
+    }
+
+    if (plan != NULL) {
+        for (int i = 0; i < rows; i++) {
+            const float* c = s.cost + (size_t)i * s.stride;
+            for (int j = 0; j < cols; j++) {
+                bool zero = IS_DISALLOWED(c[j]) || s.f[i] == -INFINITY || s.g[j] == -INFINITY;
+                plan[(size_t)i * plan_stride + j] = zero ? 0.0f : expf((s.f[i] + s.g[j] - c[j]) * s.inv_eps);
+            }
+        }
+    }
+
+    if (row_to_col != NULL && sinkhorn_round(&s, row_to_col, min_prob) != 0) {
+        sinkhorn_state_free(&s);
+        return -1;
+    }
+
+    if (report != NULL) {
+        *report = local;
+    }
+    sinkhorn_state_free(&s);
+    return 0;
+}
+
+int sinkhorn_solve(const CostView* view, const SinkhornParams* params, float* plan, int plan_stride,
+                   int* row_to_col, float min_prob, SinkhornReport* report) {
+    long long t0 = metrics_start();
+    int rc = sinkhorn_solve_run(view, params, plan, plan_stride, row_to_col, min_prob, report);
+    metrics_record(ENGINE_SINKHORN, view->rows, view->cols, t0, 0, 0, rc != 0);
+    return rc;
+}
+
+// 所有通道同时为第cur_row行增广；无法到达空闲列的通道从alive中清除
+static void batch_augment(BatchState* s, int n, int cur_row, vmask* alive) {
+    const vfloat inf = vf_set1(INFINITY);
+    const vfloat zero = vf_set1(0.0f);
+    vmask active = *alive;
+    vmask row = (vmask){0} + cur_row;
+    vmask sink = (vmask){0} - 1;
+    vfloat min_val = zero;
+    for (int j = 0; j < n; j++) {
+        s->dist[j] = inf;
+        s->scanned[j] = (vmask){0};
+    }
+
+    while (vm_any(active)) {
+        // 各通道当前行可能不同，相同时直接整向量读取
+        bool uniform = true;
+        for (int l = 1; l < VEC_WIDTH; l++) {
+            uniform = uniform && row[l] == row[0];
+        }
+        vfloat ui;
+        if (uniform) {
+            ui = s->u[row[0]];
+        } else {
+            for (int l = 0; l < VEC_WIDTH; l++) {
+                ui[l] = s->u[row[l]][l];
+            }
+        }
+        for (int j = 0; j < n; j++) {
+            vfloat c;
+            if (uniform) {
+                c = s->cost[row[0]][j];
+            } else {
+                for (int l = 0; l < VEC_WIDTH; l++) {
+                    c[l] = s->cost[row[l]][j][l];
+                }
+            }
+            vfloat r = min_val + c - ui - s->v[j];
+            vmask upd = active & ~s->scanned[j] & (r < s->dist[j]);
+            s->dist[j] = vf_select(upd, r, s->dist[j]);
+            s->pred[j] = (upd & row) | (~upd & s->pred[j]);
+        }
+
+        // 选出距离最小的未出队列，距离相同时优先空闲列（与lap_augment一致）
+        vfloat lowest = inf;
+        vmask best = (vmask){0} - 1;
+        vmask best_free = (vmask){0};
+        for (int j = 0; j < n; j++) {
+            vfloat d = vf_select(s->scanned[j], inf, s->dist[j]);
+            vmask is_free = s->c2r[j] == -1;
+            vmask better = (d < lowest) | ((d == lowest) & is_free & ~best_free);
+            lowest = vf_select(better, d, lowest);
+            best = (better & j) | (~better & best);
+            best_free = (better & is_free) | (~better & best_free);
+        }
+        vmask dead = active & (lowest == inf);
+        *alive &= ~dead;
+        active &= ~dead;
+        min_val = vf_select(active, lowest, min_val);
+
+        for (int l = 0; l < VEC_WIDTH; l++) {
+            if (!active[l]) {
+                continue;
+            }
+            int j = best[l];
+            s->scanned[j][l] = -1;
+            if (s->c2r[j][l] == -1) {
+                sink[l] = j;
+                active[l] = 0;
+            } else {
+                row[l] = s->c2r[j][l];
+            }
+        }
+    }
+
+    // 更新对偶变量：已出队列所匹配的行即为本轮访问过的行
+    vmask ok = *alive;
+    s->u[cur_row] += vf_select(ok, min_val, zero);
+    for (int i = 0; i < n; i++) {
+        if (i == cur_row) {
+            continue;
+        }
+        for (int l = 0; l < VEC_WIDTH; l++) {
+            int j = s->r2c[i][l];
+            if (ok[l] && j >= 0 && s->scanned[j][l]) {
+                s->u[i][l] += min_val[l] - s->dist[j][l];
+            }
+        }
+    }
+    for (int j = 0; j < n; j++) {
+        s->v[j] -= vf_select(ok & s->scanned[j], min_val - s->dist[j], zero);
+    }
+
+    // 各通道沿前驱翻转匹配
+    for (int l = 0; l < VEC_WIDTH; l++) {
+        if (!ok[l]) {
+            continue;
+        }
+        int j = sink[l];
+        while (1) {
+            int r = s->pred[j][l];
+            s->c2r[j][l] = r;
+            int next = s->r2c[r][l];
+            s->r2c[r][l] = j;
+            j = next;
+            if (r == cur_row) {
+                break;
+            }
+        }
+    }
+}
+
+// 批量求解count个同为rows x cols（<= BATCH_MAX_SIZE）的问题，matrices[p]按行步长stride存放
+// row_to_col[p * rows + i] 输出列号（分配到填充列时为-1），totals[p] 输出总成本
+// 与Munkres一样按0填充为方阵，只能通过DISALLOWED完成匹配的问题totals为INFINITY、分配全为-1
+// 返回无解问题数，参数非法返回-1
+static int solve_batch_run(const float* const* matrices, int count, int rows, int cols, int stride,
+                           int* row_to_col, float* totals) {
+    int n = rows > cols ? rows : cols;
+    if (count < 0 || rows < 1 || cols < 1 || n > BATCH_MAX_SIZE) {
+        return -1;
+    }
+    BatchState s;
+    int infeasible = 0;
+    for (int base = 0; base < count; base += VEC_WIDTH) {
+        int lanes = count - base < VEC_WIDTH ? count - base : VEC_WIDTH;
+        for (int i = 0; i < n; i++) {
+            for (int j = 0; j < n; j++) {
+                for (int l = 0; l < VEC_WIDTH; l++) {
+                    float c = 0.0f; // 填充位置与空闲通道均为0
+                    if (l < lanes && i < rows && j < cols) {
+                        c = matrices[base + l][(size_t)i * stride + j];
+                        c = IS_DISALLOWED(c) ? INFINITY : c;
+                    }
+                    s.cost[i][j][l] = c;
+                }
+            }
+        }
+        for (int k = 0; k < n; k++) {
+            s.u[k] = vf_set1(0.0f);
+            s.v[k] = vf_set1(0.0f);
+            s.c2r[k] = (vmask){0} - 1;
+            s.r2c[k] = (vmask){0} - 1;
+        }
+        vmask alive = (vmask){0} - 1;
+        for (int r = 0; r < n && vm_any(alive); r++) {
+            batch_augment(&s, n, r, &alive);
+        }
+
+        for (int l = 0; l < lanes; l++) {
+            int p = base + l;
+            int* out = row_to_col + (size_t)p * rows;
+            if (!alive[l]) {
+                for (int i = 0; i < rows; i++) {
+                    out[i] = -1;
+                }
+                totals[p] = INFINITY;
+                infeasible++;
+                continue;
+            }
+            float total = 0.0f;
+            for (int i = 0; i < rows; i++) {
+                int j = s.r2c[i][l];
+                out[i] = j < cols ? j : -1;
+                if (j < cols) {
+                    total += matrices[p][(size_t)i * stride + j];
+                }
+            }
+            totals[p] = total;
+        }
+    }
+    return infeasible;
+}
+
+int solve_batch(const float* const* matrices, int count, int rows, int cols, int stride,
+                int* row_to_col, float* totals) {
+    long long t0 = metrics_start();
+    int rc = solve_batch_run(matrices, count, rows, cols, stride, row_to_col, totals);
+    // 单元格按问题数累计；无解问题计为infeasible_rows
+    metrics_record(ENGINE_BATCH, rows * (count > 0 ? count : 0), cols, t0, 0, rc > 0 ? rc : 0, rc < 0);
+    return rc;
+}
@@ -0,0 +1,1294 @@
+// Munkres（匈牙利算法）与最短增广路径LAP求解库：成本视图、代价构建、批量/异步/分片求解、指标等。
+// 实现在munkres.c，测试在munkres_tests.c
+#ifndef MUNKRES_H
+#define MUNKRES_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <float.h>
+#include <math.h>    // 添加math.h以使用fabs函数
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdint.h>
+
+// 定义最大矩阵大小
+#define MAX_SIZE 100
+
+// 定义一个特殊的值来表示DISALLOWED
+#define DISALLOWED_VAL DBL_MAX
+
+// 判断float成本是否为DISALLOWED（DISALLOWED_VAL写入float后为+inf）
+#define IS_DISALLOWED(v) ((v) >= FLT_MAX)
+
+// 定义标记类型
+#define UNMARKED 0
+#define STARRED 1
+#define PRIMED 2
+
+// 定义一个结构体来存储Munkres算法的状态
+typedef struct {
+    float C[MAX_SIZE][MAX_SIZE];           // 成本矩阵（会被修改）
+    float original_C[MAX_SIZE][MAX_SIZE];  // 原始成本矩阵（保留不变）
+    int marked[MAX_SIZE][MAX_SIZE];         // 标记矩阵（STARRED, PRIMED）
+    bool row_covered[MAX_SIZE];             // 行覆盖标记
+    bool col_covered[MAX_SIZE];             // 列覆盖标记
+    int path[MAX_SIZE * 2][2];              // 路径矩阵
+    int n;                                   // 矩阵大小
+    int Z0_r;                                // 路径起始点行
+    int Z0_c;                                // 路径起始点列
+    float lx[MAX_SIZE];                    // 行标签
+    float ly[MAX_SIZE];                    // 列标签
+    double lower_bound;                      // 已从矩阵中减去的总量（对偶下界）
+    bool verbose;                            // 是否打印每步的调试信息
+    bool max_matching_init;                  // 用列归约 + 零图上的最大匹配代替step2的贪心标星
+    int step;                                // 下一个要执行的步骤（7为完成）；全部状态都在结构体内，可在线程间迁移
+    long long iterations;                    // 已执行的步骤数
+    long long augmentations;                 // 已完成的增广次数
+    long long active_ns;                     // 分片执行时累计的运行时间（不含排队）
+} Munkres;
+
+// 定义一个结构体来存储结果
+typedef struct {
+    int row;
+    int col;
+} Assignment;
+
+// 打印矩阵的函数
+void print_matrix(float matrix[MAX_SIZE][MAX_SIZE], int rows, int cols, const char* msg);
+
+// 创建一个新的矩阵并填充它，同时保留原始矩阵
+void pad_matrix(Munkres* munkres, float input_matrix[][MAX_SIZE], int input_rows, int input_cols);
+
+// 初始化行和列标签
+void initialize_labels(Munkres* munkres, int original_rows, int original_cols);
+
+// 初始化Munkres结构体
+void initialize(Munkres* munkres);
+
+// 查找未覆盖的零
+bool find_a_zero(Munkres* munkres, int* row, int* col);
+
+// 查找行中第一个星号零
+int find_star_in_row(Munkres* munkres, int row);
+
+// 查找列中第一个星号零
+int find_star_in_col(Munkres* munkres, int col);
+
+// 查找行中第一个标记零
+int find_prime_in_row(Munkres* munkres, int row);
+
+// 清除所有的覆盖标记
+void clear_covers(Munkres* munkres);
+
+// 清除所有的标记零
+void erase_primes(Munkres* munkres);
+
+// 查找矩阵中最小的未覆盖值
+float find_smallest(Munkres* munkres);
+
+// 构建增广路径并调整标记
+void convert_path(Munkres* munkres, int count);
+
+// 扩展增广路径
+void step5_build_path(Munkres* munkres, int* step);
+
+// 深度优先搜索，查找增广路径
+bool dfs(Munkres* munkres, int m, bool *visited_x, bool *visited_y, int *match, float *lx, float *ly, float *slack, float *minz);
+
+// Step 1: 对每一行进行最小值减法；某行全为DISALLOWED时返回-1
+int step1(Munkres* munkres);
+
+// Step 2: 标记零
+int step2(Munkres* munkres);
+
+// Step 2（可选）：先做一次列归约，再用Hopcroft-Karp在零元素构成的二分图上求最大匹配并全部标星，
+// O(E√V)。平局很多时贪心标星离最大匹配很远，之后要靠多轮step4/step5逐个修补。
+// 邻接表分配失败时退回贪心标星
+int step2_max_matching(Munkres* munkres);
+
+// Step 3: 覆盖包含星号零的所有列
+int step3(Munkres* munkres);
+
+// Step 4: 找到未覆盖的零并标记
+int step4(Munkres* munkres);
+
+// Step 5: 构建增广路径并调整标记
+int step5(Munkres* munkres, int* step);
+
+// Step 6: 调整矩阵元素；无法继续时返回-1
+int step6(Munkres* munkres);
+
+// 单调时钟（纳秒）
+long long monotonic_ns(void);
+
+// 求解指标：每个线程一个分片，只由所属线程写（relaxed加载后存储，不用原子读改写指令），
+// 线程退出时分片连同计数留在链表中供之后的新线程接管，分片数不超过同时记录过指标的线程数。
+// 导出时无锁遍历分片链表汇总，不阻塞求解线程。延迟直方图为HDR式对数-线性分桶（每个2的幂再分8段）
+typedef enum {
+    ENGINE_MUNKRES = 0,
+    ENGINE_TINY,
+    ENGINE_BATCH,
+    ENGINE_LAP,
+    ENGINE_CASCADE,
+    ENGINE_TOPK,
+    ENGINE_FLOW,
+    ENGINE_SINKHORN,
+    ENGINE_GREEDY,
+    ENGINE_COUNT
+} SolverEngine;
+
+#define METRICS_SUB_BITS 3
+#define METRICS_SUB (1 << METRICS_SUB_BITS)
+#define METRICS_MAX_SHIFT 37  // 最大可分辨约 2^41 ns（约36分钟），更长的计入最后一桶
+#define METRICS_BUCKETS ((METRICS_MAX_SHIFT + 2) * METRICS_SUB)
+
+void metrics_enable(bool on);
+
+// 延迟值所在的桶：0..7直接对应，之后每个2的幂区间分为8段
+int metrics_bucket(unsigned long long ns);
+
+// 桶的上界（不含）
+unsigned long long metrics_bucket_upper(int b);
+
+void metrics_record(SolverEngine engine, int rows, int cols, long long start_ns,
+                    long long augmentations, long long infeasible_rows, bool failed);
+
+// 汇总后的单个引擎指标
+typedef struct {
+    unsigned long long calls;
+    unsigned long long failures;
+    unsigned long long cells;
+    unsigned long long max_cells;
+    unsigned long long augmentations;
+    unsigned long long infeasible_rows;
+    unsigned long long latency_sum_ns;
+    unsigned long long latency[METRICS_BUCKETS];
+} EngineMetrics;
+
+typedef struct {
+    long long unix_ms;      // 汇总时刻（墙上时间，毫秒）
+    EngineMetrics engine[ENGINE_COUNT];
+} MetricsSnapshot;
+
+// 无锁汇总所有分片（各计数器可能来自略有先后的时刻，但单调不减）
+void metrics_snapshot(MetricsSnapshot* out);
+
+// 当前已分配的分片数（线程退出后分片归还复用，不随线程数增长）
+int metrics_shard_count(void);
+
+// 延迟分位数（返回所在桶的上界，相对误差不超过1/8）
+double metrics_quantile_ns(const EngineMetrics* m, double q);
+
+// Prometheus文本格式；直方图按2的幂纳秒（约1us到34s）输出累积桶
+int metrics_write_prometheus(FILE* f, const MetricsSnapshot* snap);
+
+// JSON Lines：每次汇总输出一行，只包含被调用过的引擎
+int metrics_write_json(FILE* f, const MetricsSnapshot* snap);
+
+typedef enum {
+    METRICS_PROMETHEUS = 0,   // 写临时文件后rename整体替换（node_exporter textfile方式）
+    METRICS_JSON_LINES        // 追加一行
+} MetricsFormat;
+
+// 汇总并写出一次，返回0成功，-1失败
+int metrics_dump(const char* path, MetricsFormat format);
+
+// 周期导出线程
+typedef struct {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    bool stop;
+    const char* path;
+    MetricsFormat format;
+    int interval_ms;
+} MetricsExporter;
+
+// 启动周期导出（path需在导出期间保持有效），同时启用指标收集。返回0成功，-1失败
+int metrics_exporter_start(MetricsExporter* e, const char* path, MetricsFormat format, int interval_ms);
+
+// 停止导出线程（退出前会再写出一次）
+void metrics_exporter_stop(MetricsExporter* e);
+
+// 求解预算：deadline_ns为monotonic_ns()上的绝对截止时间，max_iterations为步骤迭代上限，0表示不限
+typedef struct {
+    long long deadline_ns;
+    long long max_iterations;
+} SolveBudget;
+
+// 求解状态
+typedef enum {
+    SOLVE_FAILED = -1,          // 输入无法求解
+    SOLVE_OPTIMAL = 0,          // 已证明最优
+    SOLVE_BUDGET_EXPIRED = 1    // 预算耗尽，返回贪心补全的可行解
+} SolveStatus;
+
+// 求解报告（成本均针对填充后的方阵，填充位置成本为0）
+typedef struct {
+    SolveStatus status;
+    long long iterations;   // 执行的步骤数
+    double lower_bound;     // 对偶下界
+    double cost;            // 返回分配的成本
+    double gap;             // cost - lower_bound，最优时为0；匹配不完整时为+inf（没有最优性保证）
+    int matched;            // 配对数（预算耗尽且贪心补全被DISALLOWED卡住时小于n）
+} SolveReport;
+
+// 带预算执行Munkres算法；budget为NULL时不限。report可为NULL
+// 约化矩阵满足 C = 原矩阵 - 已减去的行/列量 且 C >= 0，因此任意完美匹配的成本
+// = lower_bound + 匹配位置上C之和，后者即为最优性间隙。
+// 从munkres->step继续执行，因此也可以接在munkres_run_for之后完成剩余步骤
+SolveStatus compute_budget(Munkres* munkres, const SolveBudget* budget, SolveReport* report);
+
+// 执行Munkres算法。返回0成功，-1无解（某行全为DISALLOWED或不存在避开DISALLOWED的完美匹配）
+int compute(Munkres* munkres);
+
+// 分片执行的状态
+typedef enum {
+    RUN_FAILED = -1,
+    RUN_DONE = 0,
+    RUN_IN_PROGRESS = 1
+} RunStatus;
+
+// 最多执行max_iterations步（0表示不限），deadline_ns > 0 时到达monotonic_ns()上的该时刻也返回。
+// 至少执行一步。结束时按累计运行时间记录指标
+RunStatus munkres_run_slice(Munkres* munkres, long long max_iterations, long long deadline_ns);
+
+// 可恢复地执行至多n_iterations步：返回RUN_IN_PROGRESS时可在任意线程上再次调用继续
+RunStatus munkres_run_for(Munkres* munkres, long long n_iterations);
+
+// 获取配对结果
+int get_results(Munkres* munkres, Assignment results[], int original_rows, int original_cols);
+
+// 计算总成本基于原始成本矩阵
+float calculate_total_cost(Munkres* munkres, Assignment results[], int count);
+
+// 小规模专用求解器（n <= TINY_MAX_SIZE）：按列子集做状态压缩DP，
+// 每个尺寸由宏展开出一个固定大小的版本，数组全在栈上，循环边界为编译期常量
+#define TINY_MAX_SIZE 8
+
+int solve_tiny(float input_matrix[][MAX_SIZE], int input_rows, int input_cols, Assignment results[]);
+
+// 封装的匹配函数：n <= TINY_MAX_SIZE 时自动走专用求解器，否则走Munkres。
+// 含DISALLOWED时改用lap_solve：两条路径都返回不含DISALLOWED的最小成本最大匹配。返回0成功，-1内存不足
+int hungarian_match(float input_matrix[][MAX_SIZE], int input_rows, int input_cols, Assignment results[], int* result_count, float* total_cost);
+
+// 稀疏候选列表（CSR格式），每行内列索引升序
+typedef struct {
+    int rows;
+    int cols;
+    int nnz;              // 候选元素个数
+    int capacity;         // col_idx/cost 的容量
+    int row_capacity;     // row_ptr 的容量
+    int* row_ptr;         // 行偏移，长度 rows+1
+    int* col_idx;         // 列索引
+    float* cost;          // 候选成本
+} SparseCost;
+
+void sparse_cost_init(SparseCost* s);
+
+void sparse_cost_free(SparseCost* s);
+
+// 预留空间，返回0成功，-1内存不足
+int sparse_cost_reserve(SparseCost* s, int rows, int nnz);
+
+// 转置（CSR -> CSC），结果每行内列索引仍升序
+int sparse_transpose(const SparseCost* in, SparseCost* out);
+
+// 目标/观测框集合（SoA布局）
+typedef struct {
+    int count;
+    const float* x;        // 左上角x
+    const float* y;        // 左上角y
+    const float* w;        // 宽
+    const float* h;        // 高
+    const float* cov_xx;   // 中心位置协方差（仅目标使用，可为NULL）；启用马氏项时不正定的目标整行门控
+    const float* cov_xy;
+    const float* cov_yy;
+    const float* emb;      // 外观特征，维度主序 emb[k * count + i]，需L2归一化，可为NULL
+    int emb_dim;
+} BoxSet;
+
+// 代价构建参数：cost = w_iou*(1-IoU) + w_maha*马氏距离平方 + w_cos*余弦距离
+typedef struct {
+    float w_iou;
+    float w_maha;
+    float w_cos;
+    float min_iou;     // IoU低于该值时门控（<=0不启用）
+    float max_maha;    // 马氏距离平方超过该值时门控（<=0不启用），如chi2(2)的95%分位5.9915
+    float max_cos;     // 余弦距离超过该值时门控（<=0不启用）
+} CostParams;
+
+// 直接构建到Munkres工作区：一次遍历同时写入C、original_C并完成填充，替代单独建矩阵+pad_matrix
+int build_cost_munkres(Munkres* munkres, const BoxSet* tracks, const BoxSet* dets, const CostParams* p);
+
+// 构建稠密成本矩阵（行主序，行跨度stride）
+void build_cost_dense(float* out, int stride, const BoxSet* tracks, const BoxSet* dets, const CostParams* p);
+
+// 构建稀疏候选列表，只保留通过门控的配对
+int build_cost_sparse(SparseCost* out, const BoxSet* tracks, const BoxSet* dets, const CostParams* p);
+
+// 半精度成本存储：fp16（IEEE binary16）或bf16（fp32的高16位），对偶与累加仍为fp64，
+// 读取时在行解码循环中转换（fp16在有F16C时8路转换，否则用整数移位加一次乘法的向量转换；bf16为整数左移16位）。
+// 量化误差：按最近偶数舍入，fp16在正规数范围内 |q - c| <= 2^-11 |c|（|c| < 6.1e-5 时绝对误差 <= 2^-25），
+// bf16为 2^-8 |c|。设eps为相对误差，A为在量化成本上求得的最优分配、A*为真实最优，
+// 则 c(A) - c(A*) <= eps * (sum_{A}|c| + sum_{A*}|c|) <= 2 * eps * n * max|c|。
+// fp16最大有限值为65504，更大的成本编码时截断为最大值（返回截断个数，调用方应先缩放）；
+// DISALLOWED编码为inf，解码后仍判为DISALLOWED。需要确切结论时用lap_recheck_exact在全精度下给出间隙证书
+typedef enum {
+    HALF_FP16 = 0,
+    HALF_BF16
+} HalfFormat;
+
+static inline float half_to_float(uint16_t h) {
+    uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+    uint32_t exp = (h >> 10) & 0x1F, mant = h & 0x3FF;
+    uint32_t bits;
+    if (exp == 0) {
+        float f = ldexpf((float)mant, -24); // 0或非正规数
+        return sign ? -f : f;
+    }
+    if (exp == 31) {
+        bits = sign | 0x7F800000u | (mant << 13);
+    } else {
+        bits = sign | ((exp + 112) << 23) | (mant << 13);
+    }
+    float f;
+    memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+static inline float bf16_to_float(uint16_t h) {
+    uint32_t bits = (uint32_t)h << 16;
+    float f;
+    memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+// fp32 -> fp16，最近偶数舍入；有限值溢出时截断为±65504并置*clamped
+uint16_t float_to_half(float f, bool* clamped);
+
+// fp32 -> bf16，最近偶数舍入；有限值溢出时截断为最大有限值并置*clamped
+uint16_t float_to_bf16(float f, bool* clamped);
+
+// 把fp32矩阵编码为半精度（out行跨度out_stride），返回被截断的元素个数
+int half_cost_encode(const float* src, int rows, int cols, int src_stride, HalfFormat fmt, uint16_t* out, int out_stride);
+
+// 解码n个半精度成本（源步长step个元素）到out
+void half_decode(const uint16_t* src, size_t step, int n, HalfFormat fmt, float* out);
+
+// 成本视图：求解器通过它读取成本，不拷贝输入
+typedef enum {
+    COST_DENSE = 0,    // 行主序稠密矩阵，行跨度stride
+    COST_SPARSE,       // CSR稀疏候选列表，未列出的配对视为DISALLOWED
+    COST_CALLBACK,     // 按需调用回调计算，经工作区的行缓存读取，不生成n x n矩阵
+    COST_HALF          // 行主序的fp16/bf16稠密矩阵，读取时解码为fp32
+} CostKind;
+
+// 单个成本回调：返回第row行第col列的成本（不允许的配对返回DISALLOWED_VAL）
+typedef float (*CostFn)(int row, int col, void* arg);
+// 可选的整块回调：把第row_begin..row_begin+count-1行写入out（每行cols个，行跨度out_stride）
+typedef void (*CostRowsFn)(int row_begin, int count, float* out, int out_stride, void* arg);
+
+typedef struct {
+    CostKind kind;
+    int rows;
+    int cols;
+    const float* dense;
+    int stride;
+    const SparseCost* sparse;
+    CostFn fn;
+    CostRowsFn rows_fn;
+    void* arg;
+    const uint16_t* half;   // COST_HALF的数据，行跨度stride
+    HalfFormat half_format;
+} CostView;
+
+CostView cost_view_dense(const float* data, int rows, int cols, int stride);
+
+CostView cost_view_sparse(const SparseCost* s);
+
+// fn必须提供；rows_fn可为NULL，提供时按行求解方向上的缓存缺失整块调用它
+CostView cost_view_callback(int rows, int cols, CostFn fn, CostRowsFn rows_fn, void* arg);
+
+// 半精度稠密视图（数据由half_cost_encode生成），内存与带宽为fp32的一半
+CostView cost_view_half(const uint16_t* data, int rows, int cols, int stride, HalfFormat fmt);
+
+// 读取单个成本
+float cost_view_at(const CostView* view, int i, int j);
+
+// 回调成本的行缓存：slots个槽，每槽缓存连续block行，按最近最少使用替换
+// 内存为 slots * block * 行长 加上O(n)的索引，可用row_cache_configure按可用内存调整
+typedef struct {
+    int slots;
+    int block;
+    int width;                  // 已分配的每行长度
+    float* data;                // slots * block * width
+    int* tag;                   // 槽中缓存的块号（-1为空）
+    int* slot_of;               // 块号所在的槽（-1为未缓存），命中时O(1)查找
+    unsigned long long* stamp;  // 最近一次使用的时间戳
+    unsigned long long clock;
+    bool transposed;            // 缓存内容所属的求解方向
+    long long hits;
+    long long misses;
+} RowCache;
+
+#define ROW_CACHE_SLOTS 64
+#define ROW_CACHE_BLOCK 1
+
+void row_cache_init(RowCache* c);
+
+void row_cache_free(RowCache* c);
+
+// 设置缓存规模（需在求解前调用），返回0成功，-1参数非法
+int row_cache_configure(RowCache* c, int slots, int block);
+
+// 保证每行能容纳width个成本，返回0成功，-1内存不足
+int row_cache_reserve(RowCache* c, int width);
+
+void row_cache_clear(RowCache* c);
+
+// 基于最短增广路径（对偶势）的求解器工作区，可在多次求解之间复用
+typedef struct {
+    int rows;               // 当前问题的行数
+    int cols;               // 当前问题的列数
+    int capacity;           // 已分配的 max(rows, cols)
+    double* u;              // 行对偶变量
+    double* v;              // 列对偶变量
+    int* row_to_col;        // 行匹配到的列（-1为未匹配）
+    int* col_to_row;        // 列匹配到的行（-1为未匹配）
+    double* dist;           // 最短路径长度
+    int* pred;              // 最短路径前驱行（-1为未触达）
+    unsigned char* scanned; // 列是否已出队
+    int* touched;           // 本次增广触达的列
+    int* visited;           // 本次增广访问的行
+    float* row_buf;         // 转置稠密访问时的行缓冲
+    int* order;             // 待增广的行列表（子集求解时使用）
+    unsigned char* row_mask;
+    unsigned char* col_mask;
+    unsigned char* row_sel; // 级联各级选中的行
+    SparseCost csc;         // 转置稀疏访问时的CSC副本
+    const SparseCost* csc_source; // csc 对应的稀疏输入
+    RowCache cache;         // 回调成本的行缓存
+    int augmentations;      // 成功增广次数
+    int infeasible_rows;    // 找不到可行列而未分配的行（转置时为列）
+} LapWorkspace;
+
+void lap_workspace_init(LapWorkspace* ws);
+
+void lap_workspace_free(LapWorkspace* ws);
+
+// 按问题尺寸预留空间，返回0成功，-1内存不足
+int lap_workspace_reserve(LapWorkspace* ws, int rows, int cols);
+
+// 清空匹配与对偶变量
+void lap_reset(LapWorkspace* ws, int rows, int cols);
+
+// 一次增广所需的上下文；transposed时问题方向的“行”是原始矩阵的列
+typedef struct {
+    const CostView* view;
+    LapWorkspace* ws;
+    bool transposed;
+    int n_rows;                     // 问题方向上的行数
+    int n_cols;                     // 问题方向上的列数
+    double* ur;                     // 问题方向上的行对偶
+    double* vc;                     // 问题方向上的列对偶
+    int* r2c;
+    int* c2r;
+    const unsigned char* col_mask;  // 问题方向上可用的列（NULL表示全部可用）
+} LapCtx;
+
+void lap_ctx_init(LapCtx* ctx, const CostView* view, LapWorkspace* ws, bool transposed);
+
+int lap_solve(const CostView* view, LapWorkspace* ws);
+
+// 热启动求解方阵：沿用ws中上一次同尺寸求解的列对偶，行对偶取 u_i = min_j (c_ij - v_j) 使所有约化成本非负，
+// 上一次的匹配中仍然紧（约化成本为0）的配对保留，只对其余行重新增广。
+// 成本变化不大时（如拉格朗日迭代）大部分配对保留。非方阵或尺寸变化时等同lap_solve
+int lap_solve_warm(const CostView* view, LapWorkspace* ws);
+
+int lap_solve_cascade(const CostView* view, const int* row_level, int num_levels,
+                      const CostView* second_stage, int second_max_level,
+                      LapWorkspace* ws, int* matched_stage);
+
+// Top-k稀疏化求解的统计
+typedef struct {
+    int rounds;           // 求解次数（1表示首轮候选集即最优）
+    int added_edges;      // 因约化成本为负而补回的边数
+    int nnz;              // 最终候选集的边数
+    bool dense_fallback;  // 是否退回稠密求解
+} TopkReport;
+
+#define TOPK_MAX_ROUNDS 4
+
+int lap_solve_topk(const CostView* view, int k, LapWorkspace* ws, SparseCost* cand, TopkReport* report);
+
+// 获取配对结果（按行序）
+int lap_get_results(const LapWorkspace* ws, Assignment results[]);
+
+// 计算配对结果在原始成本下的总成本
+float lap_total_cost(const CostView* view, const LapWorkspace* ws);
+
+// 子问题解缓存：按 (形状, 成本, DISALLOWED掩码, 方向) 的64位哈希分片，命中时逐元素比较排除碰撞，
+// 直接返回缓存的分配与对偶而不求解。每个分片一把锁、一个按字节预算淘汰的LRU链表与开链哈希表
+#define SOLUTION_CACHE_SHARDS 16
+#define SOLUTION_CACHE_BUCKETS 256    // 每个分片的哈希桶数
+
+typedef struct CacheEntry {
+    struct CacheEntry* next_in_bucket;
+    struct CacheEntry* lru_prev;      // 靠近表头的为最近使用
+    struct CacheEntry* lru_next;
+    uint64_t hash;
+    int rows;
+    int cols;
+    bool maximize;
+    int infeasible_rows;
+    int augmentations;
+    size_t bytes;
+    uint32_t* costs;                  // 规范化后的成本位模式（DISALLOWED统一为inf）
+    int* row_to_col;
+    double* u;
+    double* v;
+} CacheEntry;
+
+typedef struct {
+    pthread_mutex_t lock;
+    CacheEntry* buckets[SOLUTION_CACHE_BUCKETS];
+    CacheEntry* lru_head;
+    CacheEntry* lru_tail;
+    size_t bytes;
+    long long hits;
+    long long misses;
+    long long collisions;             // 哈希相同但内容不同
+    long long evictions;
+} CacheShard;
+
+typedef struct {
+    CacheShard shards[SOLUTION_CACHE_SHARDS];
+    size_t shard_budget;              // 每个分片的字节上限
+} SolutionCache;
+
+typedef struct {
+    long long hits;
+    long long misses;
+    long long collisions;
+    long long evictions;
+    long long entries;
+    size_t bytes;
+} SolutionCacheStats;
+
+// max_bytes为全部分片的总预算。返回0成功，-1失败
+int solution_cache_init(SolutionCache* cache, size_t max_bytes);
+
+void solution_cache_free(SolutionCache* cache);
+
+void solution_cache_stats(SolutionCache* cache, SolutionCacheStats* out);
+
+// 求解稠密视图，相同子问题命中缓存时直接返回之前的分配与对偶（ws中内容与lap_solve一致）。
+// maximize为true时按取负后的成本求最小，对偶对应取负后的成本。非稠密视图不经缓存直接求解。
+// 多线程可共用同一个cache（各自的ws）。maximize只支持稠密视图。返回0成功，-1内存不足或不支持
+int solution_cache_solve(SolutionCache* cache, const CostView* view, bool maximize, LapWorkspace* ws);
+
+// 异步求解：submit立即返回请求句柄，常驻的求解线程完成后可用async_wait等待，或在求解线程上调用完成回调。
+// 每个求解线程有一个无锁MPSC提交队列（Vyukov侵入式队列），同一stream固定映射到同一线程，
+// 因此同一stream的请求按提交顺序求解并回调。请求槽在初始化时预分配，submit不分配内存
+#define ASYNC_SPIN 4000                 // 睡眠前的空转次数
+#define ASYNC_STATUS_CANCELLED 1
+
+enum { ASYNC_FREE, ASYNC_QUEUED, ASYNC_RUNNING, ASYNC_CANCELLING, ASYNC_DONE };
+
+typedef struct AsyncNode {
+    struct AsyncNode* _Atomic next;
+} AsyncNode;
+
+typedef struct AsyncRequest AsyncRequest;
+typedef void (*AsyncCallback)(AsyncRequest* req, void* arg);
+
+struct AsyncRequest {
+    AsyncNode node;             // 必须是第一个成员
+    atomic_int state;
+    int index;                  // 在槽数组中的下标
+    int stream;
+    CostView view;              // 成本数据由调用方持有，完成前保持有效
+    AsyncCallback callback;     // 非NULL时在求解线程上调用，返回后槽自动归还
+    void* callback_arg;
+    int status;                 // 0成功，-1内存不足，ASYNC_STATUS_CANCELLED已取消
+    int rows;
+    int* row_to_col;            // 预分配max_rows
+    float total_cost;
+    int infeasible_rows;
+};
+
+typedef struct {
+    AsyncNode* _Atomic head;    // 生产者端
+    AsyncNode* tail;            // 消费者端，只由所属求解线程访问
+    AsyncNode stub;
+} AsyncQueue;
+
+typedef struct AsyncSolver AsyncSolver;
+
+typedef struct {
+    AsyncQueue queue;
+    atomic_int pending;         // 已入队未取出的请求数
+    atomic_int sleeping;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    pthread_t thread;
+    LapWorkspace ws;
+    AsyncSolver* solver;
+} AsyncWorker;
+
+struct AsyncSolver {
+    int workers;
+    AsyncWorker* worker;
+    int slots;
+    AsyncRequest* requests;
+    int* slot_rows;             // 所有槽的row_to_col连续存放
+    atomic_int* next_free;      // 空闲栈中下一个槽
+    _Atomic unsigned long long free_top; // 高32位为版本号（防ABA），低32位为栈顶槽号，0xFFFFFFFF为空
+    int max_rows;
+    int max_side;               // 工作区按 max(max_rows, max_cols) 预留（LAP在行多于列时转置求解）
+    atomic_bool stop;
+    atomic_int waiters;         // async_wait中睡眠的线程数
+    pthread_mutex_t done_lock;
+    pthread_cond_t done_cond;
+};
+
+// 归还请求槽（未设置回调的请求在取走结果后调用）
+void async_release(AsyncSolver* s, AsyncRequest* req);
+
+// 创建workers个求解线程与slots个请求槽，每个槽可容纳最多max_rows行的结果，
+// 各线程的工作区按max_rows x max_cols预留。返回0成功，-1失败
+int async_solver_init(AsyncSolver* s, int workers, int slots, int max_rows, int max_cols);
+
+// 处理完已提交的请求后停止求解线程并释放
+void async_solver_free(AsyncSolver* s);
+
+// 提交一个求解请求，stream>=0，同一stream的请求按提交顺序完成。callback为NULL时需async_wait后async_release。
+// 没有空闲槽、行数超过max_rows或较长一边超过预留的工作区时返回NULL（调用方可先等待已提交的请求）
+AsyncRequest* async_submit(AsyncSolver* s, const CostView* view, int stream, AsyncCallback callback, void* arg);
+
+// 尚未开始求解时取消，返回true；已开始或已完成时返回false。
+// 被取消的请求仍按stream顺序完成（status为ASYNC_STATUS_CANCELLED，回调照常调用）
+bool async_cancel(AsyncRequest* req);
+
+bool async_done(const AsyncRequest* req);
+
+// 阻塞到请求完成，返回其status。只用于没有回调的请求
+int async_wait(AsyncSolver* s, AsyncRequest* req);
+
+// 取出已完成请求的匹配结果，返回匹配数
+int async_get_results(const AsyncRequest* req, Assignment results[]);
+
+// 瓶颈指派：在最大基数匹配中最小化最大配对成本。对阈值做二分，每次取候选成本值的中位数（线性选择，不整体排序）；
+// 每行的边按已探测的阈值原地划分，阈值t下的图就是每行的一个前缀，候选只在上下两个已知阈值之间的分段里。
+// 每次探测沿用上次的匹配：升高阈值时原匹配仍然有效，降低时只删去超过阈值的配对，再用Hopcroft-Karp补足
+typedef struct {
+    int rows;
+    int cols;
+    int row_capacity;
+    int col_capacity;
+    size_t edge_capacity;
+    int* row_start;         // 长度rows+1
+    int* edge_col;          // 允许的边（列号），每行内按探测过的阈值分段
+    float* edge_cost;       // 与edge_col对应的成本
+    int* deg;               // 当前阈值下每行的有效前缀长度
+    int* lo_deg;            // 前缀内的边在任何后续探测中都有效
+    int* hi_deg;            // 超出的边在任何后续探测中都无效
+    float* values;          // 候选成本值（选择中位数用）
+    int* row_match;         // 行匹配到的列（-1为未匹配）
+    float* match_cost;      // 匹配边的成本
+    int* col_match;
+    int* dist;
+    int* next;
+    int* queue;
+    int* stack;
+    int* best;              // 最近一次可行探测的匹配
+    float* row_buf;
+    float* col_min;
+    float bottleneck;       // 最优的最大配对成本
+    int matched;            // 最大匹配数
+    int probes;             // 阈值探测次数
+    int phases;             // Hopcroft-Karp阶段总数
+} BottleneckWorkspace;
+
+void bottleneck_workspace_init(BottleneckWorkspace* ws);
+
+void bottleneck_workspace_free(BottleneckWorkspace* ws);
+
+// 瓶颈指派：在所有最大基数匹配中求最大配对成本最小的一个（不考虑总成本）。
+// 支持全部CostView类型，DISALLOWED的配对不参与。返回0成功，-1内存不足
+int bottleneck_solve(const CostView* view, BottleneckWorkspace* ws);
+
+// 取出瓶颈指派结果，返回匹配数
+int bottleneck_get_results(const BottleneckWorkspace* ws, Assignment results[]);
+
+// 分片调度：多个Munkres求解共享少量工作线程，每次取队首任务执行一个时间片（munkres_run_slice），
+// 未完成的放回队尾。大问题被切成许多片，与小问题轮转执行，小问题不必排在大问题整个求解之后。
+// 任务可能在不同线程上继续执行（状态都在Munkres结构体内）
+typedef struct SliceTask SliceTask;
+typedef void (*SliceDoneFn)(SliceTask* task, void* arg);
+
+struct SliceTask {
+    Munkres* munkres;       // 已pad_matrix并initialize
+    SliceDoneFn done;       // 完成时在工作线程上调用，可为NULL
+    void* arg;
+    RunStatus status;
+    int slices;             // 执行的分片数
+    int last_worker;        // 最近执行它的工作线程
+    int migrations;         // 在线程间迁移的次数
+    long long submit_ns;
+    long long finish_ns;
+    SliceTask* next;
+};
+
+typedef struct SliceScheduler SliceScheduler;
+
+typedef struct {
+    SliceScheduler* sched;
+    pthread_t thread;
+    int index;
+} SliceWorker;
+
+struct SliceScheduler {
+    pthread_mutex_t lock;
+    pthread_cond_t work;    // 队列非空或停止
+    pthread_cond_t idle;    // 队列空且没有正在执行的任务
+    SliceTask* head;
+    SliceTask* tail;
+    int running;
+    bool stop;
+    long long quantum_ns;   // 时间片长度，0表示不分片（执行到完成）
+    SliceWorker* workers;
+    int n_workers;
+    long long slices;       // 累计执行的分片数
+};
+
+// workers个工作线程，时间片quantum_ns（0表示每个任务执行到完成）。返回0成功，-1失败
+int slice_scheduler_init(SliceScheduler* s, int workers, long long quantum_ns);
+
+// 提交任务（调用方持有task与munkres，完成前不得释放）
+void slice_submit(SliceScheduler* s, SliceTask* task, Munkres* munkres, SliceDoneFn done, void* arg);
+
+// 等待所有已提交的任务完成
+void slice_scheduler_wait_idle(SliceScheduler* s);
+
+// 完成已提交的任务后停止工作线程并释放
+void slice_scheduler_free(SliceScheduler* s);
+
+// 全精度复核结果
+typedef struct {
+    double cost;            // 分配在全精度成本下的总成本
+    double lower_bound;     // 由求解对偶修正为全精度可行后得到的下界
+    double gap;             // cost - lower_bound，分配与真实最优之差不超过该值
+} ExactCheck;
+
+// 在全精度成本exact上复核ws中的分配（如半精度求解的结果）：对偶按较小一侧逐行（逐列）
+// 补上最负的约化成本后对exact可行，由此得到下界与间隙证书，需要O(rows*cols)次读取。
+// exact需为稠密、半精度或回调视图。返回0成功，-1视图不支持、内存不足或存在未分配的行
+int lap_recheck_exact(const CostView* exact, const LapWorkspace* ws, ExactCheck* out);
+
+// 带容量的一对多分配（最小费用流）：源点 -> 行（容量row_cap）-> 列（边容量1，费用c_ij）-> 汇点（容量col_cap）
+// 与lap_augment相同的带势逐次最短路：每次从一个仍有容量的行出发增广1个单位，到达尚有容量的列即停止，
+// 耗时随总容量增长而不复制行列。总容量较大的一侧作为“列”，与lap_solve的转置规则一致。
+// 问题方向上称源侧为A、汇侧为B；转置时A为原始矩阵的列
+typedef struct {
+    LapWorkspace lap;       // 复用其按行取成本的设施（转置稠密、CSC、回调行缓存）
+    int rows;
+    int cols;
+    bool transposed;
+    int capacity;           // 已分配的节点数（两侧共用）
+    int list_capacity;      // 已分配的配对表长度
+    double* pi_a;           // A侧势，约化成本为 c + pi_a - pi_b
+    double* pi_b;
+    double* dist_a;         // 最短距离（INFINITY为未触达）
+    double* dist_b;
+    int* pred_a;            // A节点的前驱B节点（-1为本次的源）
+    int* pred_b;            // B节点的前驱A节点
+    float* pred_cost;       // pred_b[j] -> j 这条边的成本
+    unsigned char* done_a;
+    unsigned char* done_b;
+    int* touched_a;
+    int* touched_b;
+    int* cap_a;             // 有效容量：min(给定容量, 对侧节点数)
+    int* cap_b;
+    int* off_a;             // 配对表起点（每个节点预留cap个）
+    int* off_b;
+    int* used_a;            // 已用容量
+    int* used_b;
+    int* list_a;            // A节点配对的B节点
+    int* list_b;            // B节点配对的A节点
+    float* cost_b;          // 与list_b对应的成本（按最小化方向）
+    unsigned int* mark;     // 扫描A节点时标记其已配对的B节点
+    unsigned int stamp;
+    int flow;               // 总配对数
+    int unrouted;           // 源侧未能分配出去的容量
+    double cost;            // 总成本（按原始成本）
+} FlowWorkspace;
+
+void flow_workspace_init(FlowWorkspace* ws);
+
+void flow_workspace_free(FlowWorkspace* ws);
+
+int flow_solve(const CostView* view, const int* row_cap, const int* col_cap, bool maximize, FlowWorkspace* ws);
+
+// 获取配对结果（按行序，每行可有多个），返回配对数
+int flow_get_results(const FlowWorkspace* ws, Assignment results[]);
+
+// 默认值压缩矩阵：除例外元素外，第i行的成本都是row_default[i]（row_default为NULL时都是value）
+// 例外元素为CSR格式（每行列索引升序），默认值或例外为DISALLOWED时该配对不可用
+typedef struct {
+    int rows;
+    int cols;
+    float value;
+    const float* row_default;
+    const SparseCost* exceptions;
+} DefaultCost;
+
+// 默认值矩阵的求解工作区：没有例外元素的列对任何行成本相同、可互换，合并成一个容量为列数的类节点，
+// 其余列按例外补全默认值，交给flow_solve。规模为 行数 x (例外列数 + 1)，与总列数无关
+typedef struct {
+    FlowWorkspace flow;
+    SparseCost by_col;      // 转置后的例外元素
+    SparseCost compact;     // 压缩后的问题：例外列在前，类节点为最后一列
+    int col_capacity;
+    int* slot;              // 原始列 -> 压缩列（-1为无例外的列）
+    int* col_map;           // 压缩列 -> 原始列
+    int* plain;             // 无例外的列（升序），类节点的配对依次取用
+    int* col_cap;
+    int row_capacity;
+    int* row_to_col;        // 结果：原始行匹配到的原始列（-1为未匹配）
+    Assignment* pairs;
+    int rows;
+    int matched;            // 配对数
+    int exception_cols;     // 压缩后保留的例外列数
+    double cost;            // 总成本
+} DefaultWorkspace;
+
+void default_workspace_init(DefaultWorkspace* ws);
+
+void default_workspace_free(DefaultWorkspace* ws);
+
+// 从稠密矩阵中取出不等于value的元素作为例外（out为CSR），返回0成功，-1内存不足
+int default_cost_extract(const float* data, int rows, int cols, int stride, float value, SparseCost* out);
+
+// 求解默认值矩阵，结果与lap_solve相同：较小一侧尽量全部匹配、总成本最小
+// 行多于列且默认值全矩阵统一时先转置，使合并发生在较长的一侧。平局按确定的顺序解决：
+// 类节点中的列按列号升序依次分给按行号升序的匹配行，相同输入总得到相同结果
+// 结果在ws->row_to_col中，ws->matched为配对数，ws->cost为总成本。返回0成功，-1内存不足
+int default_cost_solve(const DefaultCost* m, DefaultWorkspace* ws);
+
+// 获取配对结果，返回配对数
+int default_cost_get_results(const DefaultWorkspace* ws, Assignment results[]);
+
+// 常驻线程池：parallel_for把[0,count)按grain对齐切块，调用线程作为0号工作线程参与
+typedef void (*ParallelFn)(int begin, int end, int worker, void* arg);
+
+typedef struct {
+    int threads;                // 工作线程总数（含调用线程）
+    pthread_t* handles;
+    pthread_mutex_t lock;
+    pthread_cond_t start_cond;
+    pthread_cond_t done_cond;
+    unsigned long generation;   // 每次派发任务加1
+    int pending;                // 尚未完成的后台线程数
+    bool stop;
+    ParallelFn fn;
+    void* arg;
+    int count;
+    int chunk;
+} WorkerPool;
+
+// 创建线程池，threads<=0时取在线CPU数。返回0成功，-1失败
+int worker_pool_init(WorkerPool* pool, int threads);
+
+void worker_pool_free(WorkerPool* pool);
+
+// 并行执行fn，块大小按grain对齐（如按缓存行对齐列块）；pool为NULL时在当前线程执行
+void worker_pool_parallel_for(WorkerPool* pool, int count, int grain, ParallelFn fn, void* arg);
+
+// 候选生成：按观测中心建均匀网格（每帧整体重建，计数排序），每个目标只查询门控区域覆盖的网格，
+// 对落在区域内的观测精确计算代价并写入CSR，总代价与通过区域筛选的配对数成正比而不是 rows*cols。
+// 门控区域是保守的外接矩形，得到的候选与build_cost_sparse完全相同
+typedef struct {
+    float cell;           // 网格边长
+    float min_x;
+    float min_y;
+    int nx;
+    int ny;
+    int cell_capacity;
+    int item_capacity;
+    int* cell_start;      // 长度 nx*ny+1
+    int* items;           // 按网格排序的观测下标（网格内升序）
+    int* cell_of;         // 每个观测所在的网格
+    float max_w;          // 观测框的最大宽高，用于IoU门控的外接区域
+    float max_h;
+} SpatialGrid;
+
+// 每个工作线程处理一段连续的目标，候选先写入自己的缓冲区
+typedef struct {
+    int* col;
+    float* cost;
+    int count;
+    int capacity;
+    int error;
+    long long tested;     // 精确计算过的配对数
+} CandidateChunk;
+
+typedef struct {
+    SpatialGrid grid;
+    int chunk_capacity;
+    CandidateChunk* chunks;
+    int* row_count;
+    int row_capacity;
+    long long tested;     // 最近一次构建精确计算过的配对数
+} CandidateBuilder;
+
+void candidate_builder_init(CandidateBuilder* b);
+
+void candidate_builder_free(CandidateBuilder* b);
+
+// 按观测中心重建网格。cell<=0时取观测框平均边长的2倍；网格数不超过观测数的4倍。返回0成功，-1内存不足
+int spatial_grid_build(SpatialGrid* g, const BoxSet* dets, float cell);
+
+// 用空间网格构建稀疏候选列表，结果与build_cost_sparse相同。每帧重建网格；pool非NULL时按目标并行。
+// 返回0成功，-1内存不足
+int build_cost_sparse_indexed(CandidateBuilder* b, SparseCost* out, const BoxSet* tracks, const BoxSet* dets,
+                              const CostParams* p, WorkerPool* pool);
+
+// 并行稠密最短增广：列按缓存行对齐切块，每个工作线程负责一块的松弛与块内最小值，
+// 每步一次屏障后各线程冗余地归约出同一个全局最小列，控制流保持同步
+#define LAP_PARALLEL_MIN_COLS 512  // 列数低于该值时屏障开销超过收益，退回串行
+#define LAP_PARALLEL_ALIGN 16      // 列块按16列对齐（float与double数组的块边界都落在缓存行上）
+
+// 稠密成本的多线程求解，结果（含平局的选择）与lap_solve完全相同。
+// 非稠密视图、pool为NULL或单线程、以及问题方向上列数较少时直接走串行版。返回0成功，-1内存不足
+int lap_solve_parallel(const CostView* view, LapWorkspace* ws, WorkerPool* pool);
+
+// 多帧（S维）指派：S帧（3..5）的对象之间给出稀疏假设列表，每条假设在每帧至多取一个对象（-1为该帧缺失），
+// 选出互不冲突（每个对象至多被一条假设使用）的假设使总成本最小，不选时成本为0。
+// 拉格朗日松弛：保留帧a、b的约束，其余帧的约束以乘子lambda>=0并入成本，松弛后是一个带空配对的二维指派，
+// 用稀疏LAP求解（行a、列b，再加每行/每列的空配对，方阵（n_a+n_b）上的完美匹配），迭代之间热启动。
+// 不同的(a, b)给出互相独立的松弛，在线程池上并行做次梯度迭代，取最大的下界与最好的可行解。
+// 可行解由松弛解贪心修复得到，间隙为 (上界 - 下界) / |上界|
+#define MDA_MAX_DIMS 5
+
+typedef struct {
+    int dims;                   // 帧数S
+    int size[MDA_MAX_DIMS];     // 每帧对象数
+    int count;                  // 假设数
+    const int* idx;             // count * dims，第h条假设在帧s的对象为 idx[h * dims + s]
+    const float* cost;
+} HypothesisList;
+
+typedef struct {
+    int max_iterations;
+    double time_budget_ms;      // <=0不限时
+    double target_gap;          // 达到该相对间隙即停止
+    WorkerPool* pool;           // 可为NULL
+} MdaParams;
+
+// 一个松弛：保留帧a、b。成对分组：同一(i_a, i_b)的假设只有约化成本最小的一条可能被选中
+typedef struct {
+    int a;
+    int b;
+    int n;                      // 方阵尺寸 n_a + n_b
+    int groups;
+    int* group_start;           // 长度groups+1，指向order
+    int* order;                 // 按(i_a, i_b)排序的假设
+    int* group_row;             // 分组的i_a（-1为缺失）
+    int* group_col;
+    int* row_empty;             // (i, -1)分组，没有时为-1
+    int* col_empty;             // (-1, j)分组
+    int* edge_group;            // CSR中每个元素对应的分组，-1为成本固定为0的空配对
+    SparseCost graph;
+    LapWorkspace ws;
+    bool warm;
+    double* lambda;             // 按帧偏移存放，保留帧的部分不用
+    double* rc;                 // 每条假设的约化成本
+    int* best;                  // 每个分组中约化成本最小的假设
+    int* usage;                 // 松弛解中每个对象被使用的次数
+    unsigned char* chosen;      // 松弛解选中的假设
+    unsigned char* feasible;    // 修复得到的可行解
+    unsigned char* used;
+    double lower_bound;
+    double upper_bound;
+    double best_lower;
+    double step_scale;
+    int stall;                  // 下界连续未改进的迭代数
+    int error;
+} MdaRelax;
+
+typedef struct {
+    HypothesisList hyps;
+    int offset[MDA_MAX_DIMS + 1]; // 各帧对象在lambda等数组中的偏移
+    int* by_cost;               // 按原始成本升序的假设（贪心补充用）
+    int relaxations;
+    MdaRelax* relax;
+    double global_upper;
+    // 结果
+    unsigned char* selected;    // 最好的可行解
+    double lower_bound;
+    double upper_bound;
+    double gap;
+    int iterations;
+    double elapsed_ms;
+} MdaSolver;
+
+void mda_solver_free(MdaSolver* s);
+
+// 建立求解器：对每对相邻帧(s, s+1)各建一个松弛。hyps的数组在求解期间保持有效。
+// 返回0成功，-1参数非法（帧数不在3..MDA_MAX_DIMS、对象下标越界）或内存不足
+int mda_solver_init(MdaSolver* s, const HypothesisList* hyps);
+
+// 迭代到达到目标间隙、迭代上限或时间预算。结果在s->selected、lower_bound、upper_bound、gap中。
+// 返回0成功，-1内存不足
+int mda_solve(MdaSolver* s, const MdaParams* params);
+
+// 贪心 + 局部搜索的近似求解：先按step1做行归约、再做列归约，得到势 r_i、v_j；
+// 在约化成本 c_ij - r_i - v_j 上做全局最小贪心（各行在未占用列上的最小值放在小根堆中，
+// 先按序查看每行约化成本最小的候选列，候选都被占用后才整行扫描），
+// 再沿候选列做有界的改进：移到空闲列、两行交换（2-opt）、三行轮换（3-opt）。
+// 同一组势给出对偶下界，结果附带可证明的最优性差距。DISALLOWED不会被选中
+typedef struct {
+    int max_passes;     // 局部搜索轮数上限（默认4，0表示只做贪心）
+    int candidates;     // 每行的候选列数（约化成本最小的若干列，默认4，最多64）；0表示贪心整行扫描且不做交换
+    double target_gap;  // 证明的相对差距不超过该值即停止（默认1e-3）
+} GreedyParams;
+
+typedef struct {
+    int rows;
+    int cols;
+    int row_capacity;
+    int col_capacity;
+    int cand_capacity;
+    float* penalty;     // 列已占用为+inf，否则为0（贪心阶段为 -v_j）
+    float* row_pot;     // 行归约量 r_i（全为DISALLOWED时为+inf）
+    float* col_pot;     // 列归约量 v_j
+    float* row_min;     // 行在未占用列上的最小代价
+    int* row_arg;
+    int* row_to_col;    // -1为未匹配
+    int* col_to_row;
+    int* cand;          // 每行约化成本最小的若干列，升序，不足时以-1补齐
+    int* cand_pos;      // 贪心阶段每行下一个待查看的候选
+    int* heap;          // 贪心阶段按行最小值排序的小根堆
+    double* col_min;    // 下界计算用
+    float cost;         // 匹配总代价
+    double lower_bound; // 对偶下界（匹配未覆盖较短一边时为-inf）
+    double gap;         // cost - lower_bound，最优解与本解之差不超过该值
+    double rel_gap;     // gap / |cost|
+    int passes;         // 实际局部搜索轮数
+    int moves;          // 改进步数
+} GreedyWorkspace;
+
+void greedy_workspace_init(GreedyWorkspace* ws);
+
+void greedy_workspace_free(GreedyWorkspace* ws);
+
+// 近似求解稠密成本矩阵（行跨度stride），params为NULL时用默认参数。
+// 贪心或某轮局部搜索后证明差距已不超过target_gap时提前结束。返回0成功，-1内存不足
+int greedy_solve(const float* cost, int rows, int cols, int stride, const GreedyParams* params, GreedyWorkspace* ws);
+
+int greedy_get_results(const GreedyWorkspace* ws, Assignment results[]);
+
+// 自动选择求解策略：按形状、可行元素密度与平局比例，用代价模型预测各策略耗时并选最快的一个。
+// 模型按密度分档，每档每个策略拟合 t = a * n^b（n = sqrt(rows * cols)，单位ms），
+// 参数由启动时的短时校准测得，也可以保存/加载为profile。没有校准时使用内置的默认参数。
+// 可选策略：tiny（n <= TINY_MAX_SIZE）、munkres（n <= MAX_SIZE且没有DISALLOWED）、lap（稠密）、
+// sparse（先压缩为CSR再求解）、parallel（线程池上的稠密LAP，列数 >= LAP_PARALLEL_MIN_COLS）。
+// greedy为近似解，不参与自动选择，只能用assign_engine按次指定
+typedef enum {
+    STRATEGY_TINY = 0,
+    STRATEGY_MUNKRES,
+    STRATEGY_LAP,
+    STRATEGY_SPARSE,
+    STRATEGY_PARALLEL,
+    STRATEGY_GREEDY,
+    STRATEGY_COUNT
+} Strategy;
+
+extern const char* const strategy_names[STRATEGY_COUNT];
+
+#define DISPATCH_DENSITY_BUCKETS 3
+#define DISPATCH_TIE_SAMPLES 256
+#define DISPATCH_TIE_THRESHOLD 0.3  // 平局比例超过该值时Munkres启用零图最大匹配初始化
+
+extern const float dispatch_densities[DISPATCH_DENSITY_BUCKETS];
+
+typedef struct {
+    double a;
+    double b;
+    bool valid;
+} StrategyFit;
+
+typedef struct {
+    StrategyFit fit[DISPATCH_DENSITY_BUCKETS][STRATEGY_COUNT];
+    bool calibrated;
+    _Atomic unsigned long long decisions[STRATEGY_COUNT]; // 各策略被选中的次数
+} Dispatcher;
+
+typedef struct {
+    Strategy strategy;
+    int rows;
+    int cols;
+    double density;         // 可行（非DISALLOWED）元素比例
+    double tie_ratio;       // 抽样元素中与其他样本相等的比例
+    double predicted_ms;    // 所选策略的预测耗时
+} DispatchDecision;
+
+typedef struct {
+    LapWorkspace lap;
+    SparseCost sparse;
+    GreedyWorkspace greedy;     // greedy的下界与差距也在这里读取
+    float (*square)[MAX_SIZE];  // tiny/munkres需要的MAX_SIZE跨度矩阵，按需分配
+} DispatchWorkspace;
+
+void dispatch_workspace_init(DispatchWorkspace* ws);
+
+void dispatch_workspace_free(DispatchWorkspace* ws);
+
+// 内置默认参数（单核x86-64上测得），没有校准或加载profile时使用
+void dispatcher_init(Dispatcher* d);
+
+// 按指定策略求解稠密成本矩阵，结果不含DISALLOWED配对；除greedy外与lap_solve一样是代价最小的最大匹配。
+// 返回0成功，-1失败
+int dispatch_run(Strategy s, const float* cost, int rows, int cols, int stride, double tie_ratio,
+                 WorkerPool* pool, DispatchWorkspace* ws, Assignment results[], int* count);
+
+// 自动选择策略求解稠密成本矩阵（行跨度stride）。results至少能容纳min(rows, cols)个配对。
+// decision可为NULL。pool可为NULL（此时不考虑parallel）。返回0成功，-1失败
+int assign_auto(Dispatcher* d, const float* cost, int rows, int cols, int stride, WorkerPool* pool,
+                DispatchWorkspace* ws, Assignment results[], int* count, float* total_cost, DispatchDecision* decision);
+
+// 按次指定策略求解（如对延迟敏感的调用用greedy），策略不适用于该形状时返回-1。
+// 选greedy时下界与差距见ws->greedy。其余参数同assign_auto
+int assign_engine(Strategy strategy, const float* cost, int rows, int cols, int stride, WorkerPool* pool,
+                  DispatchWorkspace* ws, Assignment results[], int* count, float* total_cost);
+
+// 启动校准：在每个密度档上对各策略计时若干尺寸并拟合参数。pool为NULL时不校准parallel。
+// 单核上约需几百毫秒。返回0成功，-1内存不足
+int dispatcher_calibrate(Dispatcher* d, WorkerPool* pool);
+
+// profile文本格式：每行“密度档 策略名 a b”，无效项不写出
+int dispatcher_save_profile(const Dispatcher* d, const char* path);
+
+// 加载profile：文件中出现的项覆盖当前参数，未出现的项标为无效。返回0成功，-1失败
+int dispatcher_load_profile(Dispatcher* d, const char* path);
+
+// 各策略被选中的次数
+void dispatcher_stats(Dispatcher* d, unsigned long long out[STRATEGY_COUNT]);
+
+// 按列块取成本：out[k * n_cols + c] 为 rows[k] 行、col_begin + c 列的成本。返回0成功，-1失败
+typedef int (*GalleryBlockFn)(const int* rows, int n_rows, int col_begin, int n_cols, float* out, void* arg);
+
+typedef struct {
+    int rows;
+    int cols;
+    GalleryBlockFn fn;
+    void* arg;
+    const float* map;       // 内存映射的列主序成本文件（cols 个长度为 rows 的列）
+    size_t map_bytes;
+} GallerySource;
+
+GallerySource gallery_source_callback(int rows, int cols, GalleryBlockFn fn, void* arg);
+
+// 映射列主序的float32成本文件（大小必须为 rows * cols * 4 字节）。返回0成功，-1失败
+int gallery_source_mmap(GallerySource* src, const char* path, int rows, int cols);
+
+void gallery_source_close(GallerySource* src);
+
+typedef struct {
+    float cost;
+    int col;
+} GalleryCand;
+
+typedef struct {
+    int initial_k;      // 每行初始候选数（默认16）
+    int max_k;          // 每行候选数上限，0表示不限
+    int block_cols;     // 每次读取的列数（默认4096）
+    WorkerPool* pool;   // 可为NULL；列块在线程间并行扫描
+} GalleryParams;
+
+// 每个工作线程的扫描缓冲：活跃行各有一个有界堆
+typedef struct {
+    GalleryCand* heap;
+    int* count;
+    float* tau;
+    float* block;
+    size_t heap_capacity;
+    int row_capacity;
+} GalleryWorker;
+
+typedef struct {
+    int rows;
+    int cols;
+    GalleryCand** cand;     // 每行候选（按列升序）
+    int* cand_count;
+    int* cap;               // 每行候选上限
+    float* tau;             // 每行未保留元素的最小代价（全部保留时为+inf）
+    double* theta;          // 重扫时的接收阈值（只收 c < theta）
+    int* active;            // 本轮需要扫描的行
+    int* offset;            // 活跃行在工作线程堆中的偏移
+    int n_active;
+    GalleryWorker* workers;
+    int n_workers;
+    int* union_cols;        // 候选列的并集（升序）
+    int* lap_row;           // LAP行对应的查询行：没有任何可行列的行（候选为空且tau为+inf）不参与求解
+    int n_lap_rows;
+    int* queue;             // 不可行分量的交错路径搜索
+    unsigned char* reached;
+    SparseCost sparse;
+    LapWorkspace ws;
+    int* row_to_col;        // 结果：每行匹配的库列，-1为未匹配
+    float total_cost;
+    bool certified;         // 是否证明了全体列上的最优性
+    int passes;             // 扫描轮数
+    long long cells_scanned;
+    long long candidates;   // 最后一轮的候选总数
+    int union_size;
+    // 扫描期间共享
+    const GallerySource* src;
+    const GalleryParams* params;
+    _Atomic int error;
+} GallerySolver;
+
+void gallery_solver_init(GallerySolver* g);
+
+void gallery_solver_free(GallerySolver* g);
+
+// 求解：行数必须不多于列数。certified为false表示候选达到max_k仍未能证明最优，此时结果为候选上的最优解。
+// 返回0成功，-1参数错误、内存不足或取块失败
+int gallery_solve(GallerySolver* g, const GallerySource* src, const GalleryParams* params);
+
+// 导出结果（行升序），返回配对数
+int gallery_get_results(const GallerySolver* g, Assignment results[]);
+
+// 熵正则（Sinkhorn-Knopp）软分配参数
+typedef struct {
+    float epsilon;          // 熵正则系数，与成本同量纲，越小越接近硬分配
+    int max_iterations;
+    float tolerance;        // 行边缘L1误差低于该值时收敛
+    WorkerPool* pool;       // 可为NULL（单线程）
+} SinkhornParams;
+
+typedef struct {
+    int iterations;
+    float marginal_error;
+    bool converged;
+} SinkhornReport;
+
+int sinkhorn_solve(const CostView* view, const SinkhornParams* params, float* plan, int plan_stride,
+                   int* row_to_col, float min_prob, SinkhornReport* report);
+
+// 批量模式：同尺寸小矩阵按SIMD通道数一组打包为SoA（[i][j][lane]），
+// 各通道同步执行最短增广路，已到达空闲列或判定无解的通道由掩码屏蔽
+#define BATCH_MAX_SIZE 16
+
+int solve_batch(const float* const* matrices, int count, int rows, int cols, int stride,
+                int* row_to_col, float* totals);
+
+#endif // MUNKRES_H
@@ -0,0 +1,681 @@
+// 本地分配守护进程：持有线程池与可复用工作区，客户端通过Unix域套接字提交请求，
+// 成本矩阵与分配结果都放在客户端创建的共享内存环中（连接时用SCM_RIGHTS传递fd），不做序列化。
+// 守护进程每轮poll收集所有客户端的请求，按优先级排序后成批并行求解。
+// 守护进程不存在时，客户端自动退回进程内求解，接口不变。
+//   gcc -O2 -o munkres_daemon munkres_daemon.c munkres.c -lm -lpthread
+#define _GNU_SOURCE
+#include "munkres.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+// 自测用的线性同余随机数
+static unsigned int assign_rand(unsigned int* state) {
+    *state = *state * 1103515245u + 12345u;
+    return (*state >> 8) & 0xFFFFFF;
+}
+
+#define ASSIGN_MAGIC 0x4D554E4Bu   // "MUNK"
+#define ASSIGN_MAX_CLIENTS 64
+#define ASSIGN_MAX_BATCH 256
+#define ASSIGN_DEFAULT_SOCKET "/tmp/munkres_assign.sock"
+
+typedef enum {
+    MSG_HELLO = 1,   // 客户端 -> 守护进程：携带共享内存fd、环大小、槽数与优先级
+    MSG_SOLVE,       // 客户端 -> 守护进程：求解某个槽中的矩阵
+    MSG_RESULT       // 守护进程 -> 客户端：该槽的结果已写回共享内存
+} AssignMsgType;
+
+// 定长消息（SOCK_SEQPACKET保持消息边界）
+typedef struct {
+    uint32_t magic;
+    uint32_t type;
+    int32_t slot;
+    int32_t priority;     // HELLO时为客户端优先级（越大越先求解）
+    int32_t rows;
+    int32_t cols;
+    int32_t status;       // RESULT：0成功，-1请求非法或求解失败
+    int32_t slots;        // HELLO：槽数
+    uint64_t ring_bytes;  // HELLO：共享内存大小
+    double total;         // RESULT：总成本
+} AssignMsg;
+
+// 槽布局：[float 成本 rows*cols（行跨度cols）][int row_to_col rows]
+static size_t assign_result_offset(int rows, int cols) {
+    size_t bytes = sizeof(float) * (size_t)rows * (size_t)cols;
+    return (bytes + 7) & ~(size_t)7;
+}
+
+static bool assign_fits(size_t slot_bytes, int rows, int cols) {
+    return rows > 0 && cols > 0 && rows <= 1 << 20 && cols <= 1 << 20 &&
+           assign_result_offset(rows, cols) + sizeof(int) * (size_t)rows <= slot_bytes;
+}
+
+static int assign_send(int fd, const AssignMsg* msg, int pass_fd) {
+    struct iovec iov = {(void*)msg, sizeof(*msg)};
+    struct msghdr hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.msg_iov = &iov;
+    hdr.msg_iovlen = 1;
+    char control[CMSG_SPACE(sizeof(int))];
+    if (pass_fd >= 0) {
+        memset(control, 0, sizeof(control));
+        hdr.msg_control = control;
+        hdr.msg_controllen = sizeof(control);
+        struct cmsghdr* cmsg = CMSG_FIRSTHDR(&hdr);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        memcpy(CMSG_DATA(cmsg), &pass_fd, sizeof(int));
+    }
+    ssize_t n;
+    do {
+        n = sendmsg(fd, &hdr, MSG_NOSIGNAL);
+    } while (n < 0 && errno == EINTR);
+    return n == sizeof(*msg) ? 0 : -1;
+}
+
+// 接收一条消息，附带的fd写入*recv_fd（没有则为-1）。返回0成功，-1出错或对端关闭
+static int assign_recv(int fd, AssignMsg* msg, int* recv_fd) {
+    struct iovec iov = {msg, sizeof(*msg)};
+    struct msghdr hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.msg_iov = &iov;
+    hdr.msg_iovlen = 1;
+    char control[CMSG_SPACE(sizeof(int))];
+    hdr.msg_control = control;
+    hdr.msg_controllen = sizeof(control);
+    ssize_t n;
+    do {
+        n = recvmsg(fd, &hdr, MSG_CMSG_CLOEXEC);
+    } while (n < 0 && errno == EINTR);
+    if (recv_fd != NULL) {
+        *recv_fd = -1;
+    }
+    for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&hdr); cmsg != NULL; cmsg = CMSG_NXTHDR(&hdr, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+            int passed;
+            memcpy(&passed, CMSG_DATA(cmsg), sizeof(int));
+            if (recv_fd != NULL) {
+                *recv_fd = passed;
+            } else {
+                close(passed);
+            }
+        }
+    }
+    return n == sizeof(*msg) && msg->magic == ASSIGN_MAGIC ? 0 : -1;
+}
+
+// ---------------- 守护进程 ----------------
+
+typedef struct {
+    int fd;                 // -1为空位
+    unsigned char* ring;    // 映射的共享内存
+    size_t ring_bytes;
+    int slots;
+    size_t slot_bytes;
+    int priority;
+} DaemonClient;
+
+typedef struct {
+    int client;
+    int slot;
+    int rows;
+    int cols;
+    int priority;
+    long long arrival;      // 到达顺序，同优先级先到先解
+    int status;
+    double total;
+} DaemonJob;
+
+typedef struct {
+    DaemonClient clients[ASSIGN_MAX_CLIENTS];
+    DaemonJob jobs[ASSIGN_MAX_BATCH];
+    int n_jobs;
+    long long arrivals;
+    WorkerPool pool;
+    LapWorkspace* ws;       // 每个工作线程一个，跨请求复用
+} AssignDaemon;
+
+static volatile sig_atomic_t daemon_stop = 0;
+
+static void daemon_on_signal(int sig) {
+    (void)sig;
+    daemon_stop = 1;
+}
+
+static void daemon_drop_client(AssignDaemon* d, int k) {
+    DaemonClient* c = &d->clients[k];
+    if (c->ring != NULL) {
+        munmap(c->ring, c->ring_bytes);
+    }
+    close(c->fd);
+    memset(c, 0, sizeof(*c));
+    c->fd = -1;
+    // 丢弃该客户端尚未求解的请求
+    int kept = 0;
+    for (int t = 0; t < d->n_jobs; t++) {
+        if (d->jobs[t].client != k) {
+            d->jobs[kept++] = d->jobs[t];
+        }
+    }
+    d->n_jobs = kept;
+}
+
+static int compare_job_priority(const void* a, const void* b) {
+    const DaemonJob* x = a;
+    const DaemonJob* y = b;
+    if (x->priority != y->priority) {
+        return y->priority - x->priority;
+    }
+    return (x->arrival > y->arrival) - (x->arrival < y->arrival);
+}
+
+static void daemon_solve_range(int begin, int end, int worker, void* arg) {
+    AssignDaemon* d = arg;
+    LapWorkspace* ws = &d->ws[worker];
+    for (int t = begin; t < end; t++) {
+        DaemonJob* job = &d->jobs[t];
+        DaemonClient* c = &d->clients[job->client];
+        unsigned char* slot = c->ring + (size_t)job->slot * c->slot_bytes;
+        CostView view = cost_view_dense((const float*)slot, job->rows, job->cols, job->cols);
+        int* row_to_col = (int*)(slot + assign_result_offset(job->rows, job->cols));
+        job->status = lap_solve(&view, ws);
+        job->total = 0.0;
+        for (int i = 0; i < job->rows; i++) {
+            row_to_col[i] = job->status == 0 ? ws->row_to_col[i] : -1;
+            if (row_to_col[i] >= 0) {
+                job->total += cost_view_at(&view, i, row_to_col[i]);
+            }
+        }
+    }
+}
+
+// 按优先级成批求解当前收集到的请求并回复。客户端套接字为非阻塞：
+// 回复发不出去（对端不读导致缓冲区满，或已断开）时断开该客户端，不让它阻塞其他客户端
+static void daemon_dispatch(AssignDaemon* d) {
+    qsort(d->jobs, d->n_jobs, sizeof(DaemonJob), compare_job_priority);
+    worker_pool_parallel_for(&d->pool, d->n_jobs, 1, daemon_solve_range, d);
+    bool stalled[ASSIGN_MAX_CLIENTS] = {false};
+    for (int t = 0; t < d->n_jobs; t++) {
+        DaemonJob* job = &d->jobs[t];
+        AssignMsg reply = {ASSIGN_MAGIC, MSG_RESULT, job->slot, job->priority, job->rows, job->cols,
+                           job->status, 0, 0, job->total};
+        if (!stalled[job->client] && assign_send(d->clients[job->client].fd, &reply, -1) != 0) {
+            stalled[job->client] = true;
+        }
+    }
+    d->n_jobs = 0;
+    for (int k = 0; k < ASSIGN_MAX_CLIENTS; k++) {
+        if (stalled[k]) {
+            daemon_drop_client(d, k);
+        }
+    }
+}
+
+static void daemon_handle(AssignDaemon* d, int k) {
+    DaemonClient* c = &d->clients[k];
+    AssignMsg msg;
+    int shm_fd;
+    if (assign_recv(c->fd, &msg, &shm_fd) != 0) {
+        if (shm_fd >= 0) {
+            close(shm_fd);
+        }
+        daemon_drop_client(d, k);
+        return;
+    }
+    if (msg.type == MSG_HELLO && c->ring == NULL && shm_fd >= 0 && msg.slots > 0) {
+        // 客户端声明的大小不可信：fd的实际大小必须覆盖ring_bytes，且须已封住缩小（F_SEAL_SHRINK），
+        // 否则访问超出文件末尾的页会让守护进程收到SIGBUS
+        struct stat st;
+        int seals = fcntl(shm_fd, F_GET_SEALS);
+        void* ring = MAP_FAILED;
+        if (msg.ring_bytes > 0 && msg.ring_bytes <= SIZE_MAX && fstat(shm_fd, &st) == 0 &&
+            (uint64_t)st.st_size >= msg.ring_bytes && seals >= 0 && (seals & F_SEAL_SHRINK)) {
+            ring = mmap(NULL, msg.ring_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
+        }
+        close(shm_fd);
+        if (ring == MAP_FAILED) {
+            daemon_drop_client(d, k);
+            return;
+        }
+        c->ring = ring;
+        c->ring_bytes = msg.ring_bytes;
+        c->slots = msg.slots;
+        c->slot_bytes = msg.ring_bytes / msg.slots;
+        c->priority = msg.priority;
+        return;
+    }
+    if (shm_fd >= 0) {
+        close(shm_fd);
+    }
+    // 客户端不可信：槽号与尺寸必须落在它自己的共享内存内
+    if (msg.type != MSG_SOLVE || c->ring == NULL || msg.slot < 0 || msg.slot >= c->slots ||
+        !assign_fits(c->slot_bytes, msg.rows, msg.cols)) {
+        AssignMsg reply = {ASSIGN_MAGIC, MSG_RESULT, msg.slot, 0, msg.rows, msg.cols, -1, 0, 0, 0.0};
+        if (assign_send(c->fd, &reply, -1) != 0) {
+            daemon_drop_client(d, k);
+        }
+        return;
+    }
+    if (d->n_jobs == ASSIGN_MAX_BATCH) {
+        daemon_dispatch(d);
+    }
+    DaemonJob* job = &d->jobs[d->n_jobs++];
+    job->client = k;
+    job->slot = msg.slot;
+    job->rows = msg.rows;
+    job->cols = msg.cols;
+    job->priority = c->priority;
+    job->arrival = d->arrivals++;
+}
+
+// 运行守护进程直到收到SIGINT/SIGTERM。threads <= 0 时按CPU核数。返回0正常退出，-1启动失败
+int assign_daemon_run(const char* socket_path, int threads) {
+    int listen_fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (listen_fd < 0) {
+        return -1;
+    }
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(socket_path) >= sizeof(addr.sun_path)) {
+        close(listen_fd);
+        return -1;
+    }
+    strcpy(addr.sun_path, socket_path);
+    unlink(socket_path);
+    if (bind(listen_fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(listen_fd, 16) != 0) {
+        close(listen_fd);
+        return -1;
+    }
+
+    AssignDaemon* d = calloc(1, sizeof(AssignDaemon));
+    if (d == NULL || worker_pool_init(&d->pool, threads) != 0) {
+        free(d);
+        close(listen_fd);
+        unlink(socket_path);
+        return -1;
+    }
+    d->ws = malloc(sizeof(LapWorkspace) * d->pool.threads);
+    if (d->ws == NULL) {
+        worker_pool_free(&d->pool);
+        free(d);
+        close(listen_fd);
+        unlink(socket_path);
+        return -1;
+    }
+    for (int w = 0; w < d->pool.threads; w++) {
+        lap_workspace_init(&d->ws[w]);
+    }
+    for (int k = 0; k < ASSIGN_MAX_CLIENTS; k++) {
+        d->clients[k].fd = -1;
+    }
+    signal(SIGINT, daemon_on_signal);
+    signal(SIGTERM, daemon_on_signal);
+
+    struct pollfd fds[ASSIGN_MAX_CLIENTS + 1];
+    int owner[ASSIGN_MAX_CLIENTS + 1];
+    while (!daemon_stop) {
+        int n = 0;
+        fds[n].fd = listen_fd;
+        fds[n].events = POLLIN;
+        owner[n++] = -1;
+        for (int k = 0; k < ASSIGN_MAX_CLIENTS; k++) {
+            if (d->clients[k].fd >= 0) {
+                fds[n].fd = d->clients[k].fd;
+                fds[n].events = POLLIN;
+                owner[n++] = k;
+            }
+        }
+        if (poll(fds, n, 200) <= 0) {
+            continue;
+        }
+        for (int t = 1; t < n; t++) {
+            if (fds[t].revents & (POLLIN | POLLHUP | POLLERR)) {
+                if (d->clients[owner[t]].fd == fds[t].fd) {
+                    daemon_handle(d, owner[t]);
+                }
+            }
+        }
+        if (fds[0].revents & POLLIN) {
+            int fd = accept4(listen_fd, NULL, NULL, SOCK_CLOEXEC | SOCK_NONBLOCK);
+            int k = 0;
+            while (k < ASSIGN_MAX_CLIENTS && d->clients[k].fd >= 0) {
+                k++;
+            }
+            if (fd >= 0 && k == ASSIGN_MAX_CLIENTS) {
+                close(fd);
+            } else if (fd >= 0) {
+                d->clients[k].fd = fd;
+            }
+        }
+        // 本轮所有客户端的请求一起求解
+        if (d->n_jobs > 0) {
+            daemon_dispatch(d);
+        }
+    }
+
+    for (int k = 0; k < ASSIGN_MAX_CLIENTS; k++) {
+        if (d->clients[k].fd >= 0) {
+            daemon_drop_client(d, k);
+        }
+    }
+    for (int w = 0; w < d->pool.threads; w++) {
+        lap_workspace_free(&d->ws[w]);
+    }
+    free(d->ws);
+    worker_pool_free(&d->pool);
+    free(d);
+    close(listen_fd);
+    unlink(socket_path);
+    return 0;
+}
+
+// ---------------- 客户端 ----------------
+
+typedef struct {
+    int fd;                 // -1表示进程内求解
+    unsigned char* ring;
+    size_t ring_bytes;
+    int slots;
+    size_t slot_bytes;
+    int* status;            // 各槽：0空闲，1已提交，2已完成
+    double* total;          // 各槽的总成本
+    int* result_status;
+    LapWorkspace local;     // 进程内求解时使用
+} AssignClient;
+
+// 连接守护进程并共享ring_bytes大小、分为slots个槽的内存；连接失败时退回进程内求解
+// 返回0成功（client->fd < 0 表示进程内模式），-1内存不足
+int assign_client_open(AssignClient* c, const char* socket_path, size_t ring_bytes, int slots, int priority) {
+    memset(c, 0, sizeof(*c));
+    c->fd = -1;
+    c->slots = slots > 0 ? slots : 1;
+    c->ring_bytes = ring_bytes;
+    c->slot_bytes = ring_bytes / c->slots;
+    lap_workspace_init(&c->local);
+    c->status = calloc(c->slots, sizeof(int));
+    c->result_status = calloc(c->slots, sizeof(int));
+    c->total = calloc(c->slots, sizeof(double));
+    if (c->status == NULL || c->result_status == NULL || c->total == NULL) {
+        return -1;
+    }
+
+    int sock = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, socket_path, sizeof(addr.sun_path) - 1);
+    int shm_fd = -1;
+    if (sock >= 0 && connect(sock, (struct sockaddr*)&addr, sizeof(addr)) == 0 &&
+        (shm_fd = memfd_create("munkres_ring", MFD_CLOEXEC | MFD_ALLOW_SEALING)) >= 0 &&
+        ftruncate(shm_fd, ring_bytes) == 0 && fcntl(shm_fd, F_ADD_SEALS, F_SEAL_SHRINK) == 0) {
+        void* ring = mmap(NULL, ring_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
+        AssignMsg hello = {ASSIGN_MAGIC, MSG_HELLO, 0, priority, 0, 0, 0, c->slots, ring_bytes, 0.0};
+        if (ring != MAP_FAILED && assign_send(sock, &hello, shm_fd) == 0) {
+            close(shm_fd);
+            c->fd = sock;
+            c->ring = ring;
+            return 0;
+        }
+        if (ring != MAP_FAILED) {
+            munmap(ring, ring_bytes);
+        }
+    }
+    if (shm_fd >= 0) {
+        close(shm_fd);
+    }
+    if (sock >= 0) {
+        close(sock);
+    }
+    c->ring = malloc(ring_bytes);
+    return c->ring != NULL ? 0 : -1;
+}
+
+void assign_client_close(AssignClient* c) {
+    if (c->fd >= 0) {
+        close(c->fd);
+        munmap(c->ring, c->ring_bytes);
+    } else {
+        free(c->ring);
+    }
+    free(c->status);
+    free(c->result_status);
+    free(c->total);
+    lap_workspace_free(&c->local);
+    memset(c, 0, sizeof(*c));
+    c->fd = -1;
+}
+
+// 槽中成本矩阵的写入位置（行跨度为cols），尺寸放不下时返回NULL
+float* assign_client_matrix(AssignClient* c, int slot, int rows, int cols) {
+    if (slot < 0 || slot >= c->slots || !assign_fits(c->slot_bytes, rows, cols)) {
+        return NULL;
+    }
+    return (float*)(c->ring + (size_t)slot * c->slot_bytes);
+}
+
+// 提交槽中的矩阵；进程内模式下立即求解。返回0成功，-1失败
+int assign_client_submit(AssignClient* c, int slot, int rows, int cols) {
+    if (assign_client_matrix(c, slot, rows, cols) == NULL || c->status[slot] == 1) {
+        return -1;
+    }
+    if (c->fd >= 0) {
+        AssignMsg msg = {ASSIGN_MAGIC, MSG_SOLVE, slot, 0, rows, cols, 0, 0, 0, 0.0};
+        if (assign_send(c->fd, &msg, -1) != 0) {
+            return -1;
+        }
+        c->status[slot] = 1;
+        return 0;
+    }
+    unsigned char* base = c->ring + (size_t)slot * c->slot_bytes;
+    CostView view = cost_view_dense((const float*)base, rows, cols, cols);
+    int* row_to_col = (int*)(base + assign_result_offset(rows, cols));
+    c->result_status[slot] = lap_solve(&view, &c->local);
+    c->total[slot] = 0.0;
+    for (int i = 0; i < rows; i++) {
+        row_to_col[i] = c->result_status[slot] == 0 ? c->local.row_to_col[i] : -1;
+        if (row_to_col[i] >= 0) {
+            c->total[slot] += cost_view_at(&view, i, row_to_col[i]);
+        }
+    }
+    c->status[slot] = 2;
+    return 0;
+}
+
+// 等待槽的结果：*row_to_col 指向共享内存中的结果（下次提交该槽前有效）。返回0成功，-1失败
+int assign_client_wait(AssignClient* c, int slot, int rows, int cols, const int** row_to_col, double* total) {
+    if (slot < 0 || slot >= c->slots || c->status[slot] == 0) {
+        return -1;
+    }
+    while (c->status[slot] == 1) {
+        AssignMsg msg;
+        if (assign_recv(c->fd, &msg, NULL) != 0 || msg.type != MSG_RESULT) {
+            return -1;
+        }
+        if (msg.slot >= 0 && msg.slot < c->slots) {
+            c->status[msg.slot] = 2;
+            c->result_status[msg.slot] = msg.status;
+            c->total[msg.slot] = msg.total;
+        }
+    }
+    c->status[slot] = 0;
+    *row_to_col = (const int*)(c->ring + (size_t)slot * c->slot_bytes + assign_result_offset(rows, cols));
+    *total = c->total[slot];
+    return c->result_status[slot];
+}
+
+// ---------------- 自测 ----------------
+
+// 恶意客户端：memfd实际只有fd_bytes（sealed决定是否封住缩小），HELLO却声明claim_bytes，随后请求300x300。
+// 守护进程应拒绝该连接（断开或回复失败）而不是因SIGBUS退出。返回0表示被正确拒绝
+static int assign_selftest_bad_hello(const char* path, pid_t daemon, size_t fd_bytes, size_t claim_bytes, bool sealed) {
+    int sock = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+    int shm_fd = memfd_create("munkres_bad_ring", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (sock < 0 || shm_fd < 0 || connect(sock, (struct sockaddr*)&addr, sizeof(addr)) != 0 ||
+        ftruncate(shm_fd, fd_bytes) != 0 || (sealed && fcntl(shm_fd, F_ADD_SEALS, F_SEAL_SHRINK) != 0)) {
+        return -1;
+    }
+    AssignMsg hello = {ASSIGN_MAGIC, MSG_HELLO, 0, 0, 0, 0, 0, 1, claim_bytes, 0.0};
+    AssignMsg solve = {ASSIGN_MAGIC, MSG_SOLVE, 0, 0, 300, 300, 0, 0, 0, 0.0};
+    AssignMsg reply;
+    int rejected = assign_send(sock, &hello, shm_fd) == 0 && (assign_send(sock, &solve, -1) != 0 ||
+                   assign_recv(sock, &reply, NULL) != 0 || reply.status != 0) ? 0 : -1;
+    close(shm_fd);
+    close(sock);
+    usleep(20000);
+    return rejected == 0 && kill(daemon, 0) == 0 && waitpid(daemon, NULL, WNOHANG) == 0 ? 0 : -1;
+}
+
+// 不读回复的客户端：持续提交1x1请求直到守护进程断开它（回复缓冲区满时发送返回EAGAIN）。
+// 守护进程应继续存活并服务其他客户端。返回0表示该客户端被断开
+static int assign_selftest_stalled(const char* path, pid_t daemon) {
+    int sock = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+    int shm_fd = memfd_create("munkres_stalled_ring", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (sock < 0 || shm_fd < 0 || connect(sock, (struct sockaddr*)&addr, sizeof(addr)) != 0 ||
+        ftruncate(shm_fd, 4096) != 0 || fcntl(shm_fd, F_ADD_SEALS, F_SEAL_SHRINK) != 0) {
+        return -1;
+    }
+    AssignMsg hello = {ASSIGN_MAGIC, MSG_HELLO, 0, 0, 0, 0, 0, 1, 4096, 0.0};
+    AssignMsg solve = {ASSIGN_MAGIC, MSG_SOLVE, 0, 0, 1, 1, 0, 0, 0, 0.0};
+    int dropped = -1;
+    if (assign_send(sock, &hello, shm_fd) == 0) {
+        fcntl(sock, F_SETFL, fcntl(sock, F_GETFL) | O_NONBLOCK);
+        for (int sent = 0, waits = 0; sent < 1000000 && waits < 2000;) {
+            if (assign_send(sock, &solve, -1) == 0) {
+                sent++;
+            } else if (errno == EAGAIN) {
+                usleep(1000); // 守护进程的接收队列暂满
+                waits++;
+            } else {
+                dropped = 0; // EPIPE/ECONNRESET：已被断开
+                break;
+            }
+        }
+    }
+    close(shm_fd);
+    close(sock);
+    return dropped == 0 && kill(daemon, 0) == 0 && waitpid(daemon, NULL, WNOHANG) == 0 ? 0 : -1;
+}
+
+// 多个客户端（不同优先级、多槽流水线）经守护进程求解，并与进程内结果对比；再测试退回进程内模式
+static int assign_selftest(void) {
+    const char* path = "/tmp/munkres_assign_selftest.sock";
+    pid_t pid = fork();
+    if (pid == 0) {
+        exit(assign_daemon_run(path, 4) == 0 ? 0 : 1);
+    }
+    for (int wait_ms = 0; wait_ms < 2000 && access(path, F_OK) != 0; wait_ms += 10) {
+        usleep(10000);
+    }
+
+    enum { CLIENTS = 3, SLOTS = 4, ROUNDS = 25 };
+    AssignClient clients[CLIENTS];
+    LapWorkspace ref;
+    lap_workspace_init(&ref);
+    unsigned int seed = 12345;
+    int failed = 0, via_daemon = 0;
+    // 声明的环大小超过memfd实际大小；大小足够但没有F_SEAL_SHRINK（之后可被缩小）
+    if (assign_selftest_bad_hello(path, pid, 4096, 1 << 20, true) != 0 ||
+        assign_selftest_bad_hello(path, pid, 1 << 20, 1 << 20, false) != 0) {
+        printf("守护进程未拒绝大小不符的共享内存\n");
+        failed++;
+    }
+    if (assign_selftest_stalled(path, pid) != 0) {
+        printf("守护进程未断开不读回复的客户端\n");
+        failed++;
+    }
+    for (int k = 0; k < CLIENTS; k++) {
+        assign_client_open(&clients[k], path, 1 << 20, SLOTS, k);
+        via_daemon += clients[k].fd >= 0;
+    }
+    static float copy[SLOTS][CLIENTS][200 * 200];
+    int shape[SLOTS][CLIENTS][2];
+    long long t0 = monotonic_ns();
+    for (int round = 0; round < ROUNDS; round++) {
+        for (int s = 0; s < SLOTS; s++) {
+            for (int k = 0; k < CLIENTS; k++) {
+                int rows = 5 + assign_rand(&seed) % 150, cols = 5 + assign_rand(&seed) % 150;
+                float* m = assign_client_matrix(&clients[k], s, rows, cols);
+                for (int e = 0; e < rows * cols; e++) {
+                    m[e] = assign_rand(&seed) % 100 < 5 ? DISALLOWED_VAL : (float)(assign_rand(&seed) % 1000) / 10.0f;
+                    copy[s][k][e] = m[e];
+                }
+                shape[s][k][0] = rows;
+                shape[s][k][1] = cols;
+                assign_client_submit(&clients[k], s, rows, cols);
+            }
+        }
+        for (int s = 0; s < SLOTS; s++) {
+            for (int k = 0; k < CLIENTS; k++) {
+                int rows = shape[s][k][0], cols = shape[s][k][1];
+                const int* r2c;
+                double total;
+                CostView view = cost_view_dense(copy[s][k], rows, cols, cols);
+                lap_solve(&view, &ref);
+                if (assign_client_wait(&clients[k], s, rows, cols, &r2c, &total) != 0 ||
+                    fabs(total - lap_total_cost(&view, &ref)) > 1e-2) {
+                    failed++;
+                }
+            }
+        }
+    }
+    long long t1 = monotonic_ns();
+    for (int k = 0; k < CLIENTS; k++) {
+        assign_client_close(&clients[k]);
+    }
+    kill(pid, SIGTERM);
+    waitpid(pid, NULL, 0);
+    printf("经守护进程的客户端 %d/%d, %d 个请求耗时 %.2lf ms\n", via_daemon, CLIENTS, CLIENTS * SLOTS * ROUNDS, (t1 - t0) / 1e6);
+
+    // 守护进程已退出：应退回进程内求解
+    AssignClient local;
+    assign_client_open(&local, path, 1 << 16, 1, 0);
+    float* m = assign_client_matrix(&local, 0, 3, 3);
+    const float demo[9] = {4, 1, 3, 2, 0, 5, 3, 2, 2};
+    memcpy(m, demo, sizeof(demo));
+    const int* r2c;
+    double total = 0.0;
+    assign_client_submit(&local, 0, 3, 3);
+    if (local.fd >= 0 || assign_client_wait(&local, 0, 3, 3, &r2c, &total) != 0 || fabs(total - 5.0) > 1e-6) {
+        failed++;
+    }
+    assign_client_close(&local);
+    lap_workspace_free(&ref);
+
+    if (via_daemon != CLIENTS) {
+        failed++;
+    }
+    printf(failed == 0 ? "测试通过！\n" : "测试失败！\n");
+    return failed == 0 ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+    if (argc > 1 && strcmp(argv[1], "--selftest") == 0) {
+        return assign_selftest();
+    }
+    const char* path = argc > 1 ? argv[1] : ASSIGN_DEFAULT_SOCKET;
+    int threads = argc > 2 ? atoi(argv[2]) : 0;
+    if (assign_daemon_run(path, threads) != 0) {
+        fprintf(stderr, "无法在 %s 启动守护进程: %s\n", path, strerror(errno));
+        return 1;
+    }
+    return 0;
+}